@@ -1,2 +1,402 @@
 #include "CConfiguration.h"
+#include <QJsonArray>
+#include <QStringList>
+#include <QDebug>
 
+// JSON keys
+const QString cKeyChannels( "channels" );
+const QString cKeyLabel( "label" );
+const QString cKeyUnit( "Unit" );
+const QString cKeyChannel( "Channel" );
+const QString cKeyVoltage( "Voltage" );
+const QString cKeySpectrumBarIndex( "SpectrumBarIndex" );
+const QString cKeyGain( "Gain" );
+const QString cKeyFade( "Fade" );
+const QString cKeyColor( "Color" );
+const QString cKeyUUID( "uuid" );
+const QString cKeyLowHz( "LowHz" );
+const QString cKeyHighHz( "HighHz" );
+const QString cKeyDimmingCurve( "DimmingCurve" );
+
+const QString cCurveLinear( "linear" );
+const QString cCurvePerceptual( "perceptual" );
+
+
+bool CConfigation::channelsFromJson( const QJsonObject &json, std::vector<Channel> &channels )
+{
+    bool isSchemaValid = true;
+    if (json.contains( cKeyChannels ))
+    {
+        QJsonValue channelsValue = json[ cKeyChannels ];
+        QJsonArray channelsJson( channelsValue.toArray() );
+        std::vector<Channel> channelsTmp;
+        channelsTmp.reserve(channelsJson.size());
+        qDebug() << "Json channels count: " << channelsJson.size();
+
+        for ( const auto& jsonChannelValue : channelsJson )
+        {
+            if ( jsonChannelValue.isObject() )
+            {
+                const QJsonObject &jsonChannel = jsonChannelValue.toObject();
+                QString label;
+                if ( jsonChannel.contains( cKeyLabel ) )
+                {
+                    if ( !jsonChannel[ cKeyLabel ].isString() )
+                    {
+                        isSchemaValid = false;
+                        qWarning() << "Channel '" << cKeyLabel << "' is wrong";
+                    }
+                    else
+                    {
+                        label = jsonChannel[ cKeyLabel ].toString();
+                    }
+                }
+
+                uint32_t unit;
+                if ( jsonChannel.contains( cKeyUnit ) )
+                {
+                    unit = jsonChannel[ cKeyUnit ].toInt(0);
+                    if ( 0 == unit )
+                    {
+                        isSchemaValid = false;
+                        qWarning() << "Unit number '" << cKeyUnit << "' is wrong";
+                    }
+                }
+
+                uint32_t ChannelNumber;
+                if ( jsonChannel.contains( cKeyChannel) )
+                {
+                    ChannelNumber = jsonChannel[ cKeyChannel ].toInt(0);
+                    if ( 0 == ChannelNumber )
+                    {
+                        isSchemaValid = false;
+                        qWarning() << "Channel number '" << cKeyChannel << "' is wrong";
+                    }
+                }
+
+                uint32_t Voltage;
+                if ( jsonChannel.contains( cKeyVoltage ) )
+                {
+                    Voltage = jsonChannel[ cKeyVoltage ].toInt(0);
+                    if ( 0 == Voltage )
+                    {
+                        isSchemaValid = false;
+                        qWarning() << "Voltage number '" << cKeyVoltage << "' is wrong";
+                    }
+                }
+
+                uint32_t SpectrumBarIndex;
+                if ( jsonChannel.contains( cKeySpectrumBarIndex ) )
+                {
+                    SpectrumBarIndex = jsonChannel[ cKeySpectrumBarIndex ].toInt(0);
+                    if ( 0 == SpectrumBarIndex )
+                    {
+                        isSchemaValid = false;
+                        qWarning() << "Spectrum bar index number '" << cKeySpectrumBarIndex << "' is wrong";
+                    }
+                }
+
+                double Gain;
+                if ( jsonChannel.contains( cKeyGain ) )
+                {
+                    if ( !jsonChannel[ cKeyGain ].isDouble() )
+                    {
+                        Gain = 1.0;
+                        qWarning() << "Channel Multipler '" << cKeyGain << "' is wrong";
+                    }
+                    else
+                    {
+                        Gain = jsonChannel[ cKeyGain ].toDouble();
+                    }
+                }
+
+
+                double Fade;
+                if ( jsonChannel.contains( cKeyFade ) )
+                {
+                    if ( !jsonChannel[ cKeyFade ].isDouble() )
+                    {
+                        Fade = 1.0;
+                        qWarning() << "Channel Fade '" << cKeyFade << "' is wrong";
+                    }
+                    else
+                    {
+                        Fade = jsonChannel[ cKeyFade ].toDouble();
+                    }
+                }
+
+                QString color;
+                if ( jsonChannel.contains( cKeyColor ) )
+                {
+                    if ( !jsonChannel[ cKeyColor ].isString() )
+                    {
+                        isSchemaValid = false;
+                        qWarning() << "Channel '" << cKeyColor << "' is wrong";
+                    }
+                    else
+                    {
+                        color = jsonChannel[ cKeyColor ].toString();
+                    }
+                }
+
+                QUuid uuid;
+                if ( jsonChannel.contains( cKeyUUID ) )
+                {
+                    if ( !jsonChannel[ cKeyUUID ].isString() )
+                    {
+                        uuid = QUuid::createUuid();
+                        qWarning() << "Channel '" << cKeyUUID << "' is wrong, new generated"<< uuid;
+                    }
+                    else
+                    {
+                        uuid = jsonChannel[ cKeyUUID ].toString();
+                    }
+                }
+
+                channelsTmp.emplace_back(label, unit, ChannelNumber, Voltage, SpectrumBarIndex, Gain, Fade, color, uuid);
+
+                if ( jsonChannel.contains( cKeyLowHz ) && jsonChannel.contains( cKeyHighHz ) )
+                {
+                    CBandLayout::Band band;
+                    band.lowHz = jsonChannel[ cKeyLowHz ].toDouble( -1.0 );
+                    band.highHz = jsonChannel[ cKeyHighHz ].toDouble( -1.0 );
+                    if ( band.lowHz < 0.0 || !band.isValid() || band.highHz > cMaxFrequensy )
+                    {
+                        qWarning() << "Channel frequency range '" << cKeyLowHz << "' '" << cKeyHighHz << "' is wrong, spectrum bar index is used";
+                    }
+                    else
+                    {
+                        channelsTmp.back().band = band;
+                    }
+                }
+
+                if ( jsonChannel.contains( cKeyDimmingCurve )
+                     && !curveFromText( jsonChannel[ cKeyDimmingCurve ].toString(), channelsTmp.back().curve ) )
+                {
+                    qWarning() << "Channel '" << cKeyDimmingCurve << "' is wrong, linear is used";
+                }
+
+            }
+            else
+            {
+                qDebug() << "channel is not object";
+                isSchemaValid = false;
+            }
+        }
+
+        channels = std::move(channelsTmp);
+
+        qDebug() << "channels count: " << channels.size();
+
+    }
+
+    return isSchemaValid;
+}
+
+
+void CConfigation::channelsToJson( const std::vector<Channel> &channels, QJsonObject &json )
+{
+    QJsonArray jsonChannelsArray;
+
+    for ( const auto& channel : channels )
+    {
+        QJsonObject jsonObject;
+        jsonObject[ cKeyLabel ] = channel.label;
+        jsonObject[ cKeyUnit ] = static_cast<int>(channel.unit);
+        jsonObject[ cKeyChannel ] = static_cast<int>(channel.channel);
+        jsonObject[ cKeyVoltage ] = static_cast<int>(channel.voltage);
+        jsonObject[ cKeySpectrumBarIndex ] = static_cast<int>(channel.spectrumIndex);
+        jsonObject[ cKeyGain ] = channel.gain;
+        jsonObject[ cKeyFade ] = channel.fade;
+        jsonObject[ cKeyColor ] = channel.color;
+        jsonObject[ cKeyUUID ] = channel.uuid.toString();
+        if ( channel.band.isValid() )
+        {
+            jsonObject[ cKeyLowHz ] = channel.band.lowHz;
+            jsonObject[ cKeyHighHz ] = channel.band.highHz;
+        }
+        if ( DimmingCurve::EType::Linear != channel.curve.type )
+        {
+            jsonObject[ cKeyDimmingCurve ] = curveToText( channel.curve );
+        }
+        jsonChannelsArray.append(jsonObject);
+    }
+
+    json[ cKeyChannels ] = jsonChannelsArray;
+}
+
+
+bool CConfigation::bandFromText( const QString &text, CBandLayout::Band &band )
+{
+    band = CBandLayout::Band();
+    if ( text.trimmed().isEmpty() )
+    {
+        return true;
+    }
+
+    auto parts = text.split( '-' );
+    if ( 2 != parts.size() )
+    {
+        return false;
+    }
+
+    bool isLowOk = false;
+    bool isHighOk = false;
+    CBandLayout::Band parsed;
+    parsed.lowHz = parts[0].trimmed().toDouble( &isLowOk );
+    parsed.highHz = parts[1].trimmed().toDouble( &isHighOk );
+
+    // Nothing above Nyquist of the usual 44.1 kHz audio
+    if ( !isLowOk || !isHighOk || parsed.lowHz < 0.0 || !parsed.isValid() || parsed.highHz > cMaxFrequensy )
+    {
+        return false;
+    }
+
+    band = parsed;
+    return true;
+}
+
+
+QString CConfigation::bandToText( const CBandLayout::Band &band )
+{
+    if ( !band.isValid() )
+    {
+        return QString();
+    }
+    return QString::number( qRound( band.lowHz ) ) + " - " + QString::number( qRound( band.highHz ) );
+}
+
+
+bool CConfigation::curveFromText( const QString &text, DimmingCurve &curve )
+{
+    curve = DimmingCurve();
+    const QString trimmed = text.trimmed();
+    if ( trimmed.isEmpty() || 0 == trimmed.compare( cCurveLinear, Qt::CaseInsensitive ) )
+    {
+        return true;
+    }
+
+    if ( 0 == trimmed.compare( cCurvePerceptual, Qt::CaseInsensitive ) )
+    {
+        curve.type = DimmingCurve::EType::Perceptual;
+        return true;
+    }
+
+    DimmingCurve parsed;
+    parsed.type = DimmingCurve::EType::Custom;
+    for ( const auto& pointText : trimmed.split( ',', QString::SkipEmptyParts ) )
+    {
+        auto parts = pointText.split( ':' );
+        bool isXOk = false;
+        bool isYOk = false;
+        const double x = 2 == parts.size() ? parts[0].trimmed().toDouble( &isXOk ) : 0.0;
+        const double y = 2 == parts.size() ? parts[1].trimmed().toDouble( &isYOk ) : 0.0;
+
+        // Inside the ends, which are always 0:0 and 1:1, and ascending
+        const double previousX = parsed.points.empty() ? 0.0 : parsed.points.back().first;
+        if ( !isXOk || !isYOk || !( x > previousX ) || !( x < 1.0 ) || y < 0.0 || y > 1.0 )
+        {
+            return false;
+        }
+        parsed.points.emplace_back( x, y );
+    }
+
+    if ( parsed.points.empty() )
+    {
+        return false;
+    }
+
+    curve = parsed;
+    return true;
+}
+
+
+QString CConfigation::curveToText( const DimmingCurve &curve )
+{
+    switch ( curve.type )
+    {
+    case DimmingCurve::EType::Linear:
+        return cCurveLinear;
+    case DimmingCurve::EType::Perceptual:
+        return cCurvePerceptual;
+    case DimmingCurve::EType::Custom:
+        break;
+    }
+
+    QStringList points;
+    for ( const auto& point : curve.points )
+    {
+        points << QString::number( point.first ) + ":" + QString::number( point.second );
+    }
+    return points.join( ", " );
+}
+
+
+bool CConfigation::outputPortFromText( const QString &text, OutputPort &port )
+{
+    auto parts = text.trimmed().split( ' ', QString::SkipEmptyParts );
+    if ( parts.size() < 3 )
+    {
+        return false;
+    }
+
+    OutputPort parsed;
+    if ( 0 == parts.first().compare( cOutputTypeE131Name, Qt::CaseInsensitive ) )
+    {
+        parts.removeFirst();
+        parsed.type = EOutputType::E131;
+        parsed.name = parts.takeFirst();
+        parsed.baudRate = 0;
+    }
+    else
+    {
+        bool isBaudRateOk = false;
+        parsed.name = parts.takeFirst();
+        parsed.baudRate = parts.takeFirst().toUInt( &isBaudRateOk );
+        if ( !isBaudRateOk || 0 == parsed.baudRate )
+        {
+            return false;
+        }
+    }
+
+    for ( const auto& range : parts.join( ' ' ).split( ',', QString::SkipEmptyParts ) )
+    {
+        auto bounds = range.split( '-' );
+        bool isFirstOk = false;
+        bool isLastOk = true;
+        uint32_t first = bounds[0].trimmed().toUInt( &isFirstOk );
+        uint32_t last = 2 == bounds.size() ? bounds[1].trimmed().toUInt( &isLastOk ) : first;
+        if ( bounds.size() > 2 || !isFirstOk || !isLastOk || 0 == first || last < first || last > 0xFF )
+        {
+            return false;
+        }
+
+        for ( auto unit = first; unit <= last; ++unit )
+        {
+            parsed.units.push_back( unit );
+        }
+    }
+
+    if ( parsed.units.empty() )
+    {
+        return false;
+    }
+
+    port = parsed;
+    return true;
+}
+
+
+QString CConfigation::outputPortToText( const OutputPort &port )
+{
+    QStringList units;
+    for ( auto unit : port.units )
+    {
+        units << QString::number( unit );
+    }
+    if ( EOutputType::E131 == port.type )
+    {
+        return cOutputTypeE131Name + " " + port.name + " " + units.join( ", " );
+    }
+    return port.name + " " + QString::number( port.baudRate ) + " " + units.join( ", " );
+}
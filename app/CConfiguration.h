@@ -5,6 +5,34 @@
 #include <vector>
 #include <QUuid>
 #include <QObject>
+#include <QJsonObject>
+#include "constants.h"
+#include "cfftengine.h"
+#include "cbandlayout.h"
+#include "cintensityencoder.h"
+
+
+// Configuration files, both live in the working directory
+const QString cChannelConfigurationFileName( "channelConfiguration.json" );
+const QString cSequenseConfigurationFileName( "sequenseConfiguration.json" );
+
+// JSON keys of the sequense configuration
+const QString cKeyOutputDirectory( "outputDir" );
+const QString cKeyPlayRandom( "isRandomPlay" );
+const QString cKeySequenses( "sequenses" );
+const QString cKeyAnalysisHopMs( "analysisHopMs" );
+const QString cKeyAnalysisFFTSize( "analysisFFTSize" );
+const QString cKeyAnalysisWindow( "analysisWindow" );
+const QString cKeyOutputHysteresis( "outputHysteresis" );
+const QString cKeyOutputRefreshMs( "outputRefreshMs" );
+const QString cKeyFileName("file");
+const QString cKeyChannelConfiguration("configuration");
+const QString cKeyChannelUUID("uuid");
+const QString cKeyChannelSpectrumIndex("spectrumIndex");
+const QString cKeyChannelGain("gain");
+const QString cKeyChannelMinimumLevel("minimumLevel");
+const QString cKeyChannelFading("fading");
+const QString cKeyChannelEffects("effects");
 
 class Channel
 {
@@ -37,6 +65,33 @@ public:
     double fade;
     QString color;
     QUuid uuid;
+    CBandLayout::Band band;   // frequency range, replaces spectrumIndex when valid
+    DimmingCurve curve;       // brightness response of the lights, linear by default
+};
+
+enum class EOutputType
+{
+    LOR,     // serial port
+    E131     // sACN over UDP, units are universes
+};
+
+// First word of an E1.31 output in the text form
+const QString cOutputTypeE131Name("e131");
+
+// Output of the live output, units no port lists go to the first one
+struct OutputPort
+{
+    QString name;                // serial port, or host of an E1.31 output
+    uint32_t baudRate;           // 0 for E1.31
+    std::vector<uint32_t> units;
+    EOutputType type = EOutputType::LOR;
+    QString address;             // IPv4 the E1.31 host resolved to, filled in by CLORSerialCtrl
+
+    bool operator==( const OutputPort& other ) const
+    {
+        return    name == other.name && baudRate == other.baudRate && units == other.units
+               && type == other.type && address == other.address;
+    }
 };
 
 
@@ -51,6 +106,31 @@ public:
       return destinationFolder;
    }
 
+   uint32_t getAnalysisHopMs() const
+   {
+      return analysisHopMs;
+   }
+
+   uint32_t getAnalysisFFTSize() const
+   {
+      return analysisFFTSize;
+   }
+
+   CFFTEngine::EWindow getAnalysisWindow() const
+   {
+      return analysisWindow;
+   }
+
+   uint32_t getOutputHysteresis() const
+   {
+      return outputHysteresis;
+   }
+
+   uint32_t getOutputRefreshMs() const
+   {
+      return outputRefreshMs;
+   }
+
    virtual const std::vector<Channel>& channels() const = 0;
 
 
@@ -68,9 +148,31 @@ public:
       return result;
    }
 
+   // Channel list of channelConfiguration.json, returns false if the schema is broken
+   static bool channelsFromJson( const QJsonObject& json, std::vector<Channel>& channels );
+   static void channelsToJson( const std::vector<Channel>& channels, QJsonObject& json );
+
+   // "low - high" in Hz, empty text is no band
+   static bool bandFromText( const QString& text, CBandLayout::Band& band );
+   static QString bandToText( const CBandLayout::Band& band );
+
+   // "linear", "perceptual" or custom points "x:y, x:y" with x and y in 0..1
+   static bool curveFromText( const QString& text, DimmingCurve& curve );
+   static QString curveToText( const DimmingCurve& curve );
+
+   // "name baudRate units" with units as "3, 5-7", or "e131 host units" for
+   // E1.31, returns false if the text is broken
+   static bool outputPortFromText( const QString& text, OutputPort& port );
+   static QString outputPortToText( const OutputPort& port );
+
 protected:
    QString   destinationFolder;
    bool isPlayRandomEnabled = false;
+   uint32_t analysisHopMs = cDefaultAnalysisHopMs;
+   uint32_t analysisFFTSize = cDefaultFFTSize;
+   CFFTEngine::EWindow analysisWindow = CFFTEngine::EWindow::Hann;
+   uint32_t outputHysteresis = cDefaultOutputHysteresis;
+   uint32_t outputRefreshMs = cDefaultOutputRefreshMs;
 
 };
 
@@ -0,0 +1,67 @@
+#ifndef IOUTPUTBACKEND_H
+#define IOUTPUTBACKEND_H
+
+#include <QString>
+#include <chrono>
+#include <cstdint>
+
+class COutputLog;
+class Channel;
+
+/**
+ * Transport of the live output, fed by CLiveOutputThread with the channel
+ * intensities of every frame. CLiveOutputPort writes the LOR byte format to
+ * a serial port, CE131Output sends E1.31 (sACN) universes over UDP.
+ *
+ * A backend is created, used and destroyed on the output thread only. A
+ * frame is beginFrame(), queueIntensity() for every channel of the backend
+ * and endFrame(), which hands the frame to the transport.
+ */
+class IOutputBackend
+{
+public:
+
+   using Clock = std::chrono::steady_clock;
+
+   struct Statistics
+   {
+      uint64_t bytes = 0;       // handed to the transport
+      uint64_t deferred = 0;    // channel updates that did not fit in their frame
+      uint64_t dropped = 0;     // deferred updates that were never sent
+
+      Statistics& operator+=( const Statistics& other )
+      {
+         bytes += other.bytes;
+         deferred += other.deferred;
+         dropped += other.dropped;
+         return *this;
+      }
+   };
+
+   virtual ~IOutputBackend() = default;
+
+   virtual const QString& name() const = 0;
+   virtual bool isOpen() const = 0;
+   virtual const Statistics& statistics() const = 0;
+
+   // hysteresis in LOR level steps, 0 sends every change. A channel is sent
+   // again at least every refreshPeriod.
+   virtual void setDeltaParams( uint32_t hysteresis, std::chrono::milliseconds refreshPeriod ) = 0;
+
+   // Every write to the transport goes to log as port index
+   virtual void setLog( COutputLog* /*log*/, uint8_t /*index*/ ) {}
+
+   // Dense index of a unit channel, kept for the life of the backend.
+   // Looked up when a setup is compiled, frames address channels by slot only.
+   // Takes the CIntensityEncoder of the channel voltage and dimming curve.
+   virtual std::size_t slot( const Channel& channel ) = 0;
+
+   virtual void beginFrame( Clock::time_point now ) = 0;
+
+   // intensity 0..1, encoded by the table of the slot
+   virtual void queueIntensity( std::size_t slot, double intensity, Clock::time_point now ) = 0;
+
+   virtual void endFrame( Clock::time_point now ) = 0;
+};
+
+#endif // IOUTPUTBACKEND_H
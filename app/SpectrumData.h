@@ -3,6 +3,9 @@
 
 #include <cstdint>
 #include <vector>
+#include <memory>
+
+struct BeatTrack;
 
 struct SpectrumData
 {
@@ -13,6 +16,8 @@ struct SpectrumData
     SpectrumData() = default;
     uint64_t position = 0;
     std::vector<float> spectrum;
+    uint32_t sampleRate = 0;    // of the audio, 0 if unknown
+    std::shared_ptr<const BeatTrack> beats;    // of the whole track, null until detected
 };
 
 
@@ -0,0 +1,139 @@
+#include "SpectrumStore.h"
+#include <algorithm>
+
+SpectrumStore::SpectrumStore( uint32_t binCount )
+   : m_binCount( binCount )
+{
+}
+
+
+SpectrumStore::SpectrumStore( const SpectrumStore &other )
+{
+   *this = other;
+}
+
+
+SpectrumStore::SpectrumStore( SpectrumStore &&other )
+{
+   *this = std::move( other );
+}
+
+
+SpectrumStore &SpectrumStore::operator=( const SpectrumStore &other )
+{
+   if ( this != &other )
+   {
+      m_binCount = other.m_binCount;
+      m_sampleRate = other.m_sampleRate;
+      m_frameCount = other.m_frameCount;
+      m_ownedPositions = other.m_ownedPositions;
+      m_ownedBins = other.m_ownedBins;
+      m_owner = other.m_owner;
+      m_positions = other.m_positions;
+      m_bins = other.m_bins;
+      refreshPointers();
+   }
+   return *this;
+}
+
+
+SpectrumStore &SpectrumStore::operator=( SpectrumStore &&other )
+{
+   if ( this != &other )
+   {
+      m_binCount = other.m_binCount;
+      m_sampleRate = other.m_sampleRate;
+      m_frameCount = other.m_frameCount;
+      m_ownedPositions = std::move( other.m_ownedPositions );
+      m_ownedBins = std::move( other.m_ownedBins );
+      m_owner = std::move( other.m_owner );
+      m_positions = other.m_positions;
+      m_bins = other.m_bins;
+      refreshPointers();
+      other.clear();
+   }
+   return *this;
+}
+
+
+void SpectrumStore::clear()
+{
+   m_frameCount = 0;
+   m_ownedPositions.clear();
+   m_ownedBins.clear();
+   m_owner.reset();
+   refreshPointers();
+}
+
+
+void SpectrumStore::reserve( std::size_t frameCount )
+{
+   m_ownedPositions.reserve( frameCount );
+   m_ownedBins.reserve( frameCount * m_binCount );
+   refreshPointers();
+}
+
+
+void SpectrumStore::append( uint64_t position, const float *bins )
+{
+   if ( nullptr != m_owner )
+   {
+      // Borrowed buffers are read-only, copy them before the first append
+      m_ownedPositions.assign( m_positions, m_positions + m_frameCount );
+      m_ownedBins.assign( m_bins, m_bins + m_frameCount * m_binCount );
+      m_owner.reset();
+   }
+
+   m_ownedPositions.push_back( position );
+   m_ownedBins.insert( m_ownedBins.end(), bins, bins + m_binCount );
+   ++m_frameCount;
+   refreshPointers();
+}
+
+
+void SpectrumStore::adopt( std::shared_ptr<const void> owner,
+                           const uint64_t *positions,
+                           const float *bins,
+                           std::size_t frameCount,
+                           uint32_t binCount )
+{
+   m_ownedPositions.clear();
+   m_ownedBins.clear();
+   m_owner = std::move( owner );
+   m_positions = positions;
+   m_bins = bins;
+   m_frameCount = frameCount;
+   m_binCount = binCount;
+}
+
+
+std::size_t SpectrumStore::indexAt( uint64_t time ) const
+{
+   if ( 0 == m_frameCount )
+   {
+      return 0;
+   }
+
+   auto end = m_positions + m_frameCount;
+   auto it = std::upper_bound( m_positions, end, time );
+   return ( it == m_positions ) ? 0 : std::size_t( it - m_positions ) - 1;
+}
+
+
+SpectrumData SpectrumStore::toSpectrumData( std::size_t index ) const
+{
+   auto bins = frame( index );
+   SpectrumData data( position( index ), std::vector<float>( bins.begin(), bins.end() ) );
+   data.sampleRate = m_sampleRate;
+   return data;
+}
+
+
+void SpectrumStore::refreshPointers()
+{
+   if ( nullptr == m_owner )
+   {
+      m_positions = m_ownedPositions.data();
+      m_bins = m_ownedBins.data();
+   }
+}
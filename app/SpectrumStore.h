@@ -0,0 +1,105 @@
+#ifndef SPECTRUMSTORE_H
+#define SPECTRUMSTORE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "SpectrumData.h"
+
+/**
+ * Read-only view of contiguous values, stands in for std::span until the
+ * project moves past C++14.
+ */
+template< typename T >
+class Span
+{
+public:
+   Span() = default;
+   Span( const T* adata, std::size_t asize ) : m_data( adata ), m_size( asize ) {}
+
+   const T* data() const { return m_data; }
+   std::size_t size() const { return m_size; }
+   bool empty() const { return 0 == m_size; }
+
+   const T* begin() const { return m_data; }
+   const T* end() const { return m_data + m_size; }
+
+   const T& operator[]( std::size_t index ) const { return m_data[ index ]; }
+
+   Span subspan( std::size_t offset, std::size_t count ) const { return Span( m_data + offset, count ); }
+
+private:
+   const T* m_data = nullptr;
+   std::size_t m_size = 0;
+};
+
+
+/**
+ * Analysed spectrum of a whole track, structure of arrays: one positions
+ * array and one [frames x bins] float buffer, instead of an allocation per
+ * frame. The buffers are either owned or borrowed from memory kept alive
+ * by an owner object, e.g. a mapped cache file.
+ */
+class SpectrumStore
+{
+public:
+
+   SpectrumStore() = default;
+   explicit SpectrumStore( uint32_t binCount );
+
+   SpectrumStore( const SpectrumStore& other );
+   SpectrumStore( SpectrumStore&& other );
+   SpectrumStore& operator=( const SpectrumStore& other );
+   SpectrumStore& operator=( SpectrumStore&& other );
+
+   uint32_t binCount() const { return m_binCount; }
+
+   // Of the analysed audio, 0 if unknown
+   uint32_t sampleRate() const { return m_sampleRate; }
+   void setSampleRate( uint32_t sampleRate ) { m_sampleRate = sampleRate; }
+   std::size_t size() const { return m_frameCount; }
+   bool empty() const { return 0 == m_frameCount; }
+
+   void clear();
+   void reserve( std::size_t frameCount );
+
+   // Copies binCount() values, only for an owned store
+   void append( uint64_t position, const float* bins );
+
+   // Borrows the buffers, owner keeps them valid for the lifetime of the store
+   void adopt( std::shared_ptr<const void> owner,
+               const uint64_t* positions,
+               const float* bins,
+               std::size_t frameCount,
+               uint32_t binCount );
+
+   uint64_t position( std::size_t index ) const { return m_positions[ index ]; }
+   Span<float> frame( std::size_t index ) const { return Span<float>( m_bins + index * m_binCount, m_binCount ); }
+
+   Span<uint64_t> positions() const { return Span<uint64_t>( m_positions, m_frameCount ); }
+   Span<float> bins() const { return Span<float>( m_bins, m_frameCount * m_binCount ); }
+
+   // Index of the last frame with position <= time, 0 if time is before the first frame
+   std::size_t indexAt( uint64_t time ) const;
+
+   SpectrumData toSpectrumData( std::size_t index ) const;
+
+private:
+
+   void refreshPointers();
+
+private:
+   uint32_t m_binCount = 0;
+   uint32_t m_sampleRate = 0;
+   std::size_t m_frameCount = 0;
+
+   std::vector<uint64_t> m_ownedPositions;
+   std::vector<float> m_ownedBins;
+   std::shared_ptr<const void> m_owner;
+
+   const uint64_t* m_positions = nullptr;
+   const float* m_bins = nullptr;
+};
+
+#endif // SPECTRUMSTORE_H
@@ -2,14 +2,28 @@ TEMPLATE = app
 
 TARGET = spectrum
 
-QT       += widgets serialport
+QT       += widgets serialport network concurrent
 
 SOURCES  += channelconfigurator.cpp \
             CConfiguration.cpp \
+            SpectrumStore.cpp \
+            ce131output.cpp \
             ceffecteditorwidget.cpp \
             clightsequence.cpp \
+            cliveoutputport.cpp \
+            cliveoutputthread.cpp \
+            clorframeencoder.cpp \
+            coutputlog.cpp \
             clorserialctrl.cpp \
+            cbandlayout.cpp \
+            cbeatdetector.cpp \
+            cfftengine.cpp \
+            cintensityencoder.cpp \
             csequensegenerator.cpp \
+            ctrace.cpp \
+            cspectrumanalyzer.cpp \
+            cspectrumcache.cpp \
+            effects/CEffectBeat.cpp \
             effects/CEffectFade.cpp \
             effects/CEffectIntensity.cpp \
             effects/CEffectMaxLevel.cpp \
@@ -19,6 +33,8 @@ SOURCES  += channelconfigurator.cpp \
             mainwindow.cpp \
             qbassaudiofile.cpp \
             spectrograph.cpp \
+            timeline/CEffectIntervalIndex.cpp \
+            timeline/CEffectRenderCache.cpp \
             timeline/CTimeLineChannel.cpp \
             timeline/CTimeLineEffect.cpp \
             timeline/CTimeLineIndicator.cpp \
@@ -33,11 +49,26 @@ SOURCES  += channelconfigurator.cpp \
 HEADERS  += channelconfigurator.h \
             CConfiguration.h \
             SpectrumData.h \
+            SpectrumStore.h \
+            IOutputBackend.h \
+            ce131output.h \
             ceffecteditorwidget.h \
             clightsequence.h \
+            cliveoutputport.h \
+            cliveoutputthread.h \
+            clorframeencoder.h \
+            coutputlog.h \
             clorserialctrl.h \
             constants.h \
+            cbandlayout.h \
+            cbeatdetector.h \
+            cfftengine.h \
+            cintensityencoder.h \
             csequensegenerator.h \
+            ctrace.h \
+            cspectrumanalyzer.h \
+            cspectrumcache.h \
+            effects/CEffectBeat.h \
             effects/CEffectFade.h \
             effects/CEffectIntensity.h \
             effects/CEffectMaxLevel.h \
@@ -46,6 +77,8 @@ HEADERS  += channelconfigurator.h \
             mainwindow.h \
             qbassaudiofile.h \
             spectrograph.h \
+            timeline/CEffectIntervalIndex.h \
+            timeline/CEffectRenderCache.h \
             timeline/CTimeLineChannel.h \
             timeline/CTimeLineEffect.h \
             timeline/CTimeLineIndicator.h \
@@ -66,6 +99,12 @@ RESOURCES +=  ../3rdparty/qdarkstyle/style.qrc
 CONFIG += install_ok  # Do not cargo-cult this!
 CONFIG += c++14
 
+# SSE2 kernel of the FFT engine is the default on x86-64, qmake CONFIG+=avx2 selects the AVX2 one
+avx2 {
+    msvc: QMAKE_CXXFLAGS += /arch:AVX2
+    else: QMAKE_CXXFLAGS += -mavx2 -mfma
+}
+
 FORMS += \
     channelconfigurator.ui \
     mainwindow.ui
@@ -0,0 +1,147 @@
+#include "cbandlayout.h"
+#include <algorithm>
+#include <cmath>
+#include "constants.h"
+
+namespace
+{
+
+double binWidth( uint32_t binCount, uint32_t sampleRate )
+{
+   return double( 0 != sampleRate ? sampleRate : cDefaultSampleRate ) / ( 2.0 * binCount );
+}
+
+}
+
+
+CBandLayout::CBandLayout( const std::vector<Band> &bands, uint32_t binCount, uint32_t sampleRate )
+   : m_bands( bands )
+   , m_binCount( binCount )
+   , m_sampleRate( sampleRate )
+{
+   m_first.reserve( bands.size() );
+   m_count.reserve( bands.size() );
+   m_offset.reserve( bands.size() );
+
+   if ( 0 == binCount )
+   {
+      m_first.assign( bands.size(), 0 );
+      m_count.assign( bands.size(), 0 );
+      m_offset.assign( bands.size(), 0 );
+      return;
+   }
+
+   // Bin k is centered on k * width and covers half a bin to each side
+   const double width = binWidth( binCount, sampleRate );
+   for ( const auto& band : bands )
+   {
+      m_first.push_back( 0 );
+      m_count.push_back( 0 );
+      m_offset.push_back( uint32_t( m_weights.size() ) );
+      if ( !band.isValid() )
+      {
+         continue;
+      }
+
+      const double firstBin = std::max( 0.0, std::floor( band.lowHz / width + 0.5 ) );
+      const double endBin = std::min( double( binCount ), std::ceil( band.highHz / width + 0.5 ) );
+
+      double sum = 0.0;
+      for ( double k = firstBin; k < endBin; k += 1.0 )
+      {
+         const double covered = std::min( band.highHz, ( k + 0.5 ) * width ) - std::max( band.lowHz, ( k - 0.5 ) * width );
+         if ( covered <= width * 1e-6 )
+         {
+            // Only touches the edge, not part of the band
+            if ( 0 == m_count.back() )
+            {
+               continue;
+            }
+            break;
+         }
+
+         if ( 0 == m_count.back() )
+         {
+            m_first.back() = uint32_t( k );
+         }
+         m_weights.push_back( float( covered ) );
+         ++m_count.back();
+         sum += covered;
+      }
+
+      for ( uint32_t i = 0; i < m_count.back(); ++i )
+      {
+         m_weights[ m_offset.back() + i ] = float( m_weights[ m_offset.back() + i ] / sum );
+      }
+   }
+}
+
+
+void CBandLayout::apply( const float *frame, float *values ) const
+{
+   const float* weights = m_weights.data();
+   for ( std::size_t band = 0; band < m_first.size(); ++band )
+   {
+      const float* bins = frame + m_first[ band ];
+      const float* w = weights + m_offset[ band ];
+      float value = 0.0f;
+      for ( uint32_t i = 0; i < m_count[ band ]; ++i )
+      {
+         value += bins[ i ] * w[ i ];
+      }
+      values[ band ] = value;
+   }
+}
+
+
+SpectrumStore CBandLayout::apply( const SpectrumStore &spectrum ) const
+{
+   SpectrumStore result( static_cast<uint32_t>( m_bands.size() ) );
+   result.setSampleRate( spectrum.sampleRate() );
+   result.reserve( spectrum.size() );
+
+   std::vector<float> values( size() );
+   for ( std::size_t i = 0; i < spectrum.size(); ++i )
+   {
+      apply( spectrum.frame( i ).data(), values.data() );
+      result.append( spectrum.position( i ), values.data() );
+   }
+   return result;
+}
+
+
+CBandLayout::Band CBandLayout::binBand( uint32_t index, uint32_t binCount, uint32_t sampleRate )
+{
+   const double width = binWidth( std::max<uint32_t>( binCount, 1 ), sampleRate );
+   Band band;
+   band.lowHz = ( index - 0.5 ) * width;
+   band.highHz = ( index + 0.5 ) * width;
+   return band;
+}
+
+
+CBandLayout::Band CBandLayout::spectrumIndexBand( uint32_t index, uint32_t sampleRate )
+{
+   return binBand( index, cFFTSize, sampleRate );
+}
+
+
+std::vector<CBandLayout::Band> CBandLayout::thirdOctaveBands( double maxHz )
+{
+   // Base 2 centers 1000 * 2^( n / 3 ), n = -16 is the 25 Hz band
+   std::vector<Band> bands;
+   for ( int n = -16; ; ++n )
+   {
+      const double center = 1000.0 * std::pow( 2.0, n / 3.0 );
+      if ( center >= maxHz )
+      {
+         break;
+      }
+
+      Band band;
+      band.lowHz = center * std::pow( 2.0, -1.0 / 6.0 );
+      band.highHz = std::min( center * std::pow( 2.0, 1.0 / 6.0 ), maxHz );
+      bands.push_back( band );
+   }
+   return bands;
+}
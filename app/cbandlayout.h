@@ -0,0 +1,71 @@
+#ifndef CBANDLAYOUT_H
+#define CBANDLAYOUT_H
+
+#include <cstdint>
+#include <vector>
+#include "SpectrumStore.h"
+
+/**
+ * Turns linear FFT bins into frequency bands. Every band is the weighted
+ * mean of the bins it covers, a bin partly inside the range counts with
+ * the covered part. Weights are computed once per layout, so a frame is
+ * one pass over the covered bins for all bands together.
+ *
+ * A band of exactly one bin gives the raw bin value, so a channel without
+ * a frequency range behaves as with a spectrum index.
+ */
+class CBandLayout
+{
+public:
+
+   struct Band
+   {
+      double lowHz = 0.0;
+      double highHz = 0.0;
+
+      bool isValid() const { return highHz > lowHz; }
+      bool operator==( const Band& other ) const { return lowHz == other.lowHz && highHz == other.highHz; }
+      bool operator!=( const Band& other ) const { return !( *this == other ); }
+   };
+
+   CBandLayout() = default;
+
+   // sampleRate 0 means unknown, cDefaultSampleRate is assumed
+   CBandLayout( const std::vector<Band>& bands, uint32_t binCount, uint32_t sampleRate );
+
+   std::size_t size() const { return m_bands.size(); }
+   uint32_t binCount() const { return m_binCount; }
+   uint32_t sampleRate() const { return m_sampleRate; }
+   const std::vector<Band>& bands() const { return m_bands; }
+
+   // frame: binCount() values, values: size() values
+   void apply( const float* frame, float* values ) const;
+
+   // Same positions, one value per band instead of per bin
+   SpectrumStore apply( const SpectrumStore& spectrum ) const;
+
+   // Range covered by a single FFT bin
+   static Band binBand( uint32_t index, uint32_t binCount, uint32_t sampleRate );
+
+   // Range of a channel spectrum index, a bin of the cFFTSize bins of the
+   // live spectrum it is picked on, whatever FFT size it is applied to
+   static Band spectrumIndexBand( uint32_t index, uint32_t sampleRate );
+
+   // ISO 1/3-octave bands, 25 Hz up to maxHz
+   static std::vector<Band> thirdOctaveBands( double maxHz );
+
+private:
+
+   std::vector<Band> m_bands;
+   uint32_t m_binCount = 0;
+   uint32_t m_sampleRate = 0;
+
+   // Band i covers bins [ m_first[ i ], m_first[ i ] + m_count[ i ] ),
+   // their weights start at m_offset[ i ] and sum up to 1
+   std::vector<uint32_t> m_first;
+   std::vector<uint32_t> m_count;
+   std::vector<uint32_t> m_offset;
+   std::vector<float> m_weights;
+};
+
+#endif // CBANDLAYOUT_H
@@ -0,0 +1,268 @@
+#include "cbeatdetector.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace
+{
+
+constexpr double cMinBpm = 60.0;
+constexpr double cMaxBpm = 200.0;
+constexpr double cPreferredBpm = 120.0;
+constexpr double cTempoOctaveWidth = 1.0;   // deviation of the tempo weight, in octaves
+constexpr double cBeatTightness = 100.0;    // penalty for beat intervals off the period
+constexpr double cLogCompression = 100.0;
+constexpr double cMeanWindowMs = 1000.0;    // local mean removed from the flux
+constexpr double cPeakWindowMs = 50.0;      // an onset is the largest value in +- this
+constexpr double cOnsetThreshold = 0.5;     // in standard deviations of the onset strength
+constexpr std::size_t cMinFrames = 64;
+
+
+// Lag of the strongest weighted autocorrelation, in frames, 0 if there is no tempo
+double estimatePeriod( const std::vector<float>& strength, double periodMs )
+{
+   const std::size_t minLag = std::max<std::size_t>( 1, std::size_t( std::floor( 60000.0 / cMaxBpm / periodMs ) ) );
+   const std::size_t maxLag = std::size_t( std::ceil( 60000.0 / cMinBpm / periodMs ) );
+   if ( maxLag + 2 >= strength.size() )
+   {
+      return 0.0;
+   }
+
+   std::vector<double> score( maxLag + 2, 0.0 );
+   for ( std::size_t lag = minLag; lag <= maxLag + 1; ++lag )
+   {
+      double sum = 0.0;
+      for ( std::size_t i = lag; i < strength.size(); ++i )
+      {
+         sum += double( strength[ i ] ) * strength[ i - lag ];
+      }
+
+      const double bpm = 60000.0 / ( lag * periodMs );
+      const double octaves = std::log2( bpm / cPreferredBpm ) / cTempoOctaveWidth;
+      score[ lag ] = sum / ( strength.size() - lag ) * std::exp( -0.5 * octaves * octaves );
+   }
+
+   std::size_t best = minLag;
+   for ( std::size_t lag = minLag; lag <= maxLag; ++lag )
+   {
+      if ( score[ lag ] > score[ best ] )
+      {
+         best = lag;
+      }
+   }
+
+   if ( score[ best ] <= 0.0 )
+   {
+      return 0.0;
+   }
+
+   // Parabolic interpolation, the true period is rarely a whole number of frames
+   double lag = double( best );
+   if ( best > minLag )
+   {
+      const double a = score[ best - 1 ];
+      const double b = score[ best ];
+      const double c = score[ best + 1 ];
+      const double denominator = a - 2.0 * b + c;
+      if ( denominator < 0.0 )
+      {
+         lag += 0.5 * ( a - c ) / denominator;
+      }
+   }
+   return lag;
+}
+
+
+std::vector<std::size_t> trackBeats( const std::vector<float>& strength, double period )
+{
+   const std::size_t count = strength.size();
+   std::vector<double> cumulative( strength.begin(), strength.end() );
+   std::vector<std::ptrdiff_t> previous( count, -1 );
+
+   for ( std::size_t i = 0; i < count; ++i )
+   {
+      const std::ptrdiff_t from = std::ptrdiff_t( i ) - std::ptrdiff_t( std::round( 2.0 * period ) );
+      const std::ptrdiff_t to = std::ptrdiff_t( i ) - std::ptrdiff_t( std::round( 0.5 * period ) );
+
+      // A beat only continues a chain that adds to its score, otherwise it is the first one
+      double best = 0.0;
+      for ( std::ptrdiff_t j = std::max<std::ptrdiff_t>( from, 0 ); j <= to; ++j )
+      {
+         const double deviation = std::log( ( std::ptrdiff_t( i ) - j ) / period );
+         const double candidate = cumulative[ j ] - cBeatTightness * deviation * deviation;
+         if ( candidate > best )
+         {
+            best = candidate;
+            previous[ i ] = j;
+         }
+      }
+      cumulative[ i ] += best;
+   }
+
+   // Last beat is the best one within the final period
+   const std::size_t tail = std::min( count, std::size_t( std::ceil( period ) ) );
+   std::size_t last = count - tail;
+   for ( std::size_t i = count - tail; i < count; ++i )
+   {
+      if ( cumulative[ i ] > cumulative[ last ] )
+      {
+         last = i;
+      }
+   }
+
+   std::vector<std::size_t> beats;
+   for ( std::ptrdiff_t i = std::ptrdiff_t( last ); i >= 0; i = previous[ i ] )
+   {
+      beats.push_back( std::size_t( i ) );
+   }
+   std::reverse( beats.begin(), beats.end() );
+   return beats;
+}
+
+}
+
+
+int64_t BeatTrack::sinceLastBeat( uint64_t position ) const
+{
+   auto it = std::upper_bound( beats.begin(), beats.end(), position );
+   if ( it == beats.begin() )
+   {
+      return -1;
+   }
+   return int64_t( position - *( it - 1 ) );
+}
+
+
+void CBeatDetector::append( uint64_t position, const float *bins, uint32_t binCount )
+{
+   m_current.resize( binCount );
+   for ( uint32_t k = 0; k < binCount; ++k )
+   {
+      m_current[ k ] = std::log1p( cLogCompression * std::max( bins[ k ], 0.0f ) );
+   }
+
+   float sum = 0.0f;
+   if ( m_previous.size() == binCount )
+   {
+      for ( uint32_t k = 0; k < binCount; ++k )
+      {
+         sum += std::max( m_current[ k ] - m_previous[ k ], 0.0f );
+      }
+   }
+
+   m_positions.push_back( position );
+   m_flux.push_back( sum );
+   std::swap( m_previous, m_current );
+}
+
+
+double CBeatDetector::framePeriod() const
+{
+   if ( m_positions.size() < 2 )
+   {
+      return 0.0;
+   }
+   return double( m_positions.back() - m_positions.front() ) / ( m_positions.size() - 1 );
+}
+
+
+std::vector<float> CBeatDetector::onsetStrength() const
+{
+   const std::size_t count = m_flux.size();
+   if ( count < 2 )
+   {
+      return std::vector<float>( count, 0.0f );
+   }
+
+   // Remove the local mean, so loud passages do not count as onsets by themselves
+   const double periodMs = framePeriod();
+   const std::size_t half = std::max<std::size_t>( 1, std::size_t( cMeanWindowMs / 2.0 / std::max( periodMs, 1.0 ) ) );
+   std::vector<double> prefix( count + 1, 0.0 );
+   for ( std::size_t i = 0; i < count; ++i )
+   {
+      prefix[ i + 1 ] = prefix[ i ] + m_flux[ i ];
+   }
+
+   std::vector<float> strength( count );
+   for ( std::size_t i = 0; i < count; ++i )
+   {
+      const std::size_t from = i > half ? i - half : 0;
+      const std::size_t to = std::min( count, i + half + 1 );
+      const double mean = ( prefix[ to ] - prefix[ from ] ) / ( to - from );
+      strength[ i ] = float( std::max( m_flux[ i ] - mean, 0.0 ) );
+   }
+
+   // Unit standard deviation, thresholds and the beat tightness do not depend on the level
+   const double sum = std::accumulate( strength.begin(), strength.end(), 0.0 );
+   const double mean = sum / count;
+   double variance = 0.0;
+   for ( auto value : strength )
+   {
+      variance += ( value - mean ) * ( value - mean );
+   }
+   const double deviation = std::sqrt( variance / count );
+   if ( deviation > 0.0 )
+   {
+      for ( auto& value : strength )
+      {
+         value = float( value / deviation );
+      }
+   }
+
+   return strength;
+}
+
+
+BeatTrack CBeatDetector::detect() const
+{
+   BeatTrack track;
+   const double periodMs = framePeriod();
+   if ( m_positions.size() < cMinFrames || periodMs <= 0.0 )
+   {
+      return track;
+   }
+
+   const std::vector<float> strength = onsetStrength();
+
+   const std::size_t peakHalf = std::max<std::size_t>( 1, std::size_t( cPeakWindowMs / periodMs ) );
+   for ( std::size_t i = 1; i + 1 < strength.size(); ++i )
+   {
+      if ( strength[ i ] < cOnsetThreshold )
+      {
+         continue;
+      }
+
+      const std::size_t from = i > peakHalf ? i - peakHalf : 0;
+      const std::size_t to = std::min( strength.size(), i + peakHalf + 1 );
+      const auto peak = std::max_element( strength.begin() + from, strength.begin() + to );
+      if ( std::size_t( peak - strength.begin() ) == i )
+      {
+         track.onsets.push_back( m_positions[ i ] );
+      }
+   }
+
+   const double period = estimatePeriod( strength, periodMs );
+   if ( period <= 0.0 )
+   {
+      return track;
+   }
+
+   track.bpm = 60000.0 / ( period * periodMs );
+   for ( auto index : trackBeats( strength, period ) )
+   {
+      track.beats.push_back( m_positions[ index ] );
+   }
+
+   return track;
+}
+
+
+BeatTrack CBeatDetector::detect( const SpectrumStore &spectrum )
+{
+   CBeatDetector detector;
+   for ( std::size_t i = 0; i < spectrum.size(); ++i )
+   {
+      detector.append( spectrum.position( i ), spectrum.frame( i ).data(), spectrum.binCount() );
+   }
+   return detector.detect();
+}
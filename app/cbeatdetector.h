@@ -0,0 +1,64 @@
+#ifndef CBEATDETECTOR_H
+#define CBEATDETECTOR_H
+
+#include <cstdint>
+#include <vector>
+#include "SpectrumStore.h"
+
+/**
+ * Beats and onsets of a whole track, positions are in milliseconds like
+ * the spectrum frames they were found in.
+ */
+struct BeatTrack
+{
+   double bpm = 0.0;                 // 0 if no tempo was found
+   std::vector<uint64_t> beats;
+   std::vector<uint64_t> onsets;
+
+   bool isEmpty() const { return beats.empty() && onsets.empty(); }
+
+   // Milliseconds since the last beat at or before position, -1 if there is none
+   int64_t sinceLastBeat( uint64_t position ) const;
+};
+
+
+/**
+ * Offline onset and tempo detection over an analysed spectrum.
+ *
+ * Onset strength is the log-compressed, half-wave rectified spectral flux
+ * with its local mean removed. Onsets are its local peaks. Tempo is the
+ * strongest autocorrelation lag of the onset strength between 60 and 200
+ * BPM, weighted toward 120 BPM, and beats are placed by dynamic
+ * programming: every beat sits on strong onsets and is close to one
+ * period after the previous one.
+ */
+class CBeatDetector
+{
+public:
+
+   CBeatDetector() = default;
+
+   // Frames in order of position. Only the flux of every frame is kept, so
+   // a streamed track costs a few bytes per frame instead of its spectrum.
+   void append( uint64_t position, const float* bins, uint32_t binCount );
+
+   BeatTrack detect() const;
+
+   // Normalized onset strength, one value per appended frame
+   std::vector<float> onsetStrength() const;
+
+   static BeatTrack detect( const SpectrumStore& spectrum );
+
+private:
+
+   // Average frame distance in ms, frames are equally spaced by the analysis hop
+   double framePeriod() const;
+
+private:
+   std::vector<uint64_t> m_positions;
+   std::vector<float> m_flux;
+   std::vector<float> m_previous;    // log-compressed bins of the last frame
+   std::vector<float> m_current;
+};
+
+#endif // CBEATDETECTOR_H
@@ -0,0 +1,227 @@
+#include "ce131output.h"
+#include <QDebug>
+#include <QUuid>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include "coutputlog.h"
+#include "ctrace.h"
+
+constexpr uint8_t  cE131Priority = 100;
+constexpr uint8_t  cOptionStreamTerminated = 0x40;
+constexpr int      cTerminationPackets = 3;
+constexpr uint32_t cNominalVoltage = 220;
+constexpr char     cSourceName[] = "RamaLight";
+const QString      cMulticastHost( "multicast" );
+
+// Offsets in the data packet, ANSI E1.31-2016
+constexpr std::size_t cOffsetRootLength = 16;
+constexpr std::size_t cOffsetFramingLength = 38;
+constexpr std::size_t cOffsetSourceName = 44;
+constexpr std::size_t cOffsetPriority = 108;
+constexpr std::size_t cOffsetSequence = 111;
+constexpr std::size_t cOffsetOptions = 112;
+constexpr std::size_t cOffsetUniverse = 113;
+constexpr std::size_t cOffsetDmpLength = 115;
+constexpr std::size_t cOffsetSlots = 126;
+
+constexpr std::size_t cInvalidSlot = std::numeric_limits<std::size_t>::max();
+
+// Definitions of the class constants, C++14 needs them once they are bound to a reference
+constexpr std::size_t CE131Output::cSlotsPerUniverse;
+constexpr std::size_t CE131Output::cPacketSize;
+constexpr uint32_t CE131Output::cKeepAliveMs;
+constexpr uint16_t CE131Output::cPort;
+
+static void writeBigEndian16( uint8_t* data, uint16_t value )
+{
+    data[0] = static_cast<uint8_t>( value >> 8 );
+    data[1] = static_cast<uint8_t>( value );
+}
+
+// PDU flags and length, the length counts from the field to the end of the packet
+static void writeFlagsAndLength( uint8_t* packet, std::size_t offset )
+{
+    writeBigEndian16( packet + offset, static_cast<uint16_t>( 0x7000 | ( CE131Output::cPacketSize - offset ) ) );
+}
+
+CE131Output::CE131Output( const OutputPort &port )
+    : m_name( cOutputTypeE131Name + " " + port.name )
+    , m_isMulticast( 0 == port.name.compare( cMulticastHost, Qt::CaseInsensitive ) )
+    , m_cid( QUuid::createUuid().toRfc4122() )
+{
+    const QString& host = port.address.isEmpty() ? port.name : port.address;
+    if ( !m_isMulticast && !m_address.setAddress( host ) )
+    {
+        qDebug() << "E1.31 host" << port.name << "is not resolved";
+    }
+}
+
+CE131Output::~CE131Output()
+{
+    if ( !isOpen() )
+    {
+        return;
+    }
+
+    for ( auto& universe : m_universes )
+    {
+        universe.packet[ cOffsetOptions ] = cOptionStreamTerminated;
+        for ( int i = 0; i < cTerminationPackets; ++i )
+        {
+            send( universe, Clock::now() );
+        }
+    }
+}
+
+void CE131Output::setLog( COutputLog *log, uint8_t index )
+{
+    m_log = log;
+    m_logIndex = index;
+}
+
+bool CE131Output::isHostName( const QString &host )
+{
+    QHostAddress address;
+    return 0 != host.compare( cMulticastHost, Qt::CaseInsensitive ) && !address.setAddress( host );
+}
+
+static QHostAddress multicastGroup( uint32_t universe )
+{
+    return QHostAddress( ( 239u << 24 ) | ( 255u << 16 ) | universe );
+}
+
+QHostAddress CE131Output::destination( const OutputPort &port, const uint8_t *packet, std::size_t size )
+{
+    if ( 0 == port.name.compare( cMulticastHost, Qt::CaseInsensitive ) )
+    {
+        if ( size < cOffsetUniverse + 2 )
+        {
+            return QHostAddress();
+        }
+        return multicastGroup( uint32_t( packet[ cOffsetUniverse ] ) << 8 | packet[ cOffsetUniverse + 1 ] );
+    }
+
+    QHostAddress address;
+    address.setAddress( port.address.isEmpty() ? port.name : port.address );
+    return address;
+}
+
+std::size_t CE131Output::slot( const Channel& dmxChannel )
+{
+    const uint32_t unit = dmxChannel.unit;
+    const uint32_t channel = dmxChannel.channel;
+    if ( 0 == channel || channel > cSlotsPerUniverse || 0 == unit )
+    {
+        qWarning() << "Channel" << channel << "of universe" << unit << "is out of the" << cSlotsPerUniverse << "DMX slots";
+        return cInvalidSlot;
+    }
+
+    auto it = std::find_if( m_universes.begin(), m_universes.end(), [unit]( const Universe& universe ){
+        return universe.number == unit;
+    });
+
+    if ( m_universes.end() == it )
+    {
+        Universe universe;
+        universe.number = static_cast<uint16_t>( unit );
+        universe.address = m_isMulticast ? multicastGroup( unit ) : m_address;
+        universe.encoders.assign( cSlotsPerUniverse, CIntensityEncoder::get( CIntensityEncoder::EFormat::DMX, cNominalVoltage ) );
+        initPacket( universe );
+        m_universes.push_back( universe );
+        it = m_universes.end() - 1;
+    }
+
+    it->encoders[ channel - 1 ] = CIntensityEncoder::get( CIntensityEncoder::EFormat::DMX, dmxChannel.voltage, dmxChannel.curve );
+    return std::size_t( it - m_universes.begin() ) * cSlotsPerUniverse + ( channel - 1 );
+}
+
+void CE131Output::initPacket( Universe &universe ) const
+{
+    static const uint8_t cRootLayer[] = {
+        0x00, 0x10, 0x00, 0x00,                                     // preamble and postamble size
+        'A', 'S', 'C', '-', 'E', '1', '.', '1', '7', 0x00, 0x00, 0x00
+    };
+
+    uint8_t* packet = universe.packet.data();
+    universe.packet.fill( 0 );
+
+    std::memcpy( packet, cRootLayer, sizeof( cRootLayer ) );
+    writeFlagsAndLength( packet, cOffsetRootLength );
+    packet[ 21 ] = 0x04;                                            // VECTOR_ROOT_E131_DATA
+    std::memcpy( packet + 22, m_cid.constData(), std::min<std::size_t>( 16, m_cid.size() ) );
+
+    writeFlagsAndLength( packet, cOffsetFramingLength );
+    packet[ 43 ] = 0x02;                                            // VECTOR_E131_DATA_PACKET
+    std::memcpy( packet + cOffsetSourceName, cSourceName, sizeof( cSourceName ) );
+    packet[ cOffsetPriority ] = cE131Priority;
+    writeBigEndian16( packet + cOffsetUniverse, universe.number );
+
+    writeFlagsAndLength( packet, cOffsetDmpLength );
+    packet[ 117 ] = 0x02;                                           // VECTOR_DMP_SET_PROPERTY
+    packet[ 118 ] = 0xa1;                                           // address and data type
+    writeBigEndian16( packet + 121, 0x0001 );                       // address increment
+    writeBigEndian16( packet + 123, static_cast<uint16_t>( cSlotsPerUniverse + 1 ) );
+    // start code and slots stay 0
+}
+
+void CE131Output::queueIntensity( std::size_t slot, double intensity, Clock::time_point /*now*/ )
+{
+    if ( cInvalidSlot == slot )
+    {
+        return;
+    }
+
+    Universe& universe = m_universes[ slot / cSlotsPerUniverse ];
+    const uint8_t value = universe.encoders[ slot % cSlotsPerUniverse ].encode( intensity );
+    uint8_t& data = universe.packet[ cOffsetSlots + slot % cSlotsPerUniverse ];
+    if ( data != value )
+    {
+        data = value;
+        universe.isChanged = true;
+    }
+}
+
+void CE131Output::endFrame( Clock::time_point now )
+{
+    if ( !isOpen() )
+    {
+        return;
+    }
+
+    for ( auto& universe : m_universes )
+    {
+        if ( universe.isChanged || now - universe.sentAt >= std::chrono::milliseconds( cKeepAliveMs ) )
+        {
+            send( universe, now );
+        }
+    }
+}
+
+void CE131Output::send( Universe &universe, Clock::time_point now )
+{
+    universe.packet[ cOffsetSequence ] = universe.sequence++;
+
+    const auto written = m_socket.writeDatagram( reinterpret_cast<const char*>( universe.packet.data() ),
+                                                 static_cast<qint64>( universe.packet.size() ),
+                                                 universe.address, cPort );
+    if ( written < 0 )
+    {
+        if ( !m_isErrorReported )
+        {
+            qDebug() << "E1.31 send failed:" << m_name << m_socket.errorString();
+            m_isErrorReported = true;
+        }
+        return;
+    }
+
+    m_isErrorReported = false;
+    m_statistics.bytes += static_cast<uint64_t>( written );
+    if ( nullptr != m_log )
+    {
+        m_log->append( m_logIndex, now, universe.packet.data(), universe.packet.size() );
+    }
+    universe.isChanged = false;
+    universe.sentAt = now;
+    TRACE( ETraceCategory::Output, ETraceEvent::E131Send, universe.number, written );
+}
@@ -0,0 +1,100 @@
+#ifndef CE131OUTPUT_H
+#define CE131OUTPUT_H
+
+#include <QByteArray>
+#include <QHostAddress>
+#include <QString>
+#include <QUdpSocket>
+#include <array>
+#include <vector>
+#include "CConfiguration.h"
+#include "IOutputBackend.h"
+
+/**
+ * E1.31 (sACN) backend, DMX over UDP for the props a serial line can not
+ * keep up with.
+ *
+ * Every unit of the output is a universe of 512 slots, channel n of the
+ * unit is slot n. Each universe has its data packet allocated and filled
+ * with the constant layers when its first channel is compiled, a frame only
+ * writes the slot values, a sequence number and sends. A universe goes out
+ * when one of its slots changed or its last packet is older than the
+ * E1.31 keep-alive of cKeepAliveMs, well inside the 2.5 s after which
+ * receivers drop a source. Neither the LOR refresh period nor the LOR
+ * hysteresis apply, DMX has no level commands to save.
+ *
+ * The host "multicast" sends each universe to its E1.31 multicast group.
+ * Any other host is an IPv4 address, or a name the GUI resolved into
+ * OutputPort::address; the output thread never waits for a name lookup.
+ * On destruction the receivers are told that the streams terminated.
+ *
+ * Every datagram sent is one write of the COutputLog.
+ */
+class CE131Output : public IOutputBackend
+{
+public:
+
+   CE131Output( const OutputPort& port );
+   ~CE131Output() override;
+
+   const QString& name() const override { return m_name; }
+   bool isOpen() const override { return m_isMulticast || !m_address.isNull(); }
+   const Statistics& statistics() const override { return m_statistics; }
+
+   // The LOR change suppression does not apply to E1.31
+   void setDeltaParams( uint32_t /*hysteresis*/, std::chrono::milliseconds /*refreshPeriod*/ ) override {}
+
+   void setLog( COutputLog* log, uint8_t index ) override;
+
+   std::size_t slot( const Channel& channel ) override;
+
+   void beginFrame( Clock::time_point /*now*/ ) override {}
+
+   void queueIntensity( std::size_t slot, double intensity, Clock::time_point now ) override;
+
+   void endFrame( Clock::time_point now ) override;
+
+   // True if host is neither an IPv4 address nor "multicast" and has to be resolved
+   static bool isHostName( const QString& host );
+
+   // Destination of a data packet of port, null if the host is not resolved
+   static QHostAddress destination( const OutputPort& port, const uint8_t* packet, std::size_t size );
+
+   static constexpr std::size_t cSlotsPerUniverse = 512;
+   static constexpr uint32_t cKeepAliveMs = 800;
+   static constexpr uint16_t cPort = 5568;
+   static constexpr std::size_t cPacketSize = 126 + cSlotsPerUniverse;
+
+private:
+
+   struct Universe
+   {
+      uint16_t number;
+      QHostAddress address;
+      std::array<uint8_t, cPacketSize> packet;
+      std::vector<CIntensityEncoder> encoders;    // per slot
+      uint8_t sequence = 0;
+      bool isChanged = true;
+      Clock::time_point sentAt;
+   };
+
+   void initPacket( Universe& universe ) const;
+   void send( Universe& universe, Clock::time_point now );
+
+private:
+
+   QString m_name;
+   bool m_isMulticast;
+   QHostAddress m_address;
+   QUdpSocket m_socket;
+   QByteArray m_cid;                  // component identifier, one per output
+
+   std::vector<Universe> m_universes;
+   bool m_isErrorReported = false;
+   Statistics m_statistics;
+
+   COutputLog* m_log = nullptr;
+   uint8_t m_logIndex = 0;
+};
+
+#endif // CE131OUTPUT_H
@@ -70,13 +70,24 @@ void CEffectEditorWidget::setCurrentSequense(std::weak_ptr<CLightSequence> seque
          timeLineChannel->setColor( channel.color );
 
 
-         connect( timeLineChannel, &CTimeLineChannel::effectAdded, [ channelConfiguration ]( ITimeLineChannel*, IEffect* effect )
+         connect( timeLineChannel, &CTimeLineChannel::effectAdded, [ channelConfiguration, this ]( ITimeLineChannel*, IEffect* effect )
          {
             assert( nullptr != effect );
-            if ( channelConfiguration->effects.end() == channelConfiguration->effects.find( effect->getUuid() ) )
+            // Effects of the sequense are added again whenever the timeline is rebuilt
+            const bool isNew = channelConfiguration->effects.end() == channelConfiguration->effects.find( effect->getUuid() );
+            if ( isNew )
             {
                channelConfiguration->effects.insert( { effect->getUuid(), effect->getEffectGenerator() } );
             }
+
+            if ( auto sequensePtr = currentSequense.lock() )
+            {
+               effect->setTrack( sequensePtr->getSpectrum(), sequensePtr->getBeats() );
+               if ( isNew )
+               {
+                  sequensePtr->notifyEffectChanged( effect->getUuid() );
+               }
+            }
          } );
 
          connect( timeLineChannel, &CTimeLineChannel::effectRemoved,  [ channelConfiguration, this ]( ITimeLineChannel* tlChannel, QUuid uuid )
@@ -88,6 +99,10 @@ void CEffectEditorWidget::setCurrentSequense(std::weak_ptr<CLightSequence> seque
             {
                channelConfiguration->effects.erase( effectIt );
             }
+            if ( auto sequensePtr = currentSequense.lock() )
+            {
+               sequensePtr->notifyEffectChanged( uuid );
+            }
             if ( uuid == this->configurationWidgetEffectUuid )
             {
                 if ( nullptr != configurationWidget )
@@ -113,6 +128,27 @@ void CEffectEditorWidget::setCurrentSequense(std::weak_ptr<CLightSequence> seque
          connect( timeLineChannel, &CTimeLineChannel::effectSelected, updateWidgetConfiguration );
          connect( timeLineChannel, &CTimeLineChannel::effectChanged, updateWidgetConfiguration );
 
+         // Moves, resizes and parameter edits reach the live output
+         auto effectEdited = [ this ]( ITimeLineChannel*, IEffect* effect )
+         {
+            if ( auto sequensePtr = currentSequense.lock() )
+            {
+               sequensePtr->notifyEffectChanged( effect->getUuid() );
+            }
+         };
+
+         connect( timeLineChannel, &CTimeLineChannel::effectChanged, effectEdited );
+         connect( timeLineChannel, &CTimeLineChannel::effectParametersChanged, effectEdited );
+
+         // The live copies keep their effect and take the new values
+         connect( timeLineChannel, &CTimeLineChannel::effectRendered, [ this ]( ITimeLineChannel*, IEffect* )
+         {
+            if ( auto sequensePtr = currentSequense.lock() )
+            {
+               sequensePtr->notifyConfigurationChanged();
+            }
+         } );
+
          for ( auto& effect :  channelConfiguration->effects )
          {
             new CTimeLineEffect( timeLineChannel, effect.second );
@@ -121,6 +157,32 @@ void CEffectEditorWidget::setCurrentSequense(std::weak_ptr<CLightSequence> seque
    }
 
 
+   // Effects render ahead over the analysed track as soon as it is there
+   auto analysisFinished = [ this ]( std::weak_ptr<CLightSequence> sequense )
+   {
+      auto sequensePtr = sequense.lock();
+      if ( nullptr == sequensePtr || currentSequense.lock() != sequensePtr )
+      {
+         return;
+      }
+
+      for ( auto channel : timeline->channels() )
+      {
+         for ( auto effect : channel->effects() )
+         {
+            effect->setTrack( sequensePtr->getSpectrum(), sequensePtr->getBeats() );
+         }
+      }
+   };
+
+   m_spectrumConnections.push_back(
+            std::shared_ptr<QMetaObject::Connection>(
+               new QMetaObject::Connection( connect( sequensePtr.get(), &CLightSequence::analysisFinished, analysisFinished ) ), deleter )
+            );
+
+   analysisFinished( sequensePtr );
+   sequensePtr->startBeatDetection();
+
    auto playPositionChanged = [ this ]( const SpectrumData& spectrum )
    {
       timeline->setCompositionPosition( spectrum.position );
@@ -0,0 +1,335 @@
+#include "cfftengine.h"
+#include <cmath>
+#include "constants.h"
+
+#if defined( __AVX2__ )
+#include <immintrin.h>
+#elif defined( __SSE2__ ) || defined( _M_X64 )
+#include <emmintrin.h>
+#define FFT_USE_SSE2
+#endif
+
+namespace
+{
+
+constexpr double cPi = 3.14159265358979323846;
+
+struct WindowName
+{
+   CFFTEngine::EWindow window;
+   const char* name;
+};
+
+constexpr WindowName cWindowNames[] = {
+   { CFFTEngine::EWindow::Hann, "hann" },
+   { CFFTEngine::EWindow::Hamming, "hamming" },
+   { CFFTEngine::EWindow::Blackman, "blackman" },
+   { CFFTEngine::EWindow::Rectangular, "rectangular" },
+};
+
+
+double windowValue( CFFTEngine::EWindow window, uint32_t n, uint32_t size )
+{
+   // Periodic form, the usual choice for spectral analysis
+   const double x = 2.0 * cPi * n / size;
+   switch ( window )
+   {
+   case CFFTEngine::EWindow::Hann:
+      return 0.5 - 0.5 * std::cos( x );
+   case CFFTEngine::EWindow::Hamming:
+      return 0.54 - 0.46 * std::cos( x );
+   case CFFTEngine::EWindow::Blackman:
+      return 0.42 - 0.5 * std::cos( x ) + 0.08 * std::cos( 2.0 * x );
+   case CFFTEngine::EWindow::Rectangular:
+      break;
+   }
+   return 1.0;
+}
+
+
+// One radix-2 stage, butterflies j of every block use twiddle w[ j ]
+void stageScalar( float* re, float* im, const float* wRe, const float* wIm, uint32_t count, uint32_t half )
+{
+   for ( uint32_t start = 0; start < count; start += 2 * half )
+   {
+      float* aRe = re + start;
+      float* aIm = im + start;
+      float* bRe = aRe + half;
+      float* bIm = aIm + half;
+      for ( uint32_t j = 0; j < half; ++j )
+      {
+         const float tRe = wRe[ j ] * bRe[ j ] - wIm[ j ] * bIm[ j ];
+         const float tIm = wRe[ j ] * bIm[ j ] + wIm[ j ] * bRe[ j ];
+         bRe[ j ] = aRe[ j ] - tRe;
+         bIm[ j ] = aIm[ j ] - tIm;
+         aRe[ j ] += tRe;
+         aIm[ j ] += tIm;
+      }
+   }
+}
+
+
+void magnitudesScalar( const float* re, const float* im, float* out, uint32_t begin, uint32_t count )
+{
+   for ( uint32_t i = begin; i < count; ++i )
+   {
+      out[ i ] = std::sqrt( re[ i ] * re[ i ] + im[ i ] * im[ i ] );
+   }
+}
+
+
+#if defined( __AVX2__ )
+
+constexpr uint32_t cLanes = 8;
+
+void stageVector( float* re, float* im, const float* wRe, const float* wIm, uint32_t count, uint32_t half )
+{
+   for ( uint32_t start = 0; start < count; start += 2 * half )
+   {
+      float* aRe = re + start;
+      float* aIm = im + start;
+      float* bRe = aRe + half;
+      float* bIm = aIm + half;
+      for ( uint32_t j = 0; j < half; j += cLanes )
+      {
+         const __m256 twRe = _mm256_loadu_ps( wRe + j );
+         const __m256 twIm = _mm256_loadu_ps( wIm + j );
+         const __m256 xRe = _mm256_loadu_ps( bRe + j );
+         const __m256 xIm = _mm256_loadu_ps( bIm + j );
+         const __m256 tRe = _mm256_sub_ps( _mm256_mul_ps( twRe, xRe ), _mm256_mul_ps( twIm, xIm ) );
+         const __m256 tIm = _mm256_add_ps( _mm256_mul_ps( twRe, xIm ), _mm256_mul_ps( twIm, xRe ) );
+         const __m256 yRe = _mm256_loadu_ps( aRe + j );
+         const __m256 yIm = _mm256_loadu_ps( aIm + j );
+         _mm256_storeu_ps( bRe + j, _mm256_sub_ps( yRe, tRe ) );
+         _mm256_storeu_ps( bIm + j, _mm256_sub_ps( yIm, tIm ) );
+         _mm256_storeu_ps( aRe + j, _mm256_add_ps( yRe, tRe ) );
+         _mm256_storeu_ps( aIm + j, _mm256_add_ps( yIm, tIm ) );
+      }
+   }
+}
+
+void magnitudes( const float* re, const float* im, float* out, uint32_t count )
+{
+   uint32_t i = 0;
+   for ( ; i + cLanes <= count; i += cLanes )
+   {
+      const __m256 r = _mm256_loadu_ps( re + i );
+      const __m256 m = _mm256_loadu_ps( im + i );
+      _mm256_storeu_ps( out + i, _mm256_sqrt_ps( _mm256_add_ps( _mm256_mul_ps( r, r ), _mm256_mul_ps( m, m ) ) ) );
+   }
+   magnitudesScalar( re, im, out, i, count );
+}
+
+#elif defined( FFT_USE_SSE2 )
+
+constexpr uint32_t cLanes = 4;
+
+void stageVector( float* re, float* im, const float* wRe, const float* wIm, uint32_t count, uint32_t half )
+{
+   for ( uint32_t start = 0; start < count; start += 2 * half )
+   {
+      float* aRe = re + start;
+      float* aIm = im + start;
+      float* bRe = aRe + half;
+      float* bIm = aIm + half;
+      for ( uint32_t j = 0; j < half; j += cLanes )
+      {
+         const __m128 twRe = _mm_loadu_ps( wRe + j );
+         const __m128 twIm = _mm_loadu_ps( wIm + j );
+         const __m128 xRe = _mm_loadu_ps( bRe + j );
+         const __m128 xIm = _mm_loadu_ps( bIm + j );
+         const __m128 tRe = _mm_sub_ps( _mm_mul_ps( twRe, xRe ), _mm_mul_ps( twIm, xIm ) );
+         const __m128 tIm = _mm_add_ps( _mm_mul_ps( twRe, xIm ), _mm_mul_ps( twIm, xRe ) );
+         const __m128 yRe = _mm_loadu_ps( aRe + j );
+         const __m128 yIm = _mm_loadu_ps( aIm + j );
+         _mm_storeu_ps( bRe + j, _mm_sub_ps( yRe, tRe ) );
+         _mm_storeu_ps( bIm + j, _mm_sub_ps( yIm, tIm ) );
+         _mm_storeu_ps( aRe + j, _mm_add_ps( yRe, tRe ) );
+         _mm_storeu_ps( aIm + j, _mm_add_ps( yIm, tIm ) );
+      }
+   }
+}
+
+void magnitudes( const float* re, const float* im, float* out, uint32_t count )
+{
+   uint32_t i = 0;
+   for ( ; i + cLanes <= count; i += cLanes )
+   {
+      const __m128 r = _mm_loadu_ps( re + i );
+      const __m128 m = _mm_loadu_ps( im + i );
+      _mm_storeu_ps( out + i, _mm_sqrt_ps( _mm_add_ps( _mm_mul_ps( r, r ), _mm_mul_ps( m, m ) ) ) );
+   }
+   magnitudesScalar( re, im, out, i, count );
+}
+
+#else
+
+// No vector kernel for this target, every stage goes to stageScalar
+constexpr uint32_t cLanes = UINT32_MAX;
+
+void stageVector( float* re, float* im, const float* wRe, const float* wIm, uint32_t count, uint32_t half )
+{
+   stageScalar( re, im, wRe, wIm, count, half );
+}
+
+void magnitudes( const float* re, const float* im, float* out, uint32_t count )
+{
+   magnitudesScalar( re, im, out, 0, count );
+}
+
+#endif
+
+}
+
+
+CFFTEngine::CFFTEngine( uint32_t size, EWindow window )
+   : m_size( isValidSize( size ) ? size : cDefaultFFTSize )
+   , m_window( window )
+{
+   const uint32_t half = m_size / 2;
+
+   // Coherent gain is folded into the window, so magnitudes need no scaling
+   m_windowTable.resize( m_size );
+   double sum = 0.0;
+   for ( uint32_t n = 0; n < m_size; ++n )
+   {
+      sum += windowValue( window, n, m_size );
+   }
+   for ( uint32_t n = 0; n < m_size; ++n )
+   {
+      m_windowTable[ n ] = float( 2.0 * windowValue( window, n, m_size ) / sum );
+   }
+
+   uint32_t bits = 0;
+   while ( ( 1u << bits ) < half )
+   {
+      ++bits;
+   }
+   m_bitReverse.resize( half );
+   for ( uint32_t i = 0; i < half; ++i )
+   {
+      uint32_t reversed = 0;
+      for ( uint32_t b = 0; b < bits; ++b )
+      {
+         reversed |= ( ( i >> b ) & 1u ) << ( bits - 1 - b );
+      }
+      m_bitReverse[ i ] = reversed;
+   }
+
+   m_twiddleRe.resize( half );
+   m_twiddleIm.resize( half );
+   for ( uint32_t stageHalf = 1; stageHalf < half; stageHalf *= 2 )
+   {
+      for ( uint32_t j = 0; j < stageHalf; ++j )
+      {
+         const double angle = -cPi * j / stageHalf;
+         m_twiddleRe[ stageHalf - 1 + j ] = float( std::cos( angle ) );
+         m_twiddleIm[ stageHalf - 1 + j ] = float( std::sin( angle ) );
+      }
+   }
+
+   m_splitRe.resize( half );
+   m_splitIm.resize( half );
+   for ( uint32_t k = 0; k < half; ++k )
+   {
+      const double angle = -2.0 * cPi * k / m_size;
+      m_splitRe[ k ] = float( std::cos( angle ) );
+      m_splitIm[ k ] = float( std::sin( angle ) );
+   }
+
+   m_re.resize( half );
+   m_im.resize( half );
+   m_outRe.resize( half );
+   m_outIm.resize( half );
+}
+
+
+bool CFFTEngine::isValidSize( uint32_t size )
+{
+   return size >= cMinFFTSize && size <= cMaxFFTSize && 0 == ( size & ( size - 1 ) );
+}
+
+
+void CFFTEngine::process( const float* samples, float* magnitudesOut )
+{
+   // Real input of size N is packed as a complex sequence of N / 2:
+   // z[ k ] = x[ 2k ] + i x[ 2k + 1 ], written in bit reversed order
+   const uint32_t half = m_size / 2;
+   float* re = m_re.data();
+   float* im = m_im.data();
+   const float* window = m_windowTable.data();
+   for ( uint32_t k = 0; k < half; ++k )
+   {
+      const uint32_t r = m_bitReverse[ k ];
+      re[ r ] = samples[ 2 * k ] * window[ 2 * k ];
+      im[ r ] = samples[ 2 * k + 1 ] * window[ 2 * k + 1 ];
+   }
+
+   for ( uint32_t stageHalf = 1; stageHalf < half; stageHalf *= 2 )
+   {
+      const float* wRe = m_twiddleRe.data() + stageHalf - 1;
+      const float* wIm = m_twiddleIm.data() + stageHalf - 1;
+      if ( stageHalf >= cLanes )
+      {
+         stageVector( re, im, wRe, wIm, half, stageHalf );
+      }
+      else
+      {
+         stageScalar( re, im, wRe, wIm, half, stageHalf );
+      }
+   }
+
+   // Split into the spectrum of the real input:
+   // X[ k ] = E[ k ] + W^k O[ k ], E = ( Z[ k ] + Z*[ M - k ] ) / 2, O = ( Z[ k ] - Z*[ M - k ] ) / 2i
+   for ( uint32_t k = 0; k < half; ++k )
+   {
+      const uint32_t m = ( half - k ) & ( half - 1 );
+      const float eRe = 0.5f * ( re[ k ] + re[ m ] );
+      const float eIm = 0.5f * ( im[ k ] - im[ m ] );
+      const float oRe = 0.5f * ( im[ k ] + im[ m ] );
+      const float oIm = -0.5f * ( re[ k ] - re[ m ] );
+      m_outRe[ k ] = eRe + m_splitRe[ k ] * oRe - m_splitIm[ k ] * oIm;
+      m_outIm[ k ] = eIm + m_splitRe[ k ] * oIm + m_splitIm[ k ] * oRe;
+   }
+
+   magnitudes( m_outRe.data(), m_outIm.data(), magnitudesOut, half );
+}
+
+
+const char* CFFTEngine::windowName( EWindow window )
+{
+   for ( const auto& entry : cWindowNames )
+   {
+      if ( entry.window == window )
+      {
+         return entry.name;
+      }
+   }
+   return "";
+}
+
+
+bool CFFTEngine::windowFromName( const std::string &name, EWindow &window )
+{
+   for ( const auto& entry : cWindowNames )
+   {
+      if ( name == entry.name )
+      {
+         window = entry.window;
+         return true;
+      }
+   }
+   return false;
+}
+
+
+const char* CFFTEngine::simdName()
+{
+#if defined( __AVX2__ )
+   return "avx2";
+#elif defined( FFT_USE_SSE2 )
+   return "sse2";
+#else
+   return "scalar";
+#endif
+}
@@ -0,0 +1,67 @@
+#ifndef CFFTENGINE_H
+#define CFFTENGINE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Real input FFT on mono float PCM, radix-2, sizes cMinFFTSize..cMaxFFTSize.
+ * Window, twiddles and bit reversal are computed once per engine, so one
+ * engine is reused for a whole track. It does not touch BASS and holds its
+ * own scratch buffers: use one engine per thread.
+ *
+ * Butterflies and magnitudes run on split real/imaginary arrays, 8 lanes
+ * with AVX2 (qmake CONFIG += avx2), 4 lanes with SSE2, scalar elsewhere.
+ */
+class CFFTEngine
+{
+public:
+
+   // Values are stored in configuration and in the spectrum cache key
+   enum class EWindow : uint32_t
+   {
+      Hann = 0,  // BASS_DATA_FFT default
+      Hamming = 1,
+      Blackman = 2,
+      Rectangular = 3
+   };
+
+   CFFTEngine( uint32_t size, EWindow window );
+
+   // Power of two in [cMinFFTSize, cMaxFFTSize]
+   static bool isValidSize( uint32_t size );
+
+   uint32_t size() const { return m_size; }
+   uint32_t binCount() const { return m_size / 2; }
+   EWindow window() const { return m_window; }
+
+   // samples: size() values, magnitudes: binCount() values, bin 0 is DC.
+   // A full scale sine centered on a bin gives 1.0 for every window.
+   void process( const float* samples, float* magnitudes );
+
+   static const char* windowName( EWindow window );
+   static bool windowFromName( const std::string& name, EWindow& window );
+
+   // Instruction set the kernel was built for
+   static const char* simdName();
+
+private:
+
+   uint32_t m_size;
+   EWindow m_window;
+
+   std::vector<float> m_windowTable;      // window, normalized to the coherent gain
+   std::vector<uint32_t> m_bitReverse;    // for the size / 2 complex FFT
+   std::vector<float> m_twiddleRe;        // stage with half h starts at h - 1
+   std::vector<float> m_twiddleIm;
+   std::vector<float> m_splitRe;          // exp( -2 pi i k / size ), k < size / 2
+   std::vector<float> m_splitIm;
+
+   std::vector<float> m_re;
+   std::vector<float> m_im;
+   std::vector<float> m_outRe;
+   std::vector<float> m_outIm;
+};
+
+#endif // CFFTENGINE_H
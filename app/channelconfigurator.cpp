@@ -11,26 +11,18 @@
 #include <QMenu>
 #include <QColorDialog>
 #include <QPushButton>
+#include <QPlainTextEdit>
 #include "widgets/FloatSliderWidget.h"
 #include "constants.h"
 #include "clightsequence.h"
 #include "spectrograph.h"
 
-const std::string configuration("channelConfiguration.json");
-
 // JSON keys
-const QString cKeyChannels( "channels" );
-const QString cKeyLabel( "label" );
-const QString cKeyUnit( "Unit" );
-const QString cKeyChannel( "Channel" );
-const QString cKeyVoltage( "Voltage" );
-const QString cKeySpectrumBarIndex( "SpectrumBarIndex" );
-const QString cKeyGain( "Gain" );
-const QString cKeyFade( "Fade" );
-const QString cKeyColor( "Color" );
-const QString cKeyUUID( "uuid" );
 const QString cKeyPortName( "commPortName" );
 const QString cKeyPortBaudRate( "commPortBaudRate" );
+const QString cKeyUnitPorts( "unitPorts" );
+const QString cKeyPortUnits( "units" );
+const QString cKeyPortType( "type" );
 const QString cKeyIsSchedulerEnabled( "schedulerEnabled" );
 const QString cKeySchedulerStartTime( "schedulerStartTime" );
 const QString cKeySchedulerEndTime( "schedulerEndTime" );
@@ -41,11 +33,13 @@ constexpr int cColumnIndexLabel   = 0;
 constexpr int cColumnIndexUnit    = 1;
 constexpr int cColumnIndexChannel = 2;
 constexpr int cColumnIndexVoltage = 3;
-constexpr int cColumnIndexSpectrumBarIndex = 4;
-constexpr int cColumnIndexGain    = 5;
-constexpr int cColumnIndexFade = 6;
-constexpr int cColumnIndexColor = 7;
-constexpr int cColumnIndexUuid = 8;
+constexpr int cColumnIndexCurve   = 4;
+constexpr int cColumnIndexSpectrumBarIndex = 5;
+constexpr int cColumnIndexBand    = 6;
+constexpr int cColumnIndexGain    = 7;
+constexpr int cColumnIndexFade = 8;
+constexpr int cColumnIndexColor = 9;
+constexpr int cColumnIndexUuid = 10;
 
 
 constexpr int cShowCheckerInterval = 15*1000; // 15 seconds
@@ -61,7 +55,7 @@ ChannelConfigurator::ChannelConfigurator(QWidget *parent)
    ui->setupUi(this);
     connect(ui->tableWidget, &QTableWidget::customContextMenuRequested, this, &ChannelConfigurator::on_tableWidget_customContextMenuRequested);
 
-    ui->tableWidget->setColumnCount(9);
+    ui->tableWidget->setColumnCount(11);
     QHeaderView * header = ui->tableWidget->horizontalHeader();
 
     header->setSectionResizeMode( cColumnIndexLabel, QHeaderView::Stretch);
@@ -83,12 +77,24 @@ ChannelConfigurator::ChannelConfigurator(QWidget *parent)
                         combo->setCurrentIndex(index);
                     }
                 }
+
+                // Picked bar replaces the frequency range
+                auto bandWidget = ui->tableWidget->cellWidget( currentIndex, cColumnIndexBand );
+                if ( auto combo = dynamic_cast< QComboBox* >( bandWidget ) )
+                {
+                    combo->setCurrentText( QString() );
+                }
             }
         }
     } );
 
     ui->verticalLayout_3->addWidget( spectrograph );
 
+    connect( ui->unitPortsEdit, &QPlainTextEdit::textChanged, [this]()
+    {
+        setEnableOkButton( isTableDataValid() );
+    } );
+
     auto widget = new QWidget();
     auto hlayout = new QHBoxLayout();
     hlayout->setContentsMargins(0,0,0,0);
@@ -180,6 +186,8 @@ QDialog::DialogCode ChannelConfigurator::display()
         ui->tableWidget->setItem(       0, cColumnIndexVoltage, new QTableWidgetItem( QString::number(220)) );
         ui->tableWidget->setCellWidget( 0, cColumnIndexColor, prepareColorButton( QColorConstants::Red ));
         ui->tableWidget->setCellWidget( 0, cColumnIndexSpectrumBarIndex, prepareSpectrumCombo( cDefaultSpectrumIndex ));
+        ui->tableWidget->setCellWidget( 0, cColumnIndexBand, prepareBandCombo( CBandLayout::Band() ));
+        ui->tableWidget->setCellWidget( 0, cColumnIndexCurve, prepareCurveCombo( DimmingCurve() ));
         ui->tableWidget->setCellWidget( 0, cColumnIndexUuid, prepareUUIDLabel( QUuid::createUuid() ));
         ui->tableWidget->setCellWidget( 0, cColumnIndexGain, new FloatSliderWidget( cMaxGainValue, cMinGainValue, cDefaultGainValue ) );
         ui->tableWidget->setCellWidget( 0, cColumnIndexFade, new FloatSliderWidget( cMaxFadeValue, cMinFadeValue, cDefaultFadeValue ) );
@@ -209,12 +217,12 @@ QDialog::DialogCode ChannelConfigurator::display()
 
 void ChannelConfigurator::load()
 {
-    QFile persistFile( configuration.c_str() ); //configuration.c_str() );
+    QFile persistFile( cChannelConfigurationFileName );
     if ( persistFile.exists() )
     {
         if (!persistFile.open(QIODevice::ReadOnly))
         {
-            QMessageBox::warning( this, "Warning", QString("Couldn't open channel configuration file: ") + configuration.c_str() );
+            QMessageBox::warning( this, "Warning", QString("Couldn't open channel configuration file: ") + cChannelConfigurationFileName );
             return ;
         }
 
@@ -224,150 +232,7 @@ void ChannelConfigurator::load()
         QJsonDocument loadDoc( QJsonDocument::fromJson(saveData) );
         const QJsonObject &json = loadDoc.object();
 
-        bool isSchemaValid = true;
-        if (json.contains( cKeyChannels ))
-        {
-            QJsonValue channelsValue = json[ cKeyChannels ];
-            QJsonArray channelsJson( channelsValue.toArray() );
-            std::vector<Channel> channelsTmp;
-            channelsTmp.reserve(channelsJson.size());
-            qDebug() << "Json channels count: " << channelsJson.size();
-
-            for ( const auto& jsonChannelValue : channelsJson )
-            {
-                if ( jsonChannelValue.isObject() )
-                {
-                    const QJsonObject &jsonChannel = jsonChannelValue.toObject();
-                    QString label;
-                    if ( jsonChannel.contains( cKeyLabel ) )
-                    {
-                        if ( !jsonChannel[ cKeyLabel ].isString() )
-                        {
-                            isSchemaValid = false;
-                            qWarning() << "Channel '" << cKeyLabel << "' is wrong";
-                        }
-                        else
-                        {
-                            label = jsonChannel[ cKeyLabel ].toString();
-                        }
-                    }
-
-                    uint32_t unit;
-                    if ( jsonChannel.contains( cKeyUnit ) )
-                    {
-                        unit = jsonChannel[ cKeyUnit ].toInt(0);
-                        if ( 0 == unit )
-                        {
-                            isSchemaValid = false;
-                            qWarning() << "Unit number '" << cKeyUnit << "' is wrong";
-                        }
-                    }
-
-                    uint32_t ChannelNumber;
-                    if ( jsonChannel.contains( cKeyChannel) )
-                    {
-                        ChannelNumber = jsonChannel[ cKeyChannel ].toInt(0);
-                        if ( 0 == ChannelNumber )
-                        {
-                            isSchemaValid = false;
-                            qWarning() << "Channel number '" << cKeyChannel << "' is wrong";
-                        }
-                    }
-
-                    uint32_t Voltage;
-                    if ( jsonChannel.contains( cKeyVoltage ) )
-                    {
-                        Voltage = jsonChannel[ cKeyVoltage ].toInt(0);
-                        if ( 0 == Voltage )
-                        {
-                            isSchemaValid = false;
-                            qWarning() << "Voltage number '" << cKeyVoltage << "' is wrong";
-                        }
-                    }
-
-                    uint32_t SpectrumBarIndex;
-                    if ( jsonChannel.contains( cKeySpectrumBarIndex ) )
-                    {
-                        SpectrumBarIndex = jsonChannel[ cKeySpectrumBarIndex ].toInt(0);
-                        if ( 0 == SpectrumBarIndex )
-                        {
-                            isSchemaValid = false;
-                            qWarning() << "Spectrum bar index number '" << cKeySpectrumBarIndex << "' is wrong";
-                        }
-                    }
-
-                    double Gain;
-                    if ( jsonChannel.contains( cKeyGain ) )
-                    {
-                        if ( !jsonChannel[ cKeyGain ].isDouble() )
-                        {
-                            Gain = 1.0;
-                            qWarning() << "Channel Multipler '" << cKeyGain << "' is wrong";
-                        }
-                        else
-                        {
-                            Gain = jsonChannel[ cKeyGain ].toDouble();
-                        }
-                    }
-
-
-                    double Fade;
-                    if ( jsonChannel.contains( cKeyFade ) )
-                    {
-                        if ( !jsonChannel[ cKeyFade ].isDouble() )
-                        {
-                            Fade = 1.0;
-                            qWarning() << "Channel Fade '" << cKeyFade << "' is wrong";
-                        }
-                        else
-                        {
-                            Fade = jsonChannel[ cKeyFade ].toDouble();
-                        }
-                    }
-
-                    QString color;
-                    if ( jsonChannel.contains( cKeyColor ) )
-                    {
-                        if ( !jsonChannel[ cKeyColor ].isString() )
-                        {
-                            isSchemaValid = false;
-                            qWarning() << "Channel '" << cKeyColor << "' is wrong";
-                        }
-                        else
-                        {
-                            color = jsonChannel[ cKeyColor ].toString();
-                        }
-                    }
-
-                    QUuid uuid;
-                    if ( jsonChannel.contains( cKeyUUID ) )
-                    {
-                        if ( !jsonChannel[ cKeyUUID ].isString() )
-                        {
-                            uuid = QUuid::createUuid();
-                            qWarning() << "Channel '" << cKeyUUID << "' is wrong, new generated"<< uuid;
-                        }
-                        else
-                        {
-                            uuid = jsonChannel[ cKeyUUID ].toString();
-                        }
-                    }
-
-                    channelsTmp.emplace_back(label, unit, ChannelNumber, Voltage, SpectrumBarIndex, Gain, Fade, color, uuid);
-
-                }
-                else
-                {
-                    qDebug() << "channel is not object";
-                    isSchemaValid = false;
-                }
-            }
-
-            m_channels = std::move(channelsTmp);
-
-            qDebug() << "channels count: " << m_channels.size();
-
-        }
+        bool isSchemaValid = CConfigation::channelsFromJson( json, m_channels );
 
         if ( json.contains( cKeyPortName ) )
         {
@@ -386,6 +251,40 @@ void ChannelConfigurator::load()
             m_baudRate = json[ cKeyPortBaudRate ].toInt( cDefaultBaudRate );
         }
 
+        if ( json.contains( cKeyUnitPorts ) )
+        {
+            m_unitPorts.clear();
+            for ( const auto& portValue : json[ cKeyUnitPorts ].toArray() )
+            {
+                auto portJson = portValue.toObject();
+                OutputPort port{ portJson[ cKeyPortName ].toString(),
+                                 static_cast<uint32_t>( portJson[ cKeyPortBaudRate ].toInt( cDefaultBaudRate ) ),
+                                 {} };
+                if ( cOutputTypeE131Name == portJson[ cKeyPortType ].toString() )
+                {
+                    port.type = EOutputType::E131;
+                    port.baudRate = 0;
+                }
+
+                for ( const auto& unit : portJson[ cKeyPortUnits ].toArray() )
+                {
+                    if ( unit.toInt( 0 ) > 0 )
+                    {
+                        port.units.push_back( static_cast<uint32_t>( unit.toInt() ) );
+                    }
+                }
+
+                if ( port.name.isEmpty() || port.units.empty() )
+                {
+                    qWarning() << "Channel '" << cKeyUnitPorts << "' has a port without name or units";
+                }
+                else
+                {
+                    m_unitPorts.push_back( port );
+                }
+            }
+        }
+
 
         if ( json.contains( cKeyIsSchedulerEnabled ) )
         {
@@ -434,50 +333,54 @@ void ChannelConfigurator::load()
 
         if ( !isSchemaValid )
         {
-            QMessageBox::warning( this, "Warning", QString("Invalid configuration file schema: ") + configuration.c_str() );
+            QMessageBox::warning( this, "Warning", QString("Invalid configuration file schema: ") + cChannelConfigurationFileName );
         }
 
     }
     else
     {
-        qWarning() << "File not exist:" << configuration.c_str();
+        qWarning() << "File not exist:" << cChannelConfigurationFileName;
     }
 }
 
 void ChannelConfigurator::persist()
 {
     qDebug() << "Accep role found persist()";
-    QFile persistFile(configuration.c_str());
+    QFile persistFile(cChannelConfigurationFileName);
     if (!persistFile.open(QIODevice::WriteOnly))
     {
-        QMessageBox::warning( this, "Warning", QString("Couldn't write channel configuration to file: ") + configuration.c_str() );
+        QMessageBox::warning( this, "Warning", QString("Couldn't write channel configuration to file: ") + cChannelConfigurationFileName );
         return ;
     }
 
-    QJsonArray jsonChannelsArray;
-
-    for ( const auto& channel : m_channels )
-    {
-        QJsonObject jsonObject;
-        jsonObject[ cKeyLabel ] = channel.label;
-        jsonObject[ cKeyUnit ] = static_cast<int>(channel.unit);
-        jsonObject[ cKeyChannel ] = static_cast<int>(channel.channel);
-        jsonObject[ cKeyVoltage ] = static_cast<int>(channel.voltage);
-        jsonObject[ cKeySpectrumBarIndex ] = static_cast<int>(channel.spectrumIndex);
-        jsonObject[ cKeyGain ] = channel.gain;
-        jsonObject[ cKeyFade ] = channel.fade;
-        jsonObject[ cKeyColor ] = channel.color;
-        jsonObject[ cKeyUUID ] = channel.uuid.toString();
-        jsonChannelsArray.append(jsonObject);
-    }
-
     QJsonObject jsonObject;
     jsonObject[ cKeyPortName ] = m_commPortName;
     jsonObject[ cKeyPortBaudRate ] = static_cast<int>(m_baudRate);
+
+    QJsonArray unitPorts;
+    for ( const auto& port : m_unitPorts )
+    {
+        QJsonArray units;
+        for ( auto unit : port.units )
+        {
+            units.append( static_cast<int>( unit ) );
+        }
+
+        QJsonObject portJson;
+        portJson[ cKeyPortName ] = port.name;
+        portJson[ cKeyPortBaudRate ] = static_cast<int>( port.baudRate );
+        portJson[ cKeyPortUnits ] = units;
+        if ( EOutputType::E131 == port.type )
+        {
+            portJson[ cKeyPortType ] = cOutputTypeE131Name;
+        }
+        unitPorts.append( portJson );
+    }
+    jsonObject[ cKeyUnitPorts ] = unitPorts;
     jsonObject[ cKeyIsSchedulerEnabled ] = isSchedulelEnabled;
     jsonObject[ cKeySchedulerStartTime ] = showStartTime.toString( ui->schedulerStartTime->displayFormat() );
     jsonObject[ cKeySchedulerEndTime ] = showEndTime.toString( ui->schedulerEndTime->displayFormat() );
-    jsonObject[ cKeyChannels ] = jsonChannelsArray;
+    CConfigation::channelsToJson( m_channels, jsonObject );
 
     persistFile.write( QJsonDocument(jsonObject).toJson() );
 
@@ -491,7 +394,9 @@ void ChannelConfigurator::updateTableData()
    labels << "Unit";
    labels << "Channel";
    labels << "Voltage";
+   labels << "Dimming curve";
    labels << "SpectrumBar index";
+   labels << "Frequency range, Hz";
    labels << "Gain";
    labels << "Fade";
    labels << "Color";
@@ -519,7 +424,9 @@ void ChannelConfigurator::updateTableData()
             ui->tableWidget->setItem(rowIndex, cColumnIndexVoltage, new QTableWidgetItem( QString::number(220) ) );
         }
 
+        ui->tableWidget->setCellWidget( rowIndex, cColumnIndexCurve, prepareCurveCombo( m_channels[rowIndex].curve ) );
         ui->tableWidget->setCellWidget( rowIndex, cColumnIndexSpectrumBarIndex, prepareSpectrumCombo( m_channels[rowIndex].spectrumIndex ) );
+        ui->tableWidget->setCellWidget( rowIndex, cColumnIndexBand, prepareBandCombo( m_channels[rowIndex].band ) );
         ui->tableWidget->setCellWidget( rowIndex, cColumnIndexGain, new FloatSliderWidget( cMaxGainValue, cMinGainValue, m_channels[rowIndex].gain ) );
         ui->tableWidget->setCellWidget( rowIndex, cColumnIndexFade, new FloatSliderWidget( cMaxFadeValue, cMinFadeValue, m_channels[rowIndex].fade ) );
         ui->tableWidget->setCellWidget( rowIndex, cColumnIndexColor, prepareColorButton( m_channels[rowIndex].color ) );
@@ -529,6 +436,14 @@ void ChannelConfigurator::updateTableData()
 
     ui->commBaudrate->setText( QString::number( m_baudRate ) );
     ui->commPortNameEdit->setText( m_commPortName );
+
+    QStringList unitPorts;
+    for ( const auto& port : m_unitPorts )
+    {
+        unitPorts << CConfigation::outputPortToText( port );
+    }
+    ui->unitPortsEdit->setPlainText( unitPorts.join( '\n' ) );
+
     ui->schedulerStartTime->setTime ( showStartTime );
     ui->schedulerEndTime->setTime   ( showEndTime );
     ui->schedulerEnabled->setChecked( isSchedulelEnabled );
@@ -616,6 +531,14 @@ void ChannelConfigurator::updateChannelsValue()
         QComboBox* combo = (QComboBox*)ui->tableWidget->cellWidget(rowIndex, cColumnIndexSpectrumBarIndex);
         uint32_t SpectrumBarIndex = combo->currentIndex();
 
+        QComboBox* bandCombo = (QComboBox*)ui->tableWidget->cellWidget(rowIndex, cColumnIndexBand);
+        CBandLayout::Band band;
+        CConfigation::bandFromText( bandCombo->currentText(), band );
+
+        QComboBox* curveCombo = (QComboBox*)ui->tableWidget->cellWidget(rowIndex, cColumnIndexCurve);
+        DimmingCurve curve;
+        CConfigation::curveFromText( curveCombo->currentText(), curve );
+
         FloatSliderWidget* gainSlider = (FloatSliderWidget*)ui->tableWidget->cellWidget(rowIndex, cColumnIndexGain);
         double   Gain = gainSlider->value();
 
@@ -629,11 +552,15 @@ void ChannelConfigurator::updateChannelsValue()
         auto uuid = labelPtr->text();
 
         channelsTmp.emplace_back( label, unit, ChannelNumber, Voltage, SpectrumBarIndex, Gain, Fade, color, uuid );
+        channelsTmp.back().band = band;
+        channelsTmp.back().curve = curve;
         qDebug() << "label" << label
                  << "unit"<< unit
                  << "ChannelNumber" << ChannelNumber
                  << "Voltage" << Voltage
                  << "SpectrumBarIndex" << SpectrumBarIndex
+                 << "Band" << CConfigation::bandToText( band )
+                 << "Curve" << CConfigation::curveToText( curve )
                  << "Gain" << Gain
                  << "Fade" << Fade
                  << "Color" << color
@@ -650,6 +577,16 @@ void ChannelConfigurator::updateChannelsValue()
         m_baudRate = cDefaultBaudRate;
     }
 
+    m_unitPorts.clear();
+    for ( const auto& line : ui->unitPortsEdit->toPlainText().split( '\n', QString::SkipEmptyParts ) )
+    {
+        OutputPort port;
+        if ( CConfigation::outputPortFromText( line, port ) )
+        {
+            m_unitPorts.push_back( port );
+        }
+    }
+
     isSchedulelEnabled = ui->schedulerEnabled->isChecked();
 
     auto startTime = ui->schedulerStartTime->time();
@@ -722,6 +659,43 @@ QComboBox *ChannelConfigurator::prepareSpectrumCombo(int defaultValue)
    return combo;
 }
 
+QComboBox *ChannelConfigurator::prepareBandCombo( const CBandLayout::Band &band )
+{
+   // Editable, any "low - high" range or one of the 1/3-octave presets
+   QComboBox *combo = new QComboBox();
+   combo->setEditable( true );
+   combo->addItem( QString() );
+   for ( const auto& preset : CBandLayout::thirdOctaveBands( cMaxFrequensy ) )
+   {
+      combo->addItem( CConfigation::bandToText( preset ) );
+   }
+   combo->setCurrentText( CConfigation::bandToText( band ) );
+
+   connect( combo, &QComboBox::editTextChanged, [this](){
+      setEnableOkButton( isTableDataValid() );
+   });
+
+   return combo;
+}
+
+QComboBox *ChannelConfigurator::prepareCurveCombo( const DimmingCurve &curve )
+{
+   // Editable, the presets or custom "x:y" points
+   QComboBox *combo = new QComboBox();
+   combo->setEditable( true );
+   combo->addItem( CConfigation::curveToText( DimmingCurve() ) );
+   DimmingCurve perceptual;
+   perceptual.type = DimmingCurve::EType::Perceptual;
+   combo->addItem( CConfigation::curveToText( perceptual ) );
+   combo->setCurrentText( CConfigation::curveToText( curve ) );
+
+   connect( combo, &QComboBox::editTextChanged, [this](){
+      setEnableOkButton( isTableDataValid() );
+   });
+
+   return combo;
+}
+
 QLabel *ChannelConfigurator::prepareUUIDLabel(const QUuid &uuid)
 {
    return new QLabel(uuid.toString());
@@ -745,6 +719,26 @@ bool ChannelConfigurator::isTableDataValid() const
                    isValid = false;
                    qDebug() << "col:" << colIndex << "row:" << rowIndex << " is empty (nullptr)";
                 }
+                else if ( cColumnIndexBand == colIndex )
+                {
+                   CBandLayout::Band band;
+                   auto combo = dynamic_cast< QComboBox* >( widgetPtr );
+                   if ( nullptr == combo || !CConfigation::bandFromText( combo->currentText(), band ) )
+                   {
+                      isValid = false;
+                      qDebug() << "col:" << colIndex << "row:" << rowIndex << " Frequency range must be 'low - high' Hz up to" << cMaxFrequensy;
+                   }
+                }
+                else if ( cColumnIndexCurve == colIndex )
+                {
+                   DimmingCurve curve;
+                   auto combo = dynamic_cast< QComboBox* >( widgetPtr );
+                   if ( nullptr == combo || !CConfigation::curveFromText( combo->currentText(), curve ) )
+                   {
+                      isValid = false;
+                      qDebug() << "col:" << colIndex << "row:" << rowIndex << " Dimming curve must be 'linear', 'perceptual' or ascending 'x:y' points in 0..1";
+                   }
+                }
                 continue;
             }
 
@@ -765,6 +759,8 @@ bool ChannelConfigurator::isTableDataValid() const
             case cColumnIndexColor: break;
             case cColumnIndexUuid: break;
             case cColumnIndexSpectrumBarIndex: break;
+            case cColumnIndexBand: break;
+            case cColumnIndexCurve: break;
 
             default:
             {
@@ -782,6 +778,16 @@ bool ChannelConfigurator::isTableDataValid() const
         }
     }
 
+    for ( const auto& line : ui->unitPortsEdit->toPlainText().split( '\n', QString::SkipEmptyParts ) )
+    {
+        OutputPort port;
+        if ( !line.trimmed().isEmpty() && !CConfigation::outputPortFromText( line, port ) )
+        {
+            isValid = false;
+            qDebug() << "Port line" << line << "must be 'name baudrate units' or 'e131 host units'";
+        }
+    }
+
     return isValid;
 }
 
@@ -808,6 +814,8 @@ void ChannelConfigurator::on_tableWidget_customContextMenuRequested( const QPoin
         ui->tableWidget->setItem(       index, cColumnIndexVoltage, new QTableWidgetItem( QString::number(220)) );
         ui->tableWidget->setCellWidget( index, cColumnIndexColor, prepareColorButton( QColorConstants::Red ));
         ui->tableWidget->setCellWidget( index, cColumnIndexSpectrumBarIndex, prepareSpectrumCombo( cDefaultSpectrumIndex ));
+        ui->tableWidget->setCellWidget( index, cColumnIndexBand, prepareBandCombo( CBandLayout::Band() ));
+        ui->tableWidget->setCellWidget( index, cColumnIndexCurve, prepareCurveCombo( DimmingCurve() ));
         ui->tableWidget->setCellWidget( index, cColumnIndexUuid, prepareUUIDLabel( QUuid::createUuid() ));
         ui->tableWidget->setCellWidget( index, cColumnIndexGain, new FloatSliderWidget( cMaxGainValue, cMinGainValue, cDefaultGainValue ) );
         ui->tableWidget->setCellWidget( index, cColumnIndexFade, new FloatSliderWidget( cMaxFadeValue, cMinFadeValue, cDefaultFadeValue ) );
@@ -833,6 +841,12 @@ void ChannelConfigurator::on_tableWidget_customContextMenuRequested( const QPoin
             widget = ui->tableWidget->cellWidget(index, cColumnIndexSpectrumBarIndex);
             if ( widget ) { delete widget; }
 
+            widget = ui->tableWidget->cellWidget(index, cColumnIndexBand);
+            if ( widget ) { delete widget; }
+
+            widget = ui->tableWidget->cellWidget(index, cColumnIndexCurve);
+            if ( widget ) { delete widget; }
+
             widget = ui->tableWidget->cellWidget(index, cColumnIndexUuid);
             if ( widget ) { delete widget; }
 
@@ -929,6 +943,14 @@ void ChannelConfigurator::positionChanged(const SpectrumData &spectrum)
                 }
             }
 
+            auto bandWidget = ui->tableWidget->cellWidget( currentIndex, cColumnIndexBand );
+            if ( auto combo = dynamic_cast< QComboBox* >( bandWidget ) )
+            {
+                CBandLayout::Band band;
+                CConfigation::bandFromText( combo->currentText(), band );
+                spectrograph->setBand( band );
+            }
+
             auto gainWidget = ui->tableWidget->cellWidget( currentIndex, cColumnIndexGain );
             if ( auto gain = dynamic_cast< FloatSliderWidget* >( gainWidget ) )
             {
@@ -958,3 +980,10 @@ const QString &ChannelConfigurator::commPortName() const
 {
     return m_commPortName;
 }
+
+std::vector<OutputPort> ChannelConfigurator::ports() const
+{
+    std::vector<OutputPort> ports{ OutputPort{ m_commPortName, m_baudRate, {} } };
+    ports.insert( ports.end(), m_unitPorts.begin(), m_unitPorts.end() );
+    return ports;
+}
@@ -43,6 +43,9 @@ public:
 
     uint32_t baudRate() const;
 
+    // Main port first, it takes every unit the additional ones do not list
+    std::vector<OutputPort> ports() const;
+
     bool isSchedulerTimeActive() const;
 
     bool getIsSchedulelEnabled() const
@@ -72,6 +75,8 @@ private slots:
 
     QPushButton *prepareColorButton( const QColor& defaultColor );
     QComboBox *prepareSpectrumCombo( int defaultValue );
+    QComboBox *prepareBandCombo( const CBandLayout::Band& band );
+    QComboBox *prepareCurveCombo( const DimmingCurve& curve );
     QLabel *prepareUUIDLabel(const QUuid& uuid );
 
     bool isTableDataValid() const;
@@ -90,6 +95,7 @@ private:
     std::vector<Channel> m_channels;
     QString   m_commPortName;
     uint32_t  m_baudRate;
+    std::vector<OutputPort> m_unitPorts;
     std::weak_ptr<CLightSequence> m_sequense;
     QMetaObject::Connection m_spectrographConnection;
     bool isDisplayed = false;
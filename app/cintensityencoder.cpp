@@ -0,0 +1,107 @@
+#include "cintensityencoder.h"
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <tuple>
+
+constexpr double cNominalVoltage = 220.0;
+
+// Definition of the class constant, C++14 needs it once it is bound to a reference
+constexpr uint32_t CIntensityEncoder::cSteps;
+
+double DimmingCurve::apply( double intensity ) const
+{
+    intensity = std::max( 0.0, std::min( 1.0, intensity ) );
+
+    switch ( type )
+    {
+    case EType::Linear:
+        break;
+
+    case EType::Perceptual:
+    {
+        // Lightness L* = 100 * intensity to relative luminance
+        const double lightness = 100.0 * intensity;
+        return lightness > 8.0 ? std::pow( ( lightness + 16.0 ) / 116.0, 3.0 ) : lightness / 903.3;
+    }
+
+    case EType::Custom:
+    {
+        double x0 = 0.0;
+        double y0 = 0.0;
+        for ( const auto& point : points )
+        {
+            if ( intensity <= point.first )
+            {
+                return y0 + ( point.second - y0 ) * ( intensity - x0 ) / ( point.first - x0 );
+            }
+            x0 = point.first;
+            y0 = point.second;
+        }
+        return y0 + ( 1.0 - y0 ) * ( intensity - x0 ) / ( 1.0 - x0 );
+    }
+    }
+
+    return intensity;
+}
+
+CIntensityEncoder::CIntensityEncoder( std::shared_ptr< const std::vector<uint8_t> > table )
+    : m_table( std::move( table ) )
+    , m_values( m_table->data() )
+{
+}
+
+CIntensityEncoder CIntensityEncoder::get( EFormat format, uint32_t voltage, const DimmingCurve &curve )
+{
+    using Key = std::tuple< EFormat, uint32_t, DimmingCurve >;
+    static std::mutex mutex;
+    static std::map< Key, std::shared_ptr< const std::vector<uint8_t> > > tables;
+
+    std::lock_guard<std::mutex> lock( mutex );
+    auto& table = tables[ Key( format, voltage, curve ) ];
+    if ( nullptr == table )
+    {
+        auto values = std::make_shared< std::vector<uint8_t> >( cSteps + 1 );
+        for ( uint32_t i = 0; i <= cSteps; ++i )
+        {
+            const double intensity = double( i ) / double( cSteps );
+            ( *values )[ i ] = compute( format, curve.apply( intensity ) * double( voltage ) / cNominalVoltage );
+        }
+        table = values;
+    }
+    return CIntensityEncoder( table );
+}
+
+uint8_t CIntensityEncoder::compute( EFormat format, double level )
+{
+    level = std::max( 0.0, std::min( 1.0, level ) );
+
+    switch ( format )
+    {
+    case EFormat::LOR:
+    {
+        // Inverted percent, 30 is almost full and 228 almost off
+        const double inverted = ( 1.0 - level ) * 100.0;
+        if ( inverted > 99.0 )
+        {
+            return 0xf0;
+        }
+        if ( inverted < 1.0 )
+        {
+            return 0x01;
+        }
+        return static_cast<uint8_t>( inverted * 2.0 + 30.0 );
+    }
+
+    case EFormat::DMX:
+        return static_cast<uint8_t>( std::lround( level * 255.0 ) );
+
+    case EFormat::LMS:
+        // Truncated like before, measured at the top of the quantization step so
+        // that fades landing on a whole percent keep it
+        return static_cast<uint8_t>( std::min( 100.0, level * 100.0 + 50.0 / double( cSteps ) ) );
+    }
+
+    return 0;
+}
@@ -0,0 +1,93 @@
+#ifndef CINTENSITYENCODER_H
+#define CINTENSITYENCODER_H
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+/**
+ * Brightness response of a channel, maps the rendered intensity 0..1 to
+ * the output level 0..1 before the voltage scaling.
+ */
+struct DimmingCurve
+{
+   enum class EType
+   {
+      Linear,
+      Perceptual,    // CIE 1931 lightness, even steps to the eye
+      Custom         // piecewise linear through points, 0:0 and 1:1 implied
+   };
+
+   EType type = EType::Linear;
+   std::vector< std::pair<double, double> > points;   // Custom only, ascending x inside (0, 1)
+
+   double apply( double intensity ) const;
+
+   bool operator==( const DimmingCurve& other ) const { return type == other.type && points == other.points; }
+   bool operator!=( const DimmingCurve& other ) const { return !( *this == other ); }
+   bool operator<( const DimmingCurve& other ) const
+   {
+      return type != other.type ? type < other.type : points < other.points;
+   }
+};
+
+
+/**
+ * Intensity to protocol value through a lookup table per format, voltage
+ * and dimming curve.
+ *
+ * The voltage scaling against 220 V, the curve, inversion, clamping and
+ * the mapping to the protocol are done once per table entry, a lookup is
+ * a quantization and an index. Tables are built on first use and shared
+ * by every channel, live output and file export alike, so both always
+ * agree on the value of an intensity.
+ *
+ * get() locks and may allocate, call it when a setup is compiled and keep
+ * the encoder. encode() is safe from any thread.
+ */
+class CIntensityEncoder
+{
+public:
+
+   enum class EFormat
+   {
+      LOR,      // level byte, 0xF0 off, 0x01 full
+      DMX,      // 0..255
+      LMS       // intensity percent of an .lms effect, 0..100
+   };
+
+   // Quantization of the intensity, a table has cSteps + 1 entries
+   static constexpr uint32_t cSteps = 4096;
+
+   static CIntensityEncoder get( EFormat format, uint32_t voltage, const DimmingCurve& curve = DimmingCurve() );
+
+   uint8_t encode( double intensity ) const { return m_values[ index( intensity ) ]; }
+
+   static uint32_t index( double intensity )
+   {
+      // NaN goes to 0 as well
+      if ( !( intensity > 0.0 ) )
+      {
+         return 0;
+      }
+      if ( intensity >= 1.0 )
+      {
+         return cSteps;
+      }
+      return static_cast<uint32_t>( intensity * double( cSteps ) + 0.5 );
+   }
+
+private:
+
+   explicit CIntensityEncoder( std::shared_ptr< const std::vector<uint8_t> > table );
+
+   static uint8_t compute( EFormat format, double level );
+
+private:
+
+   std::shared_ptr< const std::vector<uint8_t> > m_table;
+   const uint8_t* m_values;
+};
+
+#endif // CINTENSITYENCODER_H
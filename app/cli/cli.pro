@@ -0,0 +1,85 @@
+TEMPLATE = app
+
+TARGET = spectrum-cli
+
+# gui is needed for QColor, widgets for the effect headers of the live
+# output, no widgets are created
+QT        = core gui widgets concurrent serialport network
+CONFIG   += console
+CONFIG   -= app_bundle
+
+SOURCES  += main.cpp \
+            ../CConfiguration.cpp \
+            ../SpectrumStore.cpp \
+            ../cbandlayout.cpp \
+            ../cbeatdetector.cpp \
+            ../ce131output.cpp \
+            ../cliveoutputport.cpp \
+            ../clorframeencoder.cpp \
+            ../coutputlog.cpp \
+            ../cfftengine.cpp \
+            ../cintensityencoder.cpp \
+            ../csequensegenerator.cpp \
+            ../ctrace.cpp \
+            ../cspectrumanalyzer.cpp \
+            ../cspectrumcache.cpp
+
+HEADERS  += ../CConfiguration.h \
+            ../IOutputBackend.h \
+            ../SpectrumData.h \
+            ../SpectrumStore.h \
+            ../constants.h \
+            ../cbandlayout.h \
+            ../cbeatdetector.h \
+            ../ce131output.h \
+            ../cliveoutputport.h \
+            ../clorframeencoder.h \
+            ../coutputlog.h \
+            ../cfftengine.h \
+            ../cintensityencoder.h \
+            ../csequensegenerator.h \
+            ../ctrace.h \
+            ../cspectrumanalyzer.h \
+            ../cspectrumcache.h
+
+# Output benchmark, the virtual controller needs a pseudo-terminal
+unix {
+    SOURCES += ../coutputbenchmark.cpp \
+               ../cliveoutputthread.cpp \
+               ../cvirtuallorcontroller.cpp \
+               ../qbassaudiofile.cpp \
+               ../timeline/CEffectIntervalIndex.cpp \
+               ../timeline/CEffectRenderCache.cpp \
+               ../timeline/IEffectGenerator.cpp
+    HEADERS += ../coutputbenchmark.h \
+               ../cliveoutputthread.h \
+               ../cvirtuallorcontroller.h \
+               ../qbassaudiofile.h \
+               ../timeline/CEffectIntervalIndex.h \
+               ../timeline/CEffectRenderCache.h \
+               ../timeline/IEffectGenerator.h
+}
+
+INCLUDEPATH += ..
+INCLUDEPATH += ../../3rdparty/
+INCLUDEPATH += ../../3rdparty/bass24-linux
+
+CONFIG += c++14
+
+# SSE2 kernel of the FFT engine is the default on x86-64, qmake CONFIG+=avx2 selects the AVX2 one
+avx2 {
+    msvc: QMAKE_CXXFLAGS += /arch:AVX2
+    else: QMAKE_CXXFLAGS += -mavx2 -mfma
+}
+
+
+win32 {
+    LIBS += -L$$PWD/../../3rdparty/bass24/
+    LIBS += -lbass
+} else {
+    linux-g++*: {
+        LIBS += -L$$PWD/../../3rdparty/bass24-linux/x64
+        LIBS += -lbass
+        QMAKE_LFLAGS += -Wl,--rpath=\\\$\$ORIGIN
+    }
+}
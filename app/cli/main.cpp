@@ -0,0 +1,399 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrentMap>
+#include <bass.h>
+#include <cstdio>
+#include <vector>
+#include "CConfiguration.h"
+#include "csequensegenerator.h"
+#include "ctrace.h"
+#include "coutputlog.h"
+#ifdef Q_OS_UNIX
+#include "coutputbenchmark.h"
+#endif
+
+// Exit codes
+constexpr int cExitOk = 0;
+constexpr int cExitGenerationFailed = 1;
+constexpr int cExitBadConfiguration = 2;
+
+
+class CCliConfiguration : public CConfigation
+{
+public:
+
+   virtual const std::vector<Channel>& channels() const override { return m_channels; }
+
+   void setDestination( const QString& destination ) { destinationFolder = destination; }
+
+   void setAnalysisHopMs( uint32_t hopMs ) { analysisHopMs = hopMs; }
+
+   void setAnalysisFFTSize( uint32_t fftSize ) { analysisFFTSize = fftSize; }
+
+   void setAnalysisWindow( CFFTEngine::EWindow window ) { analysisWindow = window; }
+
+   bool loadChannels( const QString& fileName )
+   {
+      QJsonObject json;
+      if ( !readJson( fileName, json ) )
+      {
+         return false;
+      }
+
+      if ( !channelsFromJson( json, m_channels ) )
+      {
+         std::fprintf( stderr, "Invalid configuration file schema: %s\n", qPrintable( fileName ) );
+         return false;
+      }
+
+      if ( m_channels.empty() )
+      {
+         std::fprintf( stderr, "No channels configured in: %s\n", qPrintable( fileName ) );
+         return false;
+      }
+
+      return true;
+   }
+
+   static bool readJson( const QString& fileName, QJsonObject& json )
+   {
+      QFile file( fileName );
+      if ( !file.open( QIODevice::ReadOnly ) )
+      {
+         std::fprintf( stderr, "Couldn't open file: %s\n", qPrintable( fileName ) );
+         return false;
+      }
+
+      QJsonParseError error;
+      QJsonDocument doc( QJsonDocument::fromJson( file.readAll(), &error ) );
+      if ( QJsonParseError::NoError != error.error || !doc.isObject() )
+      {
+         std::fprintf( stderr, "Couldn't parse %s: %s\n", qPrintable( fileName ), qPrintable( error.errorString() ) );
+         return false;
+      }
+
+      json = doc.object();
+      return true;
+   }
+
+private:
+   std::vector<Channel> m_channels;
+};
+
+
+struct GenerateJob
+{
+   CSequenseGenerator::Snapshot snapshot;
+   bool isSuccess = false;
+   qint64 elapsedMs = 0;
+};
+
+
+int main( int argc, char *argv[] )
+{
+   QCoreApplication app( argc, argv );
+   app.setApplicationName( "spectrum-cli" );
+
+   QCommandLineParser parser;
+   parser.setApplicationDescription( "Generates .lms sequenses without GUI. "
+                                     "Without audio files every sequense of the sequense configuration is generated." );
+   parser.addHelpOption();
+
+   QCommandLineOption channelsOption( QStringList() << "c" << "channels",
+                                      "Channel configuration file.", "file", cChannelConfigurationFileName );
+   QCommandLineOption sequensesOption( QStringList() << "s" << "sequenses",
+                                       "Sequense configuration file written by the GUI.", "file", cSequenseConfigurationFileName );
+   QCommandLineOption outputOption( QStringList() << "o" << "output",
+                                    "Destination folder, overrides the one of the sequense configuration.", "dir" );
+   QCommandLineOption jobsOption( QStringList() << "j" << "jobs",
+                                  "Number of files generated in parallel, default is the number of cores.", "count" );
+   QCommandLineOption hopOption( "hop",
+                                 "Analysis hop in milliseconds, overrides the one of the sequense configuration.", "ms" );
+   QCommandLineOption fftSizeOption( "fft-size",
+                                     "FFT size, power of two from 256 to 8192, overrides the one of the sequense configuration.", "size" );
+   QCommandLineOption windowOption( "window",
+                                    "FFT window: hann, hamming, blackman or rectangular.", "name" );
+   QCommandLineOption noCacheOption( "no-cache",
+                                     "Always analyse, do not read or write the spectrum cache." );
+   QCommandLineOption traceOption( "trace-timeline",
+                                   "Convert a trace dump of the GUI to <file>.json for chrome://tracing or Perfetto and exit.", "file" );
+#ifdef Q_OS_UNIX
+   QCommandLineOption benchOption( "bench-output",
+                                   "Play the first file for the given seconds into a virtual LOR controller "
+                                   "and report output latency, jitter, bytes/s and dropped updates per channel.", "seconds" );
+   QCommandLineOption baudOption( "baud",
+                                  "Baud rate of the output benchmark line, 0 is unlimited.", "rate", "115200" );
+   QCommandLineOption hysteresisOption( "hysteresis",
+                                        "Output hysteresis of the benchmark in LOR level steps.", "steps",
+                                        QString::number( cDefaultOutputHysteresis ) );
+   QCommandLineOption refreshOption( "refresh",
+                                     "Output refresh period of the benchmark.", "ms", QString::number( cDefaultOutputRefreshMs ) );
+   parser.addOption( benchOption );
+   parser.addOption( baudOption );
+   parser.addOption( hysteresisOption );
+   parser.addOption( refreshOption );
+#endif
+   parser.addOption( channelsOption );
+   parser.addOption( sequensesOption );
+   parser.addOption( outputOption );
+   parser.addOption( jobsOption );
+   parser.addOption( hopOption );
+   parser.addOption( fftSizeOption );
+   parser.addOption( windowOption );
+   parser.addOption( noCacheOption );
+   QCommandLineOption replayOption( "replay-output",
+                                    "Play an output log recorded by the GUI to its serial ports and E1.31 hosts with the original timing and exit.", "file" );
+   QCommandLineOption replayPortsOption( "replay-ports",
+                                         "Comma separated ports or E1.31 hosts used instead of the recorded ones, in the order the log defines them.", "names" );
+   parser.addOption( traceOption );
+   parser.addOption( replayOption );
+   parser.addOption( replayPortsOption );
+   parser.addPositionalArgument( "files", "Audio files to generate.", "[files...]" );
+   parser.process( app );
+
+   if ( parser.isSet( traceOption ) )
+   {
+      const QString traceFile = parser.value( traceOption );
+      std::vector<CTrace::Record> records;
+      if ( !CTrace::load( traceFile, records ) || !CTrace::toTimeline( records, traceFile + ".json" ) )
+      {
+         return cExitBadConfiguration;
+      }
+      std::printf( "%zu records written to %s.json\n", records.size(), qPrintable( traceFile ) );
+      return cExitOk;
+   }
+
+   if ( parser.isSet( replayOption ) )
+   {
+      COutputLog::Recording recording;
+      if ( !COutputLog::load( parser.value( replayOption ), recording ) )
+      {
+         return cExitBadConfiguration;
+      }
+
+      if ( parser.isSet( replayPortsOption ) )
+      {
+         const QStringList names = parser.value( replayPortsOption ).split( ',', QString::SkipEmptyParts );
+         for ( int i = 0; i < names.size() && i < int( recording.ports.size() ); ++i )
+         {
+            recording.ports[ i ].name = names[ i ].trimmed();
+            recording.ports[ i ].address.clear();
+         }
+      }
+
+      const double seconds = recording.writes.empty() ? 0.0 : double( recording.writes.back().timeUs ) / 1e6;
+      std::printf( "Replaying %zu writes, %zu bytes, %.1f s\n", recording.writes.size(), recording.bytes.size(), seconds );
+      return COutputLog::replay( recording ) ? cExitOk : cExitGenerationFailed;
+   }
+
+   CCliConfiguration configuration;
+   if ( !configuration.loadChannels( parser.value( channelsOption ) ) )
+   {
+      return cExitBadConfiguration;
+   }
+
+   // Sequense configuration is optional when files are given explicitly
+   QJsonObject sequenseConfiguration;
+   const QString sequensesFile = parser.value( sequensesOption );
+   if ( parser.isSet( sequensesOption ) || QFile::exists( sequensesFile ) )
+   {
+      if ( !CCliConfiguration::readJson( sequensesFile, sequenseConfiguration ) )
+      {
+         return cExitBadConfiguration;
+      }
+   }
+
+   QString destination = sequenseConfiguration.value( cKeyOutputDirectory ).toString( QDir::currentPath() );
+   if ( parser.isSet( outputOption ) )
+   {
+      destination = parser.value( outputOption );
+   }
+
+   if ( !QDir( destination ).exists() )
+   {
+      std::fprintf( stderr, "Destination folder does not exist: %s\n", qPrintable( destination ) );
+      return cExitBadConfiguration;
+   }
+   configuration.setDestination( destination );
+
+   int hopMs = sequenseConfiguration.value( cKeyAnalysisHopMs ).toInt( cDefaultAnalysisHopMs );
+   if ( parser.isSet( hopOption ) )
+   {
+      hopMs = parser.value( hopOption ).toInt();
+   }
+
+   if ( hopMs <= 0 )
+   {
+      std::fprintf( stderr, "Analysis hop must be a positive number of milliseconds\n" );
+      return cExitBadConfiguration;
+   }
+   configuration.setAnalysisHopMs( hopMs );
+
+   int fftSize = sequenseConfiguration.value( cKeyAnalysisFFTSize ).toInt( cDefaultFFTSize );
+   if ( parser.isSet( fftSizeOption ) )
+   {
+      fftSize = parser.value( fftSizeOption ).toInt();
+   }
+
+   if ( fftSize <= 0 || !CFFTEngine::isValidSize( fftSize ) )
+   {
+      std::fprintf( stderr, "FFT size must be a power of two from %u to %u\n", cMinFFTSize, cMaxFFTSize );
+      return cExitBadConfiguration;
+   }
+   configuration.setAnalysisFFTSize( fftSize );
+
+   QString windowName = sequenseConfiguration.value( cKeyAnalysisWindow ).toString( CFFTEngine::windowName( CFFTEngine::EWindow::Hann ) );
+   if ( parser.isSet( windowOption ) )
+   {
+      windowName = parser.value( windowOption );
+   }
+
+   CFFTEngine::EWindow window = CFFTEngine::EWindow::Hann;
+   if ( !CFFTEngine::windowFromName( windowName.toStdString(), window ) )
+   {
+      std::fprintf( stderr, "Unknown FFT window: %s\n", qPrintable( windowName ) );
+      return cExitBadConfiguration;
+   }
+   configuration.setAnalysisWindow( window );
+
+   const QJsonArray sequenses = sequenseConfiguration.value( cKeySequenses ).toArray();
+   QStringList files = parser.positionalArguments();
+   if ( files.isEmpty() )
+   {
+      for ( const auto& seq : sequenses )
+      {
+         files << seq.toObject().value( cKeyFileName ).toString();
+      }
+   }
+
+   if ( files.isEmpty() )
+   {
+      std::fprintf( stderr, "Nothing to generate\n" );
+      return cExitBadConfiguration;
+   }
+
+   std::vector<GenerateJob> jobs;
+   jobs.reserve( files.size() );
+   for ( const auto& file : files )
+   {
+      QFileInfo fileInfo( file );
+      if ( !fileInfo.exists() )
+      {
+         std::fprintf( stderr, "File does not exist: %s\n", qPrintable( file ) );
+         return cExitBadConfiguration;
+      }
+
+      // Take the per channel settings of the sequense with the same file, if there is one
+      QJsonObject sequense;
+      sequense[ cKeyFileName ] = file;
+      for ( const auto& seq : sequenses )
+      {
+         QFileInfo seqFileInfo( seq.toObject().value( cKeyFileName ).toString() );
+         if ( seqFileInfo.exists() && seqFileInfo.canonicalFilePath() == fileInfo.canonicalFilePath() )
+         {
+            sequense = seq.toObject();
+            break;
+         }
+      }
+
+      GenerateJob job;
+      job.snapshot = CSequenseGenerator::makeSnapshot( sequense, configuration );
+      job.snapshot.useCache = !parser.isSet( noCacheOption );
+      jobs.push_back( job );
+   }
+
+   // "no sound" device, decoding channels do not need a real output
+   if ( !BASS_Init( 0, 44100, 0, NULL, NULL ) )
+   {
+      std::fprintf( stderr, "Was not able to initialize BASS library, error: %d\n", BASS_ErrorGetCode() );
+      return cExitGenerationFailed;
+   }
+
+#ifdef Q_OS_UNIX
+   if ( parser.isSet( benchOption ) )
+   {
+      COutputBenchmark::Parameters benchParameters;
+      benchParameters.seconds = parser.value( benchOption ).toUInt();
+      benchParameters.baudRate = parser.value( baudOption ).toUInt();
+      benchParameters.hysteresis = parser.value( hysteresisOption ).toUInt();
+      benchParameters.refreshMs = parser.value( refreshOption ).toUInt();
+
+      const CSequenseGenerator::Snapshot& snapshot = jobs.front().snapshot;
+      COutputBenchmark::Report report;
+      const bool isSuccess = COutputBenchmark::run( snapshot, benchParameters, report );
+      BASS_Free();
+
+      if ( !isSuccess )
+      {
+         std::fprintf( stderr, "Output benchmark failed: %s\n", snapshot.fileName.c_str() );
+         return cExitGenerationFailed;
+      }
+
+      std::printf( "%-20s %4s %4s %8s %9s %8s\n", "channel", "unit", "ch", "changes", "delivered", "dropped" );
+      for ( const auto& channel : report.channels )
+      {
+         std::printf( "%-20s %4u %4u %8llu %9llu %8llu\n", qPrintable( channel.label ), channel.unit, channel.channel,
+                      static_cast<unsigned long long>( channel.changes ),
+                      static_cast<unsigned long long>( channel.delivered ),
+                      static_cast<unsigned long long>( channel.dropped ) );
+      }
+
+      std::printf( "Played %.1f s at %u baud: %.0f bytes/s, %llu commands, %llu heartbeats, %llu deferred, %llu unknown bytes\n",
+                   report.seconds, benchParameters.baudRate,
+                   report.seconds > 0.0 ? double( report.bytes ) / report.seconds : 0.0,
+                   static_cast<unsigned long long>( report.commands ),
+                   static_cast<unsigned long long>( report.heartbeats ),
+                   static_cast<unsigned long long>( report.deferred ),
+                   static_cast<unsigned long long>( report.unknownBytes ) );
+      std::printf( "Latency of %llu changes: mean %.2f ms, p50 %.2f ms, p95 %.2f ms, max %.2f ms, jitter %.2f ms\n",
+                   static_cast<unsigned long long>( report.samples ),
+                   report.meanMs, report.p50Ms, report.p95Ms, report.maxMs, report.jitterMs );
+      return cExitOk;
+   }
+#endif
+
+   if ( parser.isSet( jobsOption ) )
+   {
+      int count = parser.value( jobsOption ).toInt();
+      if ( count > 0 )
+      {
+         QThreadPool::globalInstance()->setMaxThreadCount( count );
+      }
+   }
+
+   QElapsedTimer totalTimer;
+   totalTimer.start();
+
+   QtConcurrent::blockingMap( jobs, []( GenerateJob& job ){
+      QElapsedTimer timer;
+      timer.start();
+      job.isSuccess = CSequenseGenerator::generate( job.snapshot );
+      job.elapsedMs = timer.elapsed();
+   } );
+
+   int failed = 0;
+   for ( const auto& job : jobs )
+   {
+      std::printf( "%-6s %8lld ms  %s\n", job.isSuccess ? "OK" : "FAILED",
+                   static_cast<long long>( job.elapsedMs ), job.snapshot.fileName.c_str() );
+      if ( !job.isSuccess )
+      {
+         ++failed;
+      }
+   }
+
+   std::printf( "Generated %d of %d in %lld ms, threads: %d, fft: %d %s %s\n", int( jobs.size() ) - failed, int( jobs.size() ),
+                static_cast<long long>( totalTimer.elapsed() ), QThreadPool::globalInstance()->maxThreadCount(),
+                fftSize, CFFTEngine::windowName( window ), CFFTEngine::simdName() );
+
+   BASS_Free();
+
+   return 0 == failed ? cExitOk : cExitGenerationFailed;
+}
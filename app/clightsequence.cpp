@@ -11,17 +11,9 @@
 #include <QDebug>
 #include <QJsonArray>
 #include <QSizePolicy>
+#include <QtConcurrent/QtConcurrentRun>
 #include "csequensegenerator.h"
-
-
-const QString cKeyFileName("file");
-const QString cKeyChannelConfiguration("configuration");
-const QString cKeyChannelUUID("uuid");
-const QString cKeyChannelSpectrumIndex("spectrumIndex");
-const QString cKeyChannelGain("gain");
-const QString cKeyChannelMinimumLevel("minimumLevel");
-const QString cKeyChannelFading("fading");
-const QString cKeyChannelEffects("effects");
+#include "cspectrumcache.h"
 
 
 IInnerCommunicationGlue CLightSequence::sPlayEventDistributor(nullptr);
@@ -38,13 +30,8 @@ void IInnerCommunicationGlue::sendSequenseEvent(CLightSequence *sequense)
 
 
 CLightSequence::CLightSequence(const std::string &fileName, const CConfigation &configuration)
-    : QObject( nullptr )
-    , m_configuration( configuration )
-    , m_fileName( fileName )
-    , m_audioFile( nullptr )
-    , m_isGenerateStarted( false )
+    : CLightSequence( fileName, configuration, std::list<std::shared_ptr<SequenceChannelConfigation>>() )
 {
-    m_audioFile = QBassAudioFile::get(m_fileName);
 }
 
 
@@ -115,7 +102,16 @@ std::vector<QWidget *> CLightSequence::getControlWidgets()
    auto playPositionChanging = [this, trackPosition, cacProgressLabel, durationLabel](const SpectrumData& spectrum){
       trackPosition->setValue(spectrum.position);
       durationLabel->setText( cacProgressLabel() );
-      emit positionChanged( spectrum );
+      startBeatDetection();
+      if ( nullptr == m_beats )
+      {
+         emit positionChanged( spectrum );
+         return;
+      }
+
+      SpectrumData withBeats( spectrum );
+      withBeats.beats = m_beats;
+      emit positionChanged( withBeats );
    };
 
    auto deleter = [](QMetaObject::Connection* con){ disconnect(*con); delete con; };
@@ -141,11 +137,6 @@ std::vector<QWidget *> CLightSequence::getControlWidgets()
 
    auto playButtonClickedEvent = [this]( bool ) {
 
-       if ( isGenerateStarted() )
-       {
-           return;
-       }
-
        if ( QBassAudioFile::EState::Play == m_audioFile->state() )
        {
           m_audioFile->stop();
@@ -161,21 +152,15 @@ std::vector<QWidget *> CLightSequence::getControlWidgets()
    m_conncetionToDestroy.push_back( std::shared_ptr<QMetaObject::Connection>(
                new QMetaObject::Connection( connect( m_audioFile.get(), &QBassAudioFile::playStarted, [this, playButton](){
       playButton->setIcon( playButton->style()->standardIcon(QStyle::SP_MediaPause) );
-      if ( !m_isGenerateStarted )
-      {
-         sPlayEventDistributor.sendSequenseEvent( this );
-         emit playStarted( shared_from_this() );
-      }
+      sPlayEventDistributor.sendSequenseEvent( this );
+      emit playStarted( shared_from_this() );
    })), deleter ));
 
 
    m_conncetionToDestroy.push_back( std::shared_ptr<QMetaObject::Connection>(
                new QMetaObject::Connection( connect( m_audioFile.get(), &QBassAudioFile::playStoped, [this, playButton](){
       playButton->setIcon( playButton->style()->standardIcon(QStyle::SP_MediaPlay) );
-      if ( !m_isGenerateStarted )
-      {
-         emit playStoped( shared_from_this() );
-      }
+      emit playStoped( shared_from_this() );
    })), deleter ));
 
 
@@ -183,10 +168,7 @@ std::vector<QWidget *> CLightSequence::getControlWidgets()
                new QMetaObject::Connection( connect( m_audioFile.get(), &QBassAudioFile::playFinished, [this, playButton](){
       playButton->setIcon( playButton->style()->standardIcon(QStyle::SP_MediaPlay) );
       qDebug() << "emit emit playFinished( shared_from_this() );" ;
-      if ( !m_isGenerateStarted )
-      {
-         emit playFinished( shared_from_this() );
-      }
+      emit playFinished( shared_from_this() );
    })), deleter ));
 
 
@@ -214,71 +196,42 @@ std::vector<QWidget *> CLightSequence::getControlWidgets()
 
    //*************************************************************
 
-   std::shared_ptr<QMetaObject::Connection> connectionFinishPtr( new QMetaObject::Connection(), deleter );
-
-   m_conncetionToDestroy.push_back( connectionFinishPtr );
+   deleteButton->setDisabled( m_isGenerateStarted );
+   labelStatus->setText( m_isGenerateStarted ? "Started" : "" );
 
-   auto genStop = [=]()
-   {
-      playButton->setDisabled(false);
-      trackPosition->setDisabled(false);
-      deleteButton->setDisabled(false);
-      m_isGenerateStarted = false;
-      disconnect(*connectionFinishPtr);
-      m_audioFile->stop();
-      trackVolume->setValue(100);
-      m_audioFile->setVolume(1.0f);
-   };
+   m_conncetionToDestroy.push_back( std::shared_ptr<QMetaObject::Connection>(
+               new QMetaObject::Connection( connect( this, &CLightSequence::generationStarted, [ deleteButton, labelStatus ]( std::weak_ptr<CLightSequence> ){
+      deleteButton->setDisabled( true );
+      labelStatus->setText( "Started" );
+   })), deleter ));
 
-   auto getStart = [=]()
-   {
-      playButton->setDisabled(true);
-      trackPosition->setDisabled(true);
-      deleteButton->setDisabled(true);
-      trackVolume->setValue(0);
-      labelStatus->setText("Started");
-
-      (*connectionFinishPtr) = connect( m_audioFile.get(), &QBassAudioFile::playFinished, [ this, genStop, labelStatus ](){
-         if ( CSequenseGenerator::generateLms( this ) )
-         {
-             labelStatus->setText("Done");
-         }
-         else
-         {
-             labelStatus->setText("Done with error");
-         }
-         emit generationFinished( shared_from_this() );
-         genStop();
-      });
+   m_conncetionToDestroy.push_back( std::shared_ptr<QMetaObject::Connection>(
+               new QMetaObject::Connection( connect( this, &CLightSequence::generationStoped, [ deleteButton, labelStatus ]( std::weak_ptr<CLightSequence> ){
+      deleteButton->setDisabled( false );
+      labelStatus->setText( "Stoped" );
+   })), deleter ));
 
-   };
+   m_conncetionToDestroy.push_back( std::shared_ptr<QMetaObject::Connection>(
+               new QMetaObject::Connection( connect( this, &CLightSequence::generationFinished, [ deleteButton, labelStatus ]( std::weak_ptr<CLightSequence>, bool isSuccess ){
+      deleteButton->setDisabled( false );
+      labelStatus->setText( isSuccess ? "Done" : "Done with error" );
+   })), deleter ));
 
 
    auto startButton = new QPushButton("Generate");
    startButton->setIcon(QIcon(":/images/record.png"));
-   connect(startButton, &QPushButton::clicked, [ this, connectionFinishPtr, labelStatus, genStop, getStart ](bool){
+   connect(startButton, &QPushButton::clicked, [ this ](bool){
 
       if ( m_isGenerateStarted )
       {
-         genStop();
-         labelStatus->setText("Stoped");
+         stopGeneration();
       }
       else
       {
-         m_isGenerateStarted = true;
-         m_audioFile->resetFFTData();
-         m_audioFile->setVolume(0.0f);
-         m_audioFile->play();
-         emit generationStarted( shared_from_this() );
-         getStart();
+         startGeneration();
       }
    });
 
-   if ( m_isGenerateStarted )
-   {
-      getStart();
-   }
-
    //*************************************************************
 
    controlWidgets.clear();
@@ -307,13 +260,111 @@ CLightSequence::CLightSequence(const std::string &fileName,
     , m_audioFile( nullptr )
     , m_channelConfiguration( std::move( channelConfiguration ) )
     , m_isGenerateStarted( false )
+    , m_generateWatcher( new QFutureWatcher< bool >( this ) )
+    , m_generateCanceled( std::make_shared<std::atomic_bool>( false ) )
+    , m_isBeatDetectionStarted( false )
+    , m_beatCanceled( std::make_shared<std::atomic_bool>( false ) )
+    , m_beats( nullptr )
+    , m_spectrum( nullptr )
+    , m_beatWatcher( new QFutureWatcher< TrackAnalysis >( this ) )
 {
    m_audioFile = QBassAudioFile::get(m_fileName);
+
+   connect( m_generateWatcher, &QFutureWatcherBase::finished, this, [ this ](){
+      if ( !m_isGenerateStarted )
+      {
+         return;
+      }
+      m_isGenerateStarted = false;
+
+      emit generationFinished( shared_from_this(), m_generateWatcher->result() );
+   });
+
+   connect( m_beatWatcher, &QFutureWatcherBase::finished, this, [ this ](){
+      const TrackAnalysis analysis = m_beatWatcher->result();
+      m_beats = analysis.beats;
+      m_spectrum = analysis.spectrum;
+      emit analysisFinished( shared_from_this() );
+      emit configurationChanged( shared_from_this() );
+   });
+}
+
+
+void CLightSequence::startBeatDetection()
+{
+   if ( m_isBeatDetectionStarted )
+   {
+      return;
+   }
+   m_isBeatDetectionStarted = true;
+
+   // Same parameters as the generation, so the cached spectrum is shared with it
+   CSpectrumAnalyzer::Parameters parameters;
+   parameters.hopMs = m_configuration.getAnalysisHopMs();
+   parameters.fftSize = m_configuration.getAnalysisFFTSize();
+   parameters.window = m_configuration.getAnalysisWindow();
+
+   auto fileName = m_fileName;
+   auto isCanceled = m_beatCanceled;
+   m_beatWatcher->setFuture( QtConcurrent::run( [ fileName, parameters, isCanceled ]() {
+      auto spectrum = std::make_shared<SpectrumStore>();
+      if ( !CSpectrumCache::analyse( fileName, *spectrum, parameters, isCanceled.get() ) )
+      {
+         return TrackAnalysis();
+      }
+
+      auto beats = std::make_shared<BeatTrack>( CBeatDetector::detect( *spectrum ) );
+      qDebug() << "Beats of" << fileName.c_str() << ":" << beats->bpm << "BPM," << beats->beats.size() << "beats";
+
+      // Kept for the effects to render over
+      TrackAnalysis analysis;
+      analysis.spectrum = spectrum;
+      analysis.beats = beats;
+      return analysis;
+   } ) );
+}
+
+
+void CLightSequence::startGeneration()
+{
+   if ( m_isGenerateStarted )
+   {
+      return;
+   }
+
+   m_isGenerateStarted = true;
+
+   // Each run gets its own flag, so a canceled analysis that is still
+   // unwinding cannot be confused with the next one
+   m_generateCanceled = std::make_shared<std::atomic_bool>( false );
+
+   // Decode, analysis and .lms render all run on the global thread pool,
+   // which has one thread per core, so several sequenses generate in parallel
+   auto snapshot = CSequenseGenerator::makeSnapshot( serialize(), m_configuration );
+   auto isCanceled = m_generateCanceled;
+   m_generateWatcher->setFuture( QtConcurrent::run( [ snapshot, isCanceled ]() {
+      return CSequenseGenerator::generate( snapshot, isCanceled.get() );
+   } ) );
+
+   emit generationStarted( shared_from_this() );
+}
+
+
+void CLightSequence::stopGeneration()
+{
+   if ( m_isGenerateStarted )
+   {
+      m_generateCanceled->store( true );
+      m_isGenerateStarted = false;
+      emit generationStoped( shared_from_this() );
+   }
 }
 
 
 void CLightSequence::destroy()
 {
+   m_generateCanceled->store( true );
+   m_beatCanceled->store( true );
    m_conncetionToDestroy.clear();
    if ( m_audioFile )
    {
@@ -347,6 +398,19 @@ void CLightSequence::channelConfigurationUpdated()
          m_channelConfiguration.push_back( std::make_shared<SequenceChannelConfigation>( channel.uuid ));
       }
    }
+
+   notifyConfigurationChanged();
+}
+
+void CLightSequence::notifyConfigurationChanged()
+{
+   emit configurationChanged( shared_from_this() );
+}
+
+void CLightSequence::notifyEffectChanged( const QUuid &effectUuid )
+{
+   emit effectChanged( shared_from_this(), effectUuid );
+   notifyConfigurationChanged();
 }
 
 QJsonObject CLightSequence::serialize() const
@@ -2,15 +2,18 @@
 
 #include <QObject>
 #include <QJsonObject>
+#include <QFutureWatcher>
 
 #include "qbassaudiofile.h"
 #include "CConfiguration.h"
 #include "constants.h"
+#include <atomic>
 #include <memory>
 #include <list>
 #include <QSlider>
 #include <QLabel>
 #include "timeline/IEffectGenerator.h"
+#include "cbeatdetector.h"
 
 
 class CLightSequence;
@@ -102,6 +105,9 @@ public:
    std::vector<QWidget *> getControlWidgets();
 
    bool isGenerateStarted() const { return m_isGenerateStarted; }
+
+   void startGeneration();
+   void stopGeneration();
 signals:
    void deleteTriggered( std::weak_ptr<CLightSequence> thisObject );
    void generationStarted( std::weak_ptr<CLightSequence> thisObject );
@@ -110,7 +116,11 @@ signals:
    void playFinished( std::weak_ptr<CLightSequence> thisObject );
    void moveUp( std::weak_ptr<CLightSequence> thisObject );
    void moveDown( std::weak_ptr<CLightSequence> thisObject );
-   void generationFinished( std::weak_ptr<CLightSequence> thisObject );
+   void generationStoped( std::weak_ptr<CLightSequence> thisObject );
+   void generationFinished( std::weak_ptr<CLightSequence> thisObject, bool isSuccess );
+   void analysisFinished( std::weak_ptr<CLightSequence> thisObject );
+   void configurationChanged( std::weak_ptr<CLightSequence> thisObject );
+   void effectChanged( std::weak_ptr<CLightSequence> thisObject, QUuid effectUuid );
    void positionChanged(const SpectrumData& spectrum);
 
 private:
@@ -120,6 +130,12 @@ private:
 public:
    void channelConfigurationUpdated();
 
+   // Channel settings or effects of the sequense were edited, or effects rendered again
+   void notifyConfigurationChanged();
+
+   // An effect was added, removed, moved or edited, the configuration changed with it
+   void notifyEffectChanged( const QUuid& effectUuid );
+
    QJsonObject serialize() const;
 
    std::shared_ptr<SequenceChannelConfigation> getConfiguration( const QUuid& uuid ) const;
@@ -132,6 +148,23 @@ public:
 
    const std::shared_ptr<QBassAudioFile>& getAudioFile() const { return m_audioFile; }
 
+   // Null until the background analysis started by the first play or the effect editor has finished
+   const std::shared_ptr<const BeatTrack>& getBeats() const { return m_beats; }
+
+   // Spectrum the beats were detected in, null as long as the beats
+   const std::shared_ptr<const SpectrumStore>& getSpectrum() const { return m_spectrum; }
+
+   // Analysis of the whole track in the background, once
+   void startBeatDetection();
+
+private:
+
+   struct TrackAnalysis
+   {
+      std::shared_ptr<const SpectrumStore> spectrum;
+      std::shared_ptr<const BeatTrack> beats;
+   };
+
 private:
 
    static IInnerCommunicationGlue sPlayEventDistributor;
@@ -145,5 +178,13 @@ private:
     std::list<std::shared_ptr<QMetaObject::Connection>> m_conncetionToDestroy;
 
     bool m_isGenerateStarted;
+    QFutureWatcher< bool >* m_generateWatcher;
+    std::shared_ptr<std::atomic_bool> m_generateCanceled;
+
+    bool m_isBeatDetectionStarted;
+    std::shared_ptr<std::atomic_bool> m_beatCanceled;
+    std::shared_ptr<const BeatTrack> m_beats;
+    std::shared_ptr<const SpectrumStore> m_spectrum;
+    QFutureWatcher< TrackAnalysis >* m_beatWatcher;
 };
 
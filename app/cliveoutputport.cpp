@@ -0,0 +1,268 @@
+#include "cliveoutputport.h"
+#include "ctrace.h"
+#include <QDebug>
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <limits>
+
+const uint8_t    cHearbeatData[] = { 0x00, 0xFF, 0x81, 0x56, 0x00 };
+constexpr auto   cChannelsPerUnit = 32;
+constexpr auto   cReportMs = 1000;
+
+// 8N1, ten bits on the line for every byte
+constexpr auto   cBitsPerByte = 10;
+
+// Brightness of a level byte in level steps, off is 0 and full is 200
+static int levelSteps( uint8_t level )
+{
+    if ( 0xf0 == level )
+    {
+        return 0;
+    }
+    if ( 0x01 == level )
+    {
+        return 200;
+    }
+    return std::max( 0, std::min( 200, 230 - int(level) ) );
+}
+
+CLiveOutputPort::CLiveOutputPort( const OutputPort &port )
+    : m_name( port.name )
+    , m_baudRate( static_cast<qint32>( port.baudRate ) )
+{
+    m_serial.setPortName( m_name );
+    m_serial.setBaudRate( m_baudRate );
+    open();
+
+    m_nextHeartbeat = Clock::now();
+    m_nextReport = m_nextHeartbeat + std::chrono::milliseconds( cReportMs );
+}
+
+void CLiveOutputPort::setDeltaParams( uint32_t hysteresis, std::chrono::milliseconds refreshPeriod )
+{
+    m_hysteresis = hysteresis;
+    m_refreshPeriod = refreshPeriod;
+}
+
+void CLiveOutputPort::setLog( COutputLog *log, uint8_t index )
+{
+    m_log = log;
+    m_logIndex = index;
+}
+
+std::size_t CLiveOutputPort::slot( const Channel& channel )
+{
+    auto encoder = CIntensityEncoder::get( CIntensityEncoder::EFormat::LOR, channel.voltage, channel.curve );
+
+    int channelIndex = channel.unit * cChannelsPerUnit + channel.channel;
+    auto it = m_slotIndex.find( channelIndex );
+    if ( m_slotIndex.end() != it )
+    {
+        m_slots[ it->second ].encoder = encoder;
+        return it->second;
+    }
+
+    Slot slot( encoder );
+    slot.unit = static_cast<uint8_t>( channel.unit );
+    slot.channel = channel.channel;
+    m_slots.push_back( slot );
+
+    // Every slot may be queued once per frame
+    m_updates.reserve( m_slots.size() );
+
+    m_slotIndex[ channelIndex ] = m_slots.size() - 1;
+    return m_slots.size() - 1;
+}
+
+void CLiveOutputPort::open()
+{
+    // Whatever was sent before may not have arrived
+    for ( auto& slot : m_slots )
+    {
+        slot.isSent = false;
+        slot.isDeferred = false;
+    }
+
+    if ( !m_name.isEmpty() && !m_serial.open( QIODevice::WriteOnly ) )
+    {
+        qDebug() << "Was not able to open" << m_name << m_serial.errorString();
+    }
+}
+
+void CLiveOutputPort::beginFrame( Clock::time_point now )
+{
+    m_frame.clear();
+
+    if ( now < m_nextHeartbeat )
+    {
+        return;
+    }
+    m_nextHeartbeat = now + std::chrono::milliseconds( cHeartbeatMs );
+
+    if ( QSerialPort::NoError != m_serial.error() )
+    {
+        qDebug() << "Serial port error:" << m_name << m_serial.error() << m_serial.errorString();
+        m_serial.clearError();
+        if ( m_serial.isOpen() )
+        {
+            m_serial.close();
+        }
+    }
+
+    if ( !m_serial.isOpen() && !m_name.isEmpty() )
+    {
+        open();
+    }
+
+    if ( m_serial.isOpen() )
+    {
+        m_frame.insert( m_frame.end(), std::begin( cHearbeatData ), std::end( cHearbeatData ) );
+    }
+}
+
+void CLiveOutputPort::queueIntensity( std::size_t slotIndex, double intensity, Clock::time_point now )
+{
+    Slot& slot = m_slots[ slotIndex ];
+    const uint8_t level = slot.encoder.encode( intensity );
+
+    // Never sent, the controller state is unknown
+    double priority = 1.0 + levelSteps( 0x01 );
+
+    if ( slot.isSent )
+    {
+        const auto age = now - slot.sentAt;
+        if ( age < m_refreshPeriod && !isLevelChanged( slot.level, level ) )
+        {
+            // Deferred change is not needed any more, it never made it to the line
+            if ( slot.isDeferred )
+            {
+                slot.isDeferred = false;
+                ++m_statistics.dropped;
+            }
+            return;
+        }
+
+        // Bigger error first, the longer a channel waits the more it counts
+        const double error = std::abs( levelSteps( level ) - levelSteps( slot.level ) );
+        const double waited = std::chrono::duration<double>( age ).count()
+                            / std::chrono::duration<double>( m_refreshPeriod ).count();
+        priority = ( 1.0 + error ) * ( 1.0 + waited );
+    }
+
+    m_updates.push_back( Update{ slotIndex, level, priority } );
+}
+
+void CLiveOutputPort::endFrame( Clock::time_point now )
+{
+    scheduleUpdates( now );
+    m_encoder.encode( m_frame );
+
+    if ( m_serial.isOpen() && !m_frame.empty() )
+    {
+        m_serial.write( reinterpret_cast<const char*>( m_frame.data() ), static_cast<qint64>( m_frame.size() ) );
+        m_statistics.bytes += m_frame.size();
+
+        if ( nullptr != m_log )
+        {
+            m_log->append( m_logIndex, Clock::now(), m_frame.data(), m_frame.size() );
+        }
+    }
+    TRACE( ETraceCategory::Serial, ETraceEvent::SerialWrite, m_frame.size(), m_statistics.deferred );
+
+    // Completes pending writes, the port has no event loop to do it
+    if ( m_serial.isOpen() && m_serial.bytesToWrite() > 0 )
+    {
+        m_serial.waitForBytesWritten( 0 );
+    }
+
+    report( now );
+}
+
+void CLiveOutputPort::scheduleUpdates( Clock::time_point now )
+{
+    if ( !m_serial.isOpen() )
+    {
+        m_updates.clear();
+        return;
+    }
+
+    std::size_t budget = frameBudget();
+    budget = budget > m_frame.size() ? budget - m_frame.size() : 0;
+
+    // Ties by slot keep the order stable without the buffer of stable_sort
+    std::sort( m_updates.begin(), m_updates.end(), []( const Update& left, const Update& right ){
+        return left.priority != right.priority ? left.priority > right.priority : left.slot < right.slot;
+    });
+
+    std::size_t used = 0;
+    for ( const auto& update : m_updates )
+    {
+        Slot& slot = m_slots[ update.slot ];
+
+        // Later channels may still join a masked command already in the frame
+        const std::size_t size = m_encoder.addedSize( slot.unit, slot.channel, update.level );
+        if ( used + size > budget )
+        {
+            slot.isDeferred = true;
+            ++m_statistics.deferred;
+            continue;
+        }
+
+        used += size;
+        m_encoder.add( slot.unit, slot.channel, update.level );
+        slot.level = update.level;
+        slot.sentAt = now;
+        slot.isSent = true;
+        slot.isDeferred = false;
+    }
+
+    m_updates.clear();
+}
+
+std::size_t CLiveOutputPort::frameBudget()
+{
+    if ( m_baudRate <= 0 )
+    {
+        return std::numeric_limits<std::size_t>::max();
+    }
+
+    const qint64 bytesPerFrame = qint64( m_baudRate ) * cLiveFrameMs / ( cBitsPerByte * 1000 );
+    const qint64 queued = m_serial.bytesToWrite();
+    return queued < bytesPerFrame ? static_cast<std::size_t>( bytesPerFrame - queued ) : 0;
+}
+
+void CLiveOutputPort::report( Clock::time_point now )
+{
+    if ( now < m_nextReport )
+    {
+        return;
+    }
+    m_nextReport = now + std::chrono::milliseconds( cReportMs );
+
+    if ( m_statistics.deferred != m_reported.deferred || m_statistics.dropped != m_reported.dropped )
+    {
+        qDebug() << "Serial line" << m_name << "over budget:"
+                 << ( m_statistics.deferred - m_reported.deferred ) << "updates deferred,"
+                 << ( m_statistics.dropped - m_reported.dropped ) << "dropped,"
+                 << ( m_statistics.bytes - m_reported.bytes ) << "bytes sent in" << cReportMs << "ms";
+    }
+    m_reported = m_statistics;
+}
+
+bool CLiveOutputPort::isLevelChanged( uint8_t sent, uint8_t level ) const
+{
+    if ( sent == level )
+    {
+        return false;
+    }
+
+    // Off and full are not on the scale, a channel must always reach them exactly
+    if ( 0xf0 == sent || 0x01 == sent || 0xf0 == level || 0x01 == level )
+    {
+        return true;
+    }
+
+    auto difference = sent > level ? sent - level : level - sent;
+    return static_cast<uint32_t>( difference ) > m_hysteresis;
+}
@@ -0,0 +1,111 @@
+#ifndef CLIVEOUTPUTPORT_H
+#define CLIVEOUTPUTPORT_H
+
+#include <QString>
+#include <QtSerialPort/QSerialPort>
+#include <chrono>
+#include <map>
+#include <vector>
+#include "CConfiguration.h"
+#include "clorframeencoder.h"
+#include "coutputlog.h"
+#include "IOutputBackend.h"
+
+/**
+ * LOR backend, writer of one serial line of the live output.
+ *
+ * The port keeps a shadow of the level byte last sent to each unit and
+ * channel, one dense slot per channel. A channel is written only when its level moved by more than the
+ * hysteresis or its last write is older than the refresh period, so quiet
+ * passages cost next to nothing on the line. The shadow is dropped whenever
+ * the port is (re)opened, the controllers get every channel again.
+ *
+ * Heartbeat and channel commands of a frame are packed by CLORFrameEncoder
+ * into one buffer and written with a single call.
+ *
+ * A frame never carries more bytes than the baud rate moves in cLiveFrameMs,
+ * less what is still queued in the port. Over budget the channels with the
+ * biggest level error go first, waiting raises the priority of the others.
+ * A deferred channel stays pending only as its shadow entry, so nothing
+ * queues up behind the music.
+ *
+ * With a COutputLog set every write is also appended to the log.
+ */
+class CLiveOutputPort : public IOutputBackend
+{
+public:
+
+   CLiveOutputPort( const OutputPort& port );
+
+   const QString& name() const override { return m_name; }
+   bool isOpen() const override { return m_serial.isOpen(); }
+   const Statistics& statistics() const override { return m_statistics; }
+
+   void setDeltaParams( uint32_t hysteresis, std::chrono::milliseconds refreshPeriod ) override;
+
+   // Null stops logging, index is the port in the log
+   void setLog( COutputLog* log, uint8_t index ) override;
+
+   std::size_t slot( const Channel& channel ) override;
+
+   // Reopens a failed port and adds the heartbeat when it is due
+   void beginFrame( Clock::time_point now ) override;
+
+   void queueIntensity( std::size_t slot, double intensity, Clock::time_point now ) override;
+
+   // Writes what fits in the line budget and completes pending writes
+   void endFrame( Clock::time_point now ) override;
+
+private:
+
+   struct Slot
+   {
+      explicit Slot( const CIntensityEncoder& aencoder ) : encoder( aencoder ) {}
+
+      CIntensityEncoder encoder;
+      uint8_t unit = 0;
+      uint32_t channel = 0;
+      uint8_t level = 0;             // last sent, valid if isSent
+      Clock::time_point sentAt;
+      bool isSent = false;
+      bool isDeferred = false;
+   };
+
+   struct Update
+   {
+      std::size_t slot;
+      uint8_t level;
+      double priority;
+   };
+
+   void open();
+   void scheduleUpdates( Clock::time_point now );
+   std::size_t frameBudget();
+   void report( Clock::time_point now );
+
+   bool isLevelChanged( uint8_t sent, uint8_t level ) const;
+
+private:
+
+   QString m_name;
+   qint32 m_baudRate;
+   QSerialPort m_serial;
+   uint32_t m_hysteresis = cDefaultOutputHysteresis;
+   std::chrono::milliseconds m_refreshPeriod{ cDefaultOutputRefreshMs };
+
+   std::map< int /*unit*32+channel*/, std::size_t > m_slotIndex;
+   std::vector<Slot> m_slots;
+   std::vector<Update> m_updates;
+   CLORFrameEncoder m_encoder;
+   std::vector<uint8_t> m_frame;
+
+   COutputLog* m_log = nullptr;
+   uint8_t m_logIndex = 0;
+
+   Clock::time_point m_nextHeartbeat;
+   Clock::time_point m_nextReport;
+   Statistics m_statistics;
+   Statistics m_reported;
+};
+
+#endif // CLIVEOUTPUTPORT_H
@@ -0,0 +1,473 @@
+#include "cliveoutputthread.h"
+#include <QMutexLocker>
+#include <QDebug>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include "qbassaudiofile.h"
+#include "ce131output.h"
+#include "cliveoutputport.h"
+#include "constants.h"
+#include "ctrace.h"
+
+constexpr auto   cChannelsPerUnit = 32;
+
+static std::unique_ptr<IOutputBackend> makeBackend( const OutputPort& port )
+{
+    switch ( port.type )
+    {
+    case EOutputType::E131:
+        return std::unique_ptr<IOutputBackend>( new CE131Output( port ) );
+    case EOutputType::LOR:
+        break;
+    }
+    return std::unique_ptr<IOutputBackend>( new CLiveOutputPort( port ) );
+}
+
+CLiveOutputThread::CLiveOutputThread( QObject *parent )
+    : QThread( parent )
+    , m_isOpen( false )
+    , m_isStopping( false )
+    , m_sentBytes( 0 )
+    , m_deferredUpdates( 0 )
+    , m_droppedUpdates( 0 )
+{
+}
+
+CLiveOutputThread::~CLiveOutputThread()
+{
+    stop();
+}
+
+void CLiveOutputThread::setPorts( const std::vector<OutputPort> &ports )
+{
+    QMutexLocker lock( &m_mutex );
+    if ( ports != m_pendingPorts )
+    {
+        m_pendingPorts = ports;
+        m_isPortChanged = true;
+    }
+}
+
+void CLiveOutputThread::setDeltaParams( uint32_t hysteresis, uint32_t refreshMs )
+{
+    QMutexLocker lock( &m_mutex );
+    m_pendingHysteresis = hysteresis;
+    m_pendingRefreshMs = refreshMs;
+}
+
+void CLiveOutputThread::setLog( const QString &fileName )
+{
+    QMutexLocker lock( &m_mutex );
+    m_pendingLogFileName = fileName;
+    m_isLogChanged = true;
+}
+
+void CLiveOutputThread::publish( const std::shared_ptr<Setup> &setup )
+{
+    QMutexLocker lock( &m_mutex );
+    m_pendingSetup = setup;
+    m_isSetupPending = true;
+}
+
+void CLiveOutputThread::stop()
+{
+    m_isStopping.store( true );
+    wait();
+}
+
+CLiveOutputThread::Statistics CLiveOutputThread::statistics() const
+{
+    Statistics statistics;
+    statistics.bytes = m_sentBytes.load();
+    statistics.deferred = m_deferredUpdates.load();
+    statistics.dropped = m_droppedUpdates.load();
+    return statistics;
+}
+
+void CLiveOutputThread::run()
+{
+    {
+        QMutexLocker lock( &m_mutex );
+        m_isPortChanged = true;
+    }
+
+    const auto period = std::chrono::milliseconds( cLiveFrameMs );
+    auto nextFrame = Clock::now();
+
+    while ( !m_isStopping.load() )
+    {
+        updatePorts();
+        updateLog();
+
+        std::shared_ptr<Setup> setup;
+        bool isSetupPending = false;
+        uint32_t hysteresis = 0;
+        uint32_t refreshMs = 0;
+        {
+            QMutexLocker lock( &m_mutex );
+            std::swap( isSetupPending, m_isSetupPending );
+            setup = std::move( m_pendingSetup );
+            hysteresis = m_pendingHysteresis;
+            refreshMs = m_pendingRefreshMs;
+        }
+        if ( isSetupPending )
+        {
+            adopt( setup );
+        }
+
+        auto now = Clock::now();
+        bool isOpen = false;
+        for ( auto& port : m_ports )
+        {
+            port->setDeltaParams( hysteresis, std::chrono::milliseconds( refreshMs ) );
+            port->beginFrame( now );
+            isOpen = isOpen || port->isOpen();
+        }
+        m_isOpen.store( isOpen );
+
+        renderFrame( now );
+
+        for ( auto& port : m_ports )
+        {
+            port->endFrame( now );
+        }
+        updateStatistics();
+
+        // Late frames are dropped rather than sent in a burst
+        nextFrame += period;
+        now = Clock::now();
+        if ( nextFrame < now )
+        {
+            nextFrame = now;
+        }
+        std::this_thread::sleep_until( nextFrame );
+    }
+
+    // Ports are closed on the thread that opened them
+    updateStatistics();
+    m_unitPorts.clear();
+    m_ports.clear();
+    m_log.close();
+    m_isOpen.store( false );
+}
+
+void CLiveOutputThread::updatePorts()
+{
+    std::vector<OutputPort> ports;
+    {
+        QMutexLocker lock( &m_mutex );
+        if ( !m_isPortChanged )
+        {
+            return;
+        }
+        m_isPortChanged = false;
+        ports = m_pendingPorts;
+    }
+
+    // Ports defined as before stay open, the others are closed
+    auto previous = std::move( m_ports );
+    auto previousParams = std::move( m_portParams );
+    m_unitPorts.clear();
+    m_ports.clear();
+    m_portParams = ports;
+
+    for ( const auto& port : ports )
+    {
+        auto it = std::find( previousParams.begin(), previousParams.end(), port );
+        const auto index = std::size_t( it - previousParams.begin() );
+        if ( previousParams.end() != it && nullptr != previous[ index ] )
+        {
+            m_ports.push_back( std::move( previous[ index ] ) );
+        }
+        else
+        {
+            m_ports.push_back( makeBackend( port ) );
+        }
+
+        for ( auto unit : port.units )
+        {
+            if ( !m_unitPorts.insert( { unit, m_ports.back().get() } ).second )
+            {
+                qWarning() << "Unit" << unit << "is mapped to more than one port, kept on the first";
+            }
+        }
+    }
+
+    for ( const auto& port : previous )
+    {
+        if ( nullptr != port )
+        {
+            m_closedPortsStatistics += port->statistics();
+        }
+    }
+    previous.clear();
+
+    // Slots point to the ports
+    compile();
+    attachLog();
+}
+
+void CLiveOutputThread::updateLog()
+{
+    QString fileName;
+    {
+        QMutexLocker lock( &m_mutex );
+        if ( !m_isLogChanged )
+        {
+            return;
+        }
+        m_isLogChanged = false;
+        fileName = m_pendingLogFileName;
+    }
+
+    m_log.close();
+    if ( !fileName.isEmpty() )
+    {
+        m_log.open( fileName );
+    }
+    attachLog();
+}
+
+void CLiveOutputThread::attachLog()
+{
+    const bool isLogging = m_log.isOpen();
+    for ( std::size_t i = 0; i < m_ports.size(); ++i )
+    {
+        const auto index = static_cast<uint8_t>( i );
+        if ( isLogging )
+        {
+            m_log.addPort( index, m_portParams[ i ] );
+        }
+        m_ports[ i ]->setLog( isLogging ? &m_log : nullptr, index );
+    }
+}
+
+IOutputBackend *CLiveOutputThread::portOf( uint32_t unit ) const
+{
+    auto it = m_unitPorts.find( unit );
+    if ( m_unitPorts.end() != it )
+    {
+        return it->second;
+    }
+    return m_ports.empty() ? nullptr : m_ports.front().get();
+}
+
+void CLiveOutputThread::updateStatistics()
+{
+    Statistics total = m_closedPortsStatistics;
+    for ( const auto& port : m_ports )
+    {
+        total += port->statistics();
+    }
+    m_sentBytes.store( total.bytes );
+    m_deferredUpdates.store( total.deferred );
+    m_droppedUpdates.store( total.dropped );
+}
+
+void CLiveOutputThread::adopt( const std::shared_ptr<Setup> &setup )
+{
+    if ( nullptr == setup || nullptr == m_setup || setup->stream != m_setup->stream )
+    {
+        m_intensityKeys.clear();
+        m_intensity.clear();
+        m_position = 0;
+    }
+
+    // The indexes compare effects by address, the old ones have to stay
+    // alive until compile() is done with them
+    auto previousSetup = std::move( m_setup );
+    m_setup = setup;
+    compile();
+}
+
+void CLiveOutputThread::compile()
+{
+    // Intensities go on by unit and channel, a new setup does not restart the fades
+    std::map< int, double > previous;
+    for ( std::size_t i = 0; i < m_intensityKeys.size(); ++i )
+    {
+        previous[ m_intensityKeys[ i ] ] = m_intensity[ i ];
+    }
+
+    // Effect indexes go on by channel, only effects that changed are moved in or out
+    std::map< QUuid, std::size_t > previousIndexes;
+    for ( std::size_t i = 0; i < m_effectIndexes.size(); ++i )
+    {
+        previousIndexes.insert( { m_effectIndexes[ i ].first, i } );
+    }
+    auto effectIndexes = std::move( m_effectIndexes );
+    m_effectIndexes.clear();
+
+    m_slots.clear();
+    m_intensityKeys.clear();
+    m_intensity.clear();
+    m_isBandLayoutDirty = true;
+
+    if ( nullptr == m_setup )
+    {
+        return;
+    }
+
+    std::map< int, std::size_t > intensityIndex;
+    for ( const auto& setup : m_setup->channels )
+    {
+        const Channel& channel = setup.channel;
+        const int key = channel.unit * cChannelsPerUnit + channel.channel;
+
+        auto indexIt = intensityIndex.find( key );
+        if ( intensityIndex.end() == indexIt )
+        {
+            auto previousIt = previous.find( key );
+            m_intensityKeys.push_back( key );
+            m_intensity.push_back( previous.end() != previousIt ? previousIt->second : 0.0 );
+            indexIt = intensityIndex.insert( { key, m_intensity.size() - 1 } ).first;
+        }
+
+        Slot slot;
+        slot.setup = &setup;
+        slot.port = portOf( channel.unit );
+        slot.portSlot = nullptr != slot.port ? slot.port->slot( channel ) : 0;
+        slot.intensityIndex = indexIt->second;
+        slot.fadePerMs = 1.0 / ( 1000.0 * ( channel.fade < 0.1 ? 0.1 : channel.fade ) );
+        m_slots.push_back( slot );
+
+        m_effectIndexes.emplace_back( channel.uuid, CEffectIntervalIndex() );
+        auto previousIt = previousIndexes.find( channel.uuid );
+        if ( previousIndexes.end() != previousIt )
+        {
+            m_effectIndexes.back().second = std::move( effectIndexes[ previousIt->second ].second );
+            previousIndexes.erase( previousIt );
+        }
+
+        std::vector<IEffectGenerator*> effects;
+        effects.reserve( setup.effects.size() );
+        for ( const auto& effect : setup.effects )
+        {
+            // The copy stays the same, the values rendered ahead come with every setup
+            effect.effect->renderCache().setSnapshot( effect.rendered );
+            effects.push_back( effect.effect.get() );
+        }
+        m_effectIndexes.back().second.assign( effects );
+    }
+}
+
+void CLiveOutputThread::renderFrame( Clock::time_point now )
+{
+    if ( nullptr == m_setup || BASS_ACTIVE_PLAYING != BASS_ChannelIsActive( m_setup->stream ) )
+    {
+        return;
+    }
+
+    if ( !QBassAudioFile::sample( m_setup->stream, m_setup->sampleRate, m_spectrum ) )
+    {
+        return;
+    }
+    m_spectrum.beats = m_setup->beats;
+
+    // A seek backwards is not a fade
+    auto dt = m_spectrum.position > m_position ? m_spectrum.position - m_position : 0;
+
+    const uint32_t binCount = m_spectrum.spectrum.size();
+
+    // One band per channel, a channel without a range takes the bin of its index
+    if ( m_isBandLayoutDirty
+         || binCount != m_bandLayout.binCount()
+         || m_spectrum.sampleRate != m_bandLayout.sampleRate() )
+    {
+        std::vector<CBandLayout::Band> bands;
+        bands.reserve( m_slots.size() );
+        for ( std::size_t i = 0; i < m_slots.size(); ++i )
+        {
+            const Channel& channel = m_slots[ i ].setup->channel;
+            bands.push_back( channel.band.isValid()
+                             ? channel.band
+                             : CBandLayout::spectrumIndexBand( channel.spectrumIndex, m_spectrum.sampleRate ) );
+        }
+
+        m_bandLayout = CBandLayout( bands, binCount, m_spectrum.sampleRate );
+        m_bandValues.resize( m_bandLayout.size() );
+        m_isBandLayoutDirty = false;
+    }
+    m_bandLayout.apply( m_spectrum.spectrum.data(), m_bandValues.data() );
+
+    // Effects read the frame of the analysed spectrum they were rendered from
+    const SpectrumStore* analysed = nullptr != m_setup->spectrum && !m_setup->spectrum->empty()
+                                    ? m_setup->spectrum.get()
+                                    : nullptr;
+    const std::size_t analysedIndex = nullptr != analysed ? analysed->indexAt( m_spectrum.position ) : 0;
+
+    for ( std::size_t i = 0; i < m_slots.size(); ++i )
+    {
+        const Slot& slot = m_slots[ i ];
+        const ChannelSetup& setup = *slot.setup;
+        const Channel& channel = setup.channel;
+        double& intensity = m_intensity[ slot.intensityIndex ];
+
+        bool useEffectValue = false;
+        double maxEffectValue = 0.0;
+
+        CEffectIntervalIndex& effects = m_effectIndexes[ i ].second;
+        if ( !effects.empty() )
+        {
+            for ( const auto& active : effects.active( int64_t( m_spectrum.position ) ) )
+            {
+                double effectValue = 0.0;
+                if ( nullptr != analysed )
+                {
+                    float value = 0.0f;
+                    active.effect->generate( *analysed, m_setup->beats, analysedIndex, 1, &value );
+                    effectValue = value;
+                }
+                else
+                {
+                    effectValue = active.effect->generate( m_spectrum, *active.state );
+                }
+                if ( effectValue > maxEffectValue )
+                {
+                    maxEffectValue = effectValue;
+                }
+                useEffectValue = true;
+            }
+        }
+
+        if ( intensity > 0.0 )
+        {
+            intensity -= slot.fadePerMs * double(dt);
+        }
+
+        if ( !useEffectValue )
+        {
+            auto value = m_bandValues[ i ] * channel.gain;
+
+            if ( value > intensity )
+            {
+                if ( value > 1.0 )
+                {
+                    intensity = 1.0;
+                }
+                else if ( value > setup.minimumLevel )
+                {
+                    intensity = value;
+                }
+            }
+        }
+        else
+        {
+            intensity = maxEffectValue;
+        }
+
+        if ( nullptr != slot.port )
+        {
+            slot.port->queueIntensity( slot.portSlot, intensity, now );
+        }
+    }
+
+    if ( m_frameObserver )
+    {
+        m_frameObserver( now, m_intensityKeys, m_intensity );
+    }
+
+    m_position = m_spectrum.position;
+    TRACE( ETraceCategory::Output, ETraceEvent::OutputFrame, m_spectrum.position, m_slots.size() );
+}
@@ -0,0 +1,184 @@
+#ifndef CLIVEOUTPUTTHREAD_H
+#define CLIVEOUTPUTTHREAD_H
+
+#include <QThread>
+#include <QMutex>
+#include <QString>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+#include <bass.h>
+#include "CConfiguration.h"
+#include "cbandlayout.h"
+#include "cbeatdetector.h"
+#include "coutputlog.h"
+#include "IOutputBackend.h"
+#include "SpectrumData.h"
+#include "timeline/CEffectIntervalIndex.h"
+#include "timeline/IEffectGenerator.h"
+
+/**
+ * Live output on a dedicated time critical thread.
+ *
+ * Frames are scheduled on a monotonic clock every cLiveFrameMs. A frame
+ * reads position and spectrum of the playing stream from BASS directly,
+ * renders the channel intensities and hands them to the outputs, so a
+ * busy GUI thread does not shift the lights against the audio.
+ *
+ * Channels follow the sampled spectrum. Timeline effects take the frame
+ * at the position from the analysed spectrum of the sequense and read the
+ * values rendered ahead for it, only frames out of date are evaluated.
+ * Until the analysis has finished they are evaluated on the sampled one.
+ *
+ * Every configured output is an IOutputBackend: a CLiveOutputPort with
+ * shadow, line budget and heartbeat for a LOR serial line, or a CE131Output
+ * for E1.31 universes. All of them are fed from the one rendered frame, a
+ * channel goes to the output its unit is mapped to. Writes do not block, so
+ * the outputs run in parallel.
+ *
+ * The GUI thread only publishes a Setup when the channel configuration
+ * changes. A Setup is never modified after publish, the effects in it are
+ * copies that belong to this thread.
+ *
+ * A setup is compiled into flat per channel arrays when it arrives or the
+ * ports change: port slot, fade slope, effect index and intensity index.
+ * A frame is one pass over them without lookups or allocations. The
+ * effects of a channel are in a CEffectIntervalIndex that follows the
+ * channel from setup to setup. The GUI hands an unchanged effect over as
+ * the same copy, so only effects added, removed or edited in the timeline
+ * are inserted into or removed from it.
+ *
+ * setLog() records every byte written to the ports into a COutputLog.
+ * setFrameObserver() sees the intensities of every rendered frame.
+ */
+class CLiveOutputThread : public QThread
+{
+public:
+
+   struct EffectSetup
+   {
+      QUuid uuid;           // of the effect in the sequense, the copy has its own
+      std::shared_ptr<IEffectGenerator> effect;
+      std::shared_ptr<const CEffectRenderCache::Rendered> rendered;  // by the effect, when published
+   };
+
+   struct ChannelSetup
+   {
+      Channel channel;      // gain, fade and band already overridden by the sequense
+      double minimumLevel;
+
+      // Effect copies, an unchanged effect is the same copy in every setup
+      std::vector<EffectSetup> effects;
+   };
+
+   struct Setup
+   {
+      HSTREAM stream = 0;
+      uint32_t sampleRate = 0;
+      std::shared_ptr<const BeatTrack> beats;
+      std::shared_ptr<const SpectrumStore> spectrum;   // analysed, null until the analysis has finished
+      std::vector<ChannelSetup> channels;
+   };
+
+   using Statistics = IOutputBackend::Statistics;
+   using Clock = IOutputBackend::Clock;
+
+   // Intensities of a frame by unit and channel, keys are unit*32+channel
+   using FrameObserver = std::function<void( Clock::time_point now,
+                                             const std::vector<int>& keys,
+                                             const std::vector<double>& intensities )>;
+
+   explicit CLiveOutputThread( QObject* parent = nullptr );
+   ~CLiveOutputThread() override;
+
+   // The ports are opened by the thread on its next frame, the first one
+   // takes every unit the others do not list
+   void setPorts( const std::vector<OutputPort>& ports );
+
+   // True if any port is open
+   bool isOpen() const { return m_isOpen.load(); }
+
+   // hysteresis in LOR level steps, 0 sends every change
+   void setDeltaParams( uint32_t hysteresis, uint32_t refreshMs );
+
+   // Recording starts on the next frame, an empty name stops it
+   void setLog( const QString& fileName );
+
+   // Taken over at the next frame, null stops the output
+   void publish( const std::shared_ptr<Setup>& setup );
+
+   void stop();
+
+   // Counted over all ports since the thread started
+   Statistics statistics() const;
+
+   // Called on the output thread after every rendered frame, set before start()
+   void setFrameObserver( const FrameObserver& observer ) { m_frameObserver = observer; }
+
+protected:
+   void run() override;
+
+private:
+
+   struct Slot
+   {
+      const ChannelSetup* setup;
+      IOutputBackend* port;          // null without any port
+      std::size_t portSlot;
+      std::size_t intensityIndex;    // shared by setups of the same unit channel
+      double fadePerMs;              // intensity lost per ms
+   };
+
+   void updatePorts();
+   void updateLog();
+   void attachLog();
+   void adopt( const std::shared_ptr<Setup>& setup );
+   void compile();
+   void renderFrame( Clock::time_point now );
+   IOutputBackend* portOf( uint32_t unit ) const;
+   void updateStatistics();
+
+private:
+
+   // Written by the GUI thread, guarded by m_mutex
+   QMutex m_mutex;
+   std::vector<OutputPort> m_pendingPorts;
+   bool m_isPortChanged = false;
+   std::shared_ptr<Setup> m_pendingSetup;
+   bool m_isSetupPending = false;
+   uint32_t m_pendingHysteresis = cDefaultOutputHysteresis;
+   uint32_t m_pendingRefreshMs = cDefaultOutputRefreshMs;
+   QString m_pendingLogFileName;
+   bool m_isLogChanged = false;
+
+   std::atomic_bool m_isOpen;
+   std::atomic_bool m_isStopping;
+   std::atomic<uint64_t> m_sentBytes;
+   std::atomic<uint64_t> m_deferredUpdates;
+   std::atomic<uint64_t> m_droppedUpdates;
+   FrameObserver m_frameObserver;
+
+   // Owned by the output thread
+   std::vector< std::unique_ptr<IOutputBackend> > m_ports;
+   std::vector<OutputPort> m_portParams;
+   std::map< uint32_t /*unit*/, IOutputBackend* > m_unitPorts;
+   COutputLog m_log;
+   Statistics m_closedPortsStatistics;
+   std::shared_ptr<Setup> m_setup;
+   uint64_t m_position = 0;
+   SpectrumData m_spectrum;
+
+   // Compiled from m_setup
+   std::vector<Slot> m_slots;
+   std::vector< std::pair< QUuid, CEffectIntervalIndex > > m_effectIndexes;  // per slot, by channel uuid
+   std::vector<int> m_intensityKeys;          // unit*32+channel
+   std::vector<double> m_intensity;
+   bool m_isBandLayoutDirty = true;
+   CBandLayout m_bandLayout;
+   std::vector<float> m_bandValues;
+};
+
+#endif // CLIVEOUTPUTTHREAD_H
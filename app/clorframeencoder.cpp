@@ -0,0 +1,132 @@
+#include "clorframeencoder.h"
+#include <algorithm>
+
+constexpr uint8_t  cCommandIntensity = 0x03;
+constexpr uint8_t  cCommandIntensityMask8 = 0x33;
+constexpr uint8_t  cCommandIntensityMask16 = 0x13;
+constexpr uint32_t cMaskChannels = 16;
+constexpr std::size_t cChannelCommandSize = 6;
+constexpr std::size_t cMask8CommandSize = 6;
+constexpr std::size_t cMask16CommandSize = 7;
+
+static bool isSingleChannel( uint16_t mask )
+{
+    return 0 == ( mask & ( mask - 1 ) );
+}
+
+void CLORFrameEncoder::add( uint8_t unit, uint32_t channel, uint8_t level )
+{
+    if ( channel >= 1 && channel <= cMaskChannels )
+    {
+        const auto bit = static_cast<uint16_t>( 1u << ( channel - 1 ) );
+        auto group = findGroup( unit, level );
+        if ( group < m_groups.size() )
+        {
+            m_groups[ group ].mask |= bit;
+        }
+        else
+        {
+            m_groups.push_back( Group{ unit, level, bit } );
+        }
+    }
+    else
+    {
+        m_singles.push_back( { { unit, channel }, level } );
+    }
+}
+
+std::size_t CLORFrameEncoder::addedSize( uint8_t unit, uint32_t channel, uint8_t level ) const
+{
+    if ( channel < 1 || channel > cMaskChannels )
+    {
+        return cChannelCommandSize;
+    }
+
+    auto group = findGroup( unit, level );
+    const uint16_t mask = group < m_groups.size() ? m_groups[ group ].mask : 0;
+
+    const uint16_t added = mask | static_cast<uint16_t>( 1u << ( channel - 1 ) );
+    return groupSize( added ) - groupSize( mask );
+}
+
+std::size_t CLORFrameEncoder::groupSize( uint16_t mask )
+{
+    const uint8_t maskLo = static_cast<uint8_t>( mask & 0xFF );
+    const uint8_t maskHi = static_cast<uint8_t>( mask >> 8 );
+
+    if ( 0 == mask )
+    {
+        return 0;
+    }
+    if ( !isSingleChannel( mask ) && 0 == maskHi )
+    {
+        return cMask8CommandSize;
+    }
+    if ( !isSingleChannel( mask ) && 0 != maskLo )
+    {
+        return cMask16CommandSize;
+    }
+
+    std::size_t channels = 0;
+    for ( ; 0 != mask; mask &= mask - 1 )
+    {
+        ++channels;
+    }
+    return channels * cChannelCommandSize;
+}
+
+void CLORFrameEncoder::encode( std::vector<uint8_t> &out )
+{
+    for ( const auto& group : m_groups )
+    {
+        const uint8_t unit = group.unit;
+        const uint8_t level = group.level;
+        const uint16_t mask = group.mask;
+        const uint8_t maskLo = static_cast<uint8_t>( mask & 0xFF );
+        const uint8_t maskHi = static_cast<uint8_t>( mask >> 8 );
+
+        const bool isSingle = isSingleChannel( mask );
+
+        if ( !isSingle && 0 == maskHi )
+        {
+            out.insert( out.end(), { 0x00, unit, cCommandIntensityMask8, level, maskLo, 0x00 } );
+        }
+        else if ( !isSingle && 0 != maskLo )
+        {
+            out.insert( out.end(), { 0x00, unit, cCommandIntensityMask16, level, maskLo, maskHi, 0x00 } );
+        }
+        else
+        {
+            for ( uint32_t channel = 1; channel <= cMaskChannels; ++channel )
+            {
+                if ( mask & ( 1u << ( channel - 1 ) ) )
+                {
+                    appendChannel( out, unit, channel, level );
+                }
+            }
+        }
+    }
+
+    for ( const auto& single : m_singles )
+    {
+        appendChannel( out, single.first.first, single.first.second, single.second );
+    }
+
+    m_groups.clear();
+    m_singles.clear();
+}
+
+std::size_t CLORFrameEncoder::findGroup( uint8_t unit, uint8_t level ) const
+{
+    // A frame has a few groups per unit, a scan beats a tree without allocating
+    auto it = std::find_if( m_groups.begin(), m_groups.end(), [unit, level]( const Group& group ){
+        return group.unit == unit && group.level == level;
+    });
+    return static_cast<std::size_t>( it - m_groups.begin() );
+}
+
+void CLORFrameEncoder::appendChannel( std::vector<uint8_t> &out, uint8_t unit, uint32_t channel, uint8_t level )
+{
+    uint8_t channelByte = 0x80 | (0x0F & (channel-1));
+    out.insert( out.end(), { 0x00, unit, cCommandIntensity, level, channelByte, 0x00 } );
+}
@@ -0,0 +1,58 @@
+#ifndef CLORFRAMEENCODER_H
+#define CLORFRAMEENCODER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/**
+ * Packs the level changes of one output frame into LOR commands.
+ *
+ * Channels of the same unit that go to the same level share one masked
+ * command (see doc/capturedCOM-data):
+ *
+ *    00 unit 03 level 80|(channel-1) 00     one channel
+ *    00 unit 33 level mask8 00              channels 1..8, bit n is channel n+1
+ *    00 unit 13 level maskLo maskHi 00      channels 1..16
+ *
+ * A mask byte of zero would read as the start of the next command, so a
+ * group with an empty mask byte falls back to single channel commands.
+ */
+class CLORFrameEncoder
+{
+public:
+
+   // channel is 1 based, as in the channel configuration
+   void add( uint8_t unit, uint32_t channel, uint8_t level );
+
+   // Bytes encode() would grow by if the channel was added
+   std::size_t addedSize( uint8_t unit, uint32_t channel, uint8_t level ) const;
+
+   // Appends the commands of everything added since the last encode
+   void encode( std::vector<uint8_t>& out );
+
+   static void appendChannel( std::vector<uint8_t>& out, uint8_t unit, uint32_t channel, uint8_t level );
+
+private:
+
+   static std::size_t groupSize( uint16_t mask );
+
+   struct Group
+   {
+      uint8_t unit;
+      uint8_t level;
+      uint16_t mask;       // channels 1..16
+   };
+
+   // Index in m_groups, size of it if there is none
+   std::size_t findGroup( uint8_t unit, uint8_t level ) const;
+
+   // Kept between frames, a frame reuses their storage
+   std::vector<Group> m_groups;
+
+   // Channels the masks can not address, sent one by one
+   std::vector< std::pair< std::pair< uint8_t, uint32_t >, uint8_t > > m_singles;
+};
+
+#endif // CLORFRAMEENCODER_H
@@ -1,246 +1,219 @@
 #include "clorserialctrl.h"
-#include <QByteArray>
 #include <QDebug>
 #include <memory>
-#include <algorithm>
+#include "ce131output.h"
 
-const uint8_t    cHearbeatData[] = { 0x00, 0xFF, 0x81, 0x56, 0x00 };
-constexpr auto   cChannelsPerUnit = 32;
+// A host that did not resolve is looked up again after
+constexpr int cHostLookupRetryMs = 5000;
 
 CLORSerialCtrl::CLORSerialCtrl( QObject *parent )
     : QObject( parent )
-    , m_serial( this )
-    , m_timer( new QTimer( this ) )
+    , m_publishTimer( new QTimer( this ) )
 {
-    connect( m_timer, &QTimer::timeout, this, &CLORSerialCtrl::writeHeartbeatData );
+    m_publishTimer->setSingleShot( true );
+    m_publishTimer->setInterval( cLiveFrameMs );
+    connect( m_publishTimer, &QTimer::timeout, this, &CLORSerialCtrl::publishSetup );
+
+    m_output.start( QThread::TimeCriticalPriority );
 }
 
 CLORSerialCtrl::~CLORSerialCtrl()
 {
-
+    m_output.stop();
 }
 
-bool CLORSerialCtrl::setPortParams(const QString &name, qint32 baudRate)
+void CLORSerialCtrl::setPorts( const std::vector<OutputPort> &ports )
 {
-    if ( isOpen() )
+    m_ports = ports;
+    for ( const auto& port : m_ports )
     {
-        if ( ( name == m_serial.portName() ) && ( m_serial.baudRate() == baudRate ) )
+        if (    EOutputType::E131 == port.type
+             && CE131Output::isHostName( port.name )
+             && 0 == m_hostAddresses.count( port.name ) )
         {
-            return true;
+            lookupHost( port.name );
         }
+    }
+    publishPorts();
+}
 
-        m_timer->stop();
-        m_serial.close();
+void CLORSerialCtrl::lookupHost( const QString &host )
+{
+    if ( m_pendingLookups.insert( host ).second )
+    {
+        QHostInfo::lookupHost( host, this, SLOT( hostLookedUp( QHostInfo ) ) );
     }
+}
 
-    m_serial.setPortName(name);
-    m_serial.setBaudRate( baudRate );
+void CLORSerialCtrl::hostLookedUp( const QHostInfo &info )
+{
+    const QString host = info.hostName();
+    m_pendingLookups.erase( host );
 
-    m_timer->start( 500 );
+    for ( const auto& address : info.addresses() )
+    {
+        if ( QAbstractSocket::IPv4Protocol == address.protocol() )
+        {
+            m_hostAddresses[ host ] = address.toString();
+            publishPorts();
+            return;
+        }
+    }
 
-    return m_serial.open( QIODevice::WriteOnly );
+    qDebug() << "Was not able to resolve E1.31 host" << host << info.errorString();
 
+    // Again as long as an output still names it
+    QTimer::singleShot( cHostLookupRetryMs, this, [ this, host ]()
+    {
+        for ( const auto& port : m_ports )
+        {
+            if ( EOutputType::E131 == port.type && port.name == host && 0 == m_hostAddresses.count( host ) )
+            {
+                lookupHost( host );
+                return;
+            }
+        }
+    } );
+}
+
+void CLORSerialCtrl::publishPorts()
+{
+    auto ports = m_ports;
+    for ( auto& port : ports )
+    {
+        auto it = m_hostAddresses.find( port.name );
+        if ( EOutputType::E131 == port.type && m_hostAddresses.end() != it )
+        {
+            port.address = it->second;
+        }
+    }
+    m_output.setPorts( ports );
+}
+
+void CLORSerialCtrl::setDeltaParams( uint32_t hysteresis, uint32_t refreshMs )
+{
+    m_output.setDeltaParams( hysteresis, refreshMs );
+}
+
+void CLORSerialCtrl::setLog( const QString &fileName )
+{
+    m_output.setLog( fileName );
 }
 
 bool CLORSerialCtrl::isOpen() const
 {
-    return m_serial.isOpen();
+    return m_output.isOpen();
 }
 
 void CLORSerialCtrl::playStarted( std::weak_ptr<CLightSequence> currentSequense )
 {
     m_sequenseConncetion.clear();
+    m_publishTimer->stop();
+
     auto sequense = currentSequense.lock();
-    if ( nullptr != sequense )
+    if ( sequense != m_currentSequense.lock() )
     {
-        auto deleter = [](QMetaObject::Connection* con){ disconnect(*con); delete con; };
-
-        auto playPositionChanging = [ this
-                , currentSequense
-                , currentIntensity = std::map< int /*unit*32+channel*/, float /*CurrentIntensity*/>()
-                , currentPosition = uint64_t(0) ]
-                (const SpectrumData& spectrum) mutable
-        {
-            auto sequense = currentSequense.lock();
-            if ( nullptr != sequense )
-            {
-                auto dt = spectrum.position - currentPosition;
+        m_effectCopies.clear();
+        m_changedEffects.clear();
+    }
+    m_currentSequense = currentSequense;
 
-                auto& channels = sequense->getGlobalConfiguration().channels();
-                for ( auto& channel : channels )
-                {
-                    auto localConfiguration = sequense->getConfiguration( channel.uuid );
-
-                    auto& effects = localConfiguration->effects;
-
-                    bool useEffectValue = false;
-                    double maxEffectValue = 0.0;
-
-                    for ( auto& effect : effects )
-                    {
-                       if ( effect.second )
-                       {
-                          if ( effect.second->isPositionActive( spectrum.position ) )
-                          {
-                             auto effectValue = effect.second->generate( spectrum );
-                             if ( effectValue > maxEffectValue )
-                             {
-                                maxEffectValue = effectValue;
-                             }
-                             useEffectValue = true;
-                          }
-                       }
-                    }
-
-
-                    auto spectrumIndex = channel.spectrumIndex;
-                    if ( localConfiguration->isSpectrumIndexSet() )
-                    {
-                        spectrumIndex = *(localConfiguration->spectrumIndex);
-                    }
-
-                    auto fade = channel.fade;
-                    if ( localConfiguration->isFadeSet() )
-                    {
-                        fade = *(localConfiguration->fade);
-                    }
-
-
-                    auto k = (-1.0 / (1000.0 * ( fade < 0.1 ? 0.1 : fade )));
-                    auto b = 1.0;
-                    double y = k * double(dt) + b;
-                    double intensityReduction = b - y;
-
-                    int channelIndex = channel.unit * cChannelsPerUnit + channel.channel;
-                    auto currentChannelIntensityIt = currentIntensity.find(channelIndex);
-                    if ( currentChannelIntensityIt == currentIntensity.end() )
-                    {
-                        currentChannelIntensityIt = currentIntensity.insert( {channelIndex, 0.0f } ).first;
-                    }
-                    else if ((*currentChannelIntensityIt).second > 0.0f)
-                    {
-                        (*currentChannelIntensityIt).second -= intensityReduction;
-                    }
-
-
-                    if ( !useEffectValue )
-                    {
-                       auto gain = channel.gain;
-                       if ( localConfiguration->isGainSet() )
-                       {
-                           gain = *(localConfiguration->gain);
-                       }
-
-                       auto value = spectrum.spectrum[ spectrumIndex ] * gain;
-
-
-                       if ( value > (*currentChannelIntensityIt).second )
-                       {
-                           if ( value > 1.0 )
-                           {
-                               (*currentChannelIntensityIt).second = 1.0;
-                           }
-                           else if ( value > localConfiguration->minimumLevel )
-                           {
-                               (*currentChannelIntensityIt).second = value;
-                           }
-                       }
-//                     if ( channel.unit == 2 && channel.channel == 8 )
-                       {
-                          qDebug() << "unit:" << channel.unit << "voltage:" << channel.voltage << "channel:" << channel.channel << "fade:" << fade << "gain:" << gain << "spectrumIndex:" << spectrumIndex << "Intensity:" << (*currentChannelIntensityIt).second;
-                       }
-                    }
-                    else
-                    {
-                       (*currentChannelIntensityIt).second = maxEffectValue;
-                    }
-
-                    //qDebug() << channel.label << "reduction:" << intensityReduction << "Intensity:" << currentSpectrum->spectrum[ spectrumIndex ];
-
-                    setIntensity( channel, (*currentChannelIntensityIt).second );
+    if ( nullptr == sequense )
+    {
+        m_output.publish( nullptr );
+        return;
+    }
 
-                }
+    publishSetup();
 
-                currentPosition = spectrum.position;
-            }
-        };
+    // The output thread samples the stream on its own clock, only edits
+    // of the sequense make a new setup
+    auto deleter = [](QMetaObject::Connection* con){ disconnect(*con); delete con; };
+    auto configurationChanged = [ this ]( std::weak_ptr<CLightSequence> )
+    {
+        m_publishTimer->start();
+    };
 
-        m_sequenseConncetion.push_back( { new QMetaObject::Connection( connect( sequense.get(), &CLightSequence::positionChanged, playPositionChanging )), deleter } );
+    auto effectChanged = [ this ]( std::weak_ptr<CLightSequence>, QUuid effectUuid )
+    {
+        m_changedEffects.insert( effectUuid );
+    };
 
-    }
+    m_sequenseConncetion.push_back( { new QMetaObject::Connection( connect( sequense.get(), &CLightSequence::configurationChanged, configurationChanged )), deleter } );
+    m_sequenseConncetion.push_back( { new QMetaObject::Connection( connect( sequense.get(), &CLightSequence::effectChanged, effectChanged )), deleter } );
 }
 
-void CLORSerialCtrl::writeHeartbeatData()
+void CLORSerialCtrl::publishSetup()
 {
-    if ( QSerialPort::NoError != m_serial.error() )
-    {
-        qDebug() << "Serial port error:" << m_serial.error() << m_serial.errorString();
-        if ( isOpen() )
-        {
-            m_serial.close();
-        }
-    }
-
-    if ( !isOpen() )
+    auto sequense = m_currentSequense.lock();
+    if ( nullptr != sequense )
     {
-        m_serial.open( QIODevice::WriteOnly );
+        m_output.publish( makeSetup( *sequense ) );
     }
+}
 
+std::shared_ptr<CLiveOutputThread::Setup> CLORSerialCtrl::makeSetup( const CLightSequence &sequense )
+{
+    auto setup = std::make_shared<CLiveOutputThread::Setup>();
 
-    if ( isOpen() )
+    const auto& audioFile = sequense.getAudioFile();
+    if ( nullptr != audioFile )
     {
-        m_serial.write( reinterpret_cast<const char*>(cHearbeatData), sizeof ( cHearbeatData ) );
+        setup->stream = audioFile->stream();
+        setup->sampleRate = audioFile->sampleRate();
     }
-}
+    setup->beats = sequense.getBeats();
+    setup->spectrum = sequense.getSpectrum();
 
-void CLORSerialCtrl::setIntensity( const Channel& channel, double intensity )
-{
-    if ( isOpen() )
-    {
-        uint8_t inten = 0xf0;
+    // Effects of removed channels or removed from the timeline drop their copies
+    std::map< QUuid, std::shared_ptr<IEffectGenerator> > effectCopies;
 
-        intensity *= double(channel.voltage) / 220.0;
-        intensity = 1.0 - intensity;
-        intensity *= 100.0;
+    const auto& channels = sequense.getGlobalConfiguration().channels();
+    setup->channels.reserve( channels.size() );
+    for ( const auto& channel : channels )
+    {
+        CLiveOutputThread::ChannelSetup channelSetup{ channel, cDefaultThreshholdValue, {} };
 
-        if ( intensity > 100.0 )
+        auto localConfiguration = sequense.getConfiguration( channel.uuid );
+        if ( nullptr != localConfiguration )
         {
-            intensity = 100.0;
-        }
-        else if ( intensity < 0.0 )
-        {
-            intensity = 0.0;
-        }
-
-        //qDebug() << "unit:" << channel.unit << "voltage:" << channel.voltage << "channel:" << channel.channel << "intensity:"<< intensity;
+            // Spectrum index chosen for this sequense wins over the channel frequency range
+            if ( localConfiguration->isSpectrumIndexSet() )
+            {
+                channelSetup.channel.spectrumIndex = *(localConfiguration->spectrumIndex);
+                channelSetup.channel.band = CBandLayout::Band();
+            }
 
-        if ( intensity > 99.0)
-        {
-            inten = 0xf0;
-        }
-        else if ( intensity < 1.0)
-        {
-            inten = 0x01;
-        }
-        else
-        {
-            intensity *= 2.0;
-            intensity += 30.0;
-            inten = static_cast< uint8_t >( intensity );
-        }
+            if ( localConfiguration->isGainSet() )
+            {
+                channelSetup.channel.gain = *(localConfiguration->gain);
+            }
 
+            if ( localConfiguration->isFadeSet() )
+            {
+                channelSetup.channel.fade = *(localConfiguration->fade);
+            }
 
-        uint8_t channelByte = 0x80 | (0x0F & (channel.channel-1));
-        auto unit = static_cast<uint8_t>(channel.unit);
+            channelSetup.minimumLevel = localConfiguration->minimumLevel;
 
-        uint8_t  intensityData[6];
-        intensityData[0] = 0x00;
-        intensityData[1] = unit;
-        intensityData[2] = 0x03;
-        intensityData[3] = inten;
-        intensityData[4] = channelByte;
-        intensityData[5] = 0x00;
+            for ( const auto& effect : localConfiguration->effects )
+            {
+                if ( effect.second )
+                {
+                    auto copyIt = m_effectCopies.find( effect.first );
+                    auto copy = m_effectCopies.end() != copyIt && 0 == m_changedEffects.count( effect.first )
+                                ? copyIt->second
+                                : effect.second->getCopy();
+                    effectCopies[ effect.first ] = copy;
+                    channelSetup.effects.push_back( { effect.first, copy, effect.second->renderCache().snapshot() } );
+                }
+            }
+        }
 
-        m_serial.write( reinterpret_cast<const char*>(intensityData), sizeof ( intensityData ) );
+        setup->channels.push_back( std::move( channelSetup ) );
     }
+
+    m_effectCopies = std::move( effectCopies );
+    m_changedEffects.clear();
+    return setup;
 }
@@ -1,11 +1,27 @@
 #ifndef CLORSERIALCTRL_H
 #define CLORSERIALCTRL_H
 
+#include <QHostInfo>
 #include <QObject>
-#include <QtSerialPort/QSerialPort>
-#include "clightsequence.h"
 #include <QTimer>
+#include <set>
+#include "clightsequence.h"
+#include "cliveoutputthread.h"
 
+/**
+ * GUI side of the live LOR output. Frames are rendered and written by
+ * CLiveOutputThread, this object follows the playing sequense and hands
+ * the thread a new setup whenever its configuration changes. Changes come
+ * from CLightSequence::configurationChanged(), a burst of them, as a slider
+ * drag, makes one setup.
+ *
+ * Host names of E1.31 outputs are looked up here without blocking, the
+ * output thread gets the ports again with the address once it is known.
+ *
+ * Effect copies are kept from setup to setup and only made again for the
+ * effects CLightSequence::effectChanged() names, so the effect indexes of
+ * the output thread only take in what was edited.
+ */
 class CLORSerialCtrl : public QObject
 {
     Q_OBJECT
@@ -13,26 +29,51 @@ public:
     explicit CLORSerialCtrl( QObject* parent = nullptr );
     ~CLORSerialCtrl();
 
-    bool setPortParams( const QString& name, qint32 baudRate );
+    // Main port first, see CLiveOutputThread::setPorts
+    void setPorts( const std::vector<OutputPort>& ports );
+
+    // Change suppression of the live output, see CLiveOutputThread
+    void setDeltaParams( uint32_t hysteresis, uint32_t refreshMs );
+
+    // Records the written bytes into a COutputLog, an empty name stops
+    void setLog( const QString& fileName );
 
     bool isOpen() const;
 
 public slots:
     void playStarted( std::weak_ptr<CLightSequence> currentSequense );
 
+private slots:
+    void hostLookedUp( const QHostInfo& info );
+
 private:
 
-    void writeHeartbeatData();
-    void setIntensity( const Channel& channel, double intensity );
+    void lookupHost( const QString& host );
+
+    // Ports with the resolved addresses to the output thread
+    void publishPorts();
+
+    // Publishes a setup of the current sequense
+    void publishSetup();
+
+    std::shared_ptr<CLiveOutputThread::Setup> makeSetup( const CLightSequence& sequense );
 
 private:
 
-    QSerialPort m_serial;
+    CLiveOutputThread m_output;
+
+    std::vector<OutputPort> m_ports;
+    std::map< QString, QString > m_hostAddresses;
+    std::set< QString > m_pendingLookups;
 
     std::list<std::shared_ptr<QMetaObject::Connection>> m_sequenseConncetion;
 
-    QTimer* m_timer;
+    std::weak_ptr<CLightSequence> m_currentSequense;
+    QTimer* m_publishTimer;
 
+    // Copies handed to the output thread by sequense effect uuid
+    std::map< QUuid, std::shared_ptr<IEffectGenerator> > m_effectCopies;
+    std::set< QUuid > m_changedEffects;
 
 };
 
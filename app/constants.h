@@ -1,6 +1,8 @@
 #ifndef CONSTANTS_H
 #define CONSTANTS_H
 
+#include <cstdint>
+
 constexpr double cMaxGainValue = 40.0;
 constexpr double cMinGainValue = 0.0;
 constexpr double cDefaultGainValue = 2.0;
@@ -13,8 +15,29 @@ constexpr double cDefaultThreshholdValue = 0.1;
 constexpr double cMinIntensity = 0.0;
 constexpr double cMaxIntensity = 1.0;
 
+// Bins of BASS_DATA_FFT256 used by live playback, same as of cDefaultFFTSize
 constexpr int cFFTSize = 128;
 constexpr int cMaxFrequensy = 22050;
+constexpr uint32_t cDefaultSampleRate = 2 * cMaxFrequensy;
 constexpr int cDefaultSpectrumIndex = 2;
 
+constexpr uint32_t cDefaultAnalysisHopMs = 30;
+constexpr uint32_t cAnalysisHopMsOptions[] = { 10, 25, 30, 50 };
+
+constexpr uint32_t cMinFFTSize = 256;
+constexpr uint32_t cMaxFFTSize = 8192;
+constexpr uint32_t cDefaultFFTSize = 256;
+constexpr uint32_t cFFTSizeOptions[] = { 256, 512, 1024, 2048, 4096, 8192 };
+
+// Live output renders a frame every cLiveFrameMs from its own clock
+constexpr uint32_t cLiveFrameMs = 30;
+constexpr uint32_t cHeartbeatMs = 500;
+
+// A channel goes out only when its LOR level byte moved by more than the
+// hysteresis, and at least once per refresh period in any case
+constexpr uint32_t cDefaultOutputHysteresis = 2;
+constexpr uint32_t cOutputHysteresisOptions[] = { 0, 1, 2, 4, 8 };
+constexpr uint32_t cDefaultOutputRefreshMs = 1000;
+constexpr uint32_t cOutputRefreshMsOptions[] = { 250, 500, 1000, 2000, 5000 };
+
 #endif // CONSTANTS_H
@@ -0,0 +1,252 @@
+#include "coutputbenchmark.h"
+#include <QDebug>
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <thread>
+#include "cintensityencoder.h"
+#include "cliveoutputthread.h"
+#include "cvirtuallorcontroller.h"
+
+using Clock = CLiveOutputThread::Clock;
+
+// Time for the port to open, and for it and the line to empty after the last frame
+constexpr uint32_t cDrainMs = 1000;
+
+namespace
+{
+
+struct Change
+{
+    uint64_t timeNs;
+    uint8_t level;
+    bool isDelivered;
+};
+
+uint64_t toNs( Clock::time_point time )
+{
+    return static_cast<uint64_t>( std::chrono::duration_cast<std::chrono::nanoseconds>( time.time_since_epoch() ).count() );
+}
+
+double percentile( const std::vector<double>& sorted, double fraction )
+{
+    if ( sorted.empty() )
+    {
+        return 0.0;
+    }
+    return sorted[ std::min( sorted.size() - 1, static_cast<std::size_t>( fraction * double( sorted.size() ) ) ) ];
+}
+
+}
+
+bool COutputBenchmark::run( const CSequenseGenerator::Snapshot& snapshot,
+                            const Parameters& parameters,
+                            Report& report )
+{
+    report = Report();
+    if ( snapshot.channels.empty() )
+    {
+        qWarning() << "Nothing to play";
+        return false;
+    }
+
+    CVirtualLorController controller;
+    if ( !controller.open( parameters.baudRate ) )
+    {
+        return false;
+    }
+
+    // Played on the "no sound" device, the position still runs in real time
+    const HSTREAM stream = BASS_StreamCreateFile( FALSE, snapshot.fileName.c_str(), 0, 0, 0 );
+    if ( 0 == stream )
+    {
+        qWarning() << "Was not able to open" << snapshot.fileName.c_str() << "error:" << BASS_ErrorGetCode();
+        return false;
+    }
+    BASS_CHANNELINFO info;
+    BASS_ChannelGetInfo( stream, &info );
+
+    const auto& channels = snapshot.channels;
+    auto setup = std::make_shared<CLiveOutputThread::Setup>();
+    setup->stream = stream;
+    setup->sampleRate = info.freq;
+
+    std::vector<CIntensityEncoder> encoders;
+    std::map< int /*unit*32+channel*/, std::size_t > channelIndex;
+    for ( const auto& params : channels )
+    {
+        const Channel& channel = params.channel;
+        setup->channels.push_back( CLiveOutputThread::ChannelSetup{ channel, params.minimumLevel, {} } );
+        encoders.push_back( CIntensityEncoder::get( CIntensityEncoder::EFormat::LOR, channel.voltage, channel.curve ) );
+        channelIndex.insert( { int( channel.unit * 32 + channel.channel ), encoders.size() - 1 } );
+    }
+
+    // Level changes of the rendered frames, written on the output thread
+    // until it is stopped
+    std::vector<int> wanted( channels.size(), -1 );
+    std::vector< std::vector<Change> > changes( channels.size() );
+
+    CLiveOutputThread output;
+    output.setFrameObserver( [ & ]( Clock::time_point now, const std::vector<int>& keys, const std::vector<double>& intensities )
+    {
+        for ( std::size_t k = 0; k < keys.size(); ++k )
+        {
+            const auto it = channelIndex.find( keys[ k ] );
+            if ( channelIndex.end() == it )
+            {
+                continue;
+            }
+
+            const std::size_t i = it->second;
+            const uint8_t level = encoders[ i ].encode( intensities[ k ] );
+            if ( level != wanted[ i ] )
+            {
+                wanted[ i ] = level;
+                changes[ i ].push_back( Change{ toNs( now ), level, false } );
+            }
+        }
+    } );
+
+    OutputPort portParams;
+    portParams.name = controller.portName();
+    portParams.baudRate = parameters.baudRate;
+    output.setPorts( { portParams } );
+    output.setDeltaParams( parameters.hysteresis, parameters.refreshMs );
+    output.start( QThread::TimeCriticalPriority );
+
+    const auto frame = std::chrono::milliseconds( cLiveFrameMs );
+    const auto openEnd = Clock::now() + std::chrono::milliseconds( cDrainMs );
+    while ( !output.isOpen() && Clock::now() < openEnd )
+    {
+        std::this_thread::sleep_for( frame );
+    }
+    if ( !output.isOpen() )
+    {
+        qWarning() << "Was not able to open the virtual controller" << controller.portName();
+        output.stop();
+        BASS_StreamFree( stream );
+        return false;
+    }
+
+    output.publish( setup );
+    const auto start = Clock::now();
+    BASS_ChannelPlay( stream, FALSE );
+
+    const auto playEnd = start + std::chrono::seconds( parameters.seconds );
+    while (    BASS_ACTIVE_PLAYING == BASS_ChannelIsActive( stream )
+            && ( 0 == parameters.seconds || Clock::now() < playEnd ) )
+    {
+        std::this_thread::sleep_for( frame );
+    }
+
+    // The thread keeps the port going without frames until the line is empty
+    BASS_ChannelStop( stream );
+    std::this_thread::sleep_for( std::chrono::milliseconds( cDrainMs ) );
+    output.stop();
+    BASS_StreamFree( stream );
+
+    report.seconds = std::chrono::duration<double>( Clock::now() - start ).count();
+    controller.close();
+
+    // Replays the commands on a model of the controller, a command that does
+    // not change its level is a refresh
+    std::vector<int> controllerLevel( channels.size(), -1 );
+    std::vector<std::size_t> nextChange( channels.size(), 0 );
+    std::vector<double> latencies;
+
+    for ( const auto& command : controller.takeCommands() )
+    {
+        if ( CVirtualLorController::ECommand::Heartbeat == command.type )
+        {
+            ++report.heartbeats;
+            continue;
+        }
+        if ( CVirtualLorController::ECommand::Intensity != command.type )
+        {
+            continue;
+        }
+
+        ++report.commands;
+        for ( uint32_t bit = 0; bit < 16; ++bit )
+        {
+            if ( 0 == ( command.channels & ( 1u << bit ) ) )
+            {
+                continue;
+            }
+
+            const auto it = channelIndex.find( int( command.unit * 32 + bit + 1 ) );
+            if ( channelIndex.end() == it )
+            {
+                continue;
+            }
+
+            const std::size_t i = it->second;
+            if ( controllerLevel[ i ] == command.level )
+            {
+                continue;
+            }
+            controllerLevel[ i ] = command.level;
+
+            // Latest wanted change with this level before the command, the older ones were superseded
+            auto& channelChanges = changes[ i ];
+            std::size_t found = channelChanges.size();
+            for ( std::size_t c = nextChange[ i ]; c < channelChanges.size() && channelChanges[ c ].timeNs <= command.timeNs; ++c )
+            {
+                if ( channelChanges[ c ].level == command.level )
+                {
+                    found = c;
+                }
+            }
+
+            if ( found < channelChanges.size() )
+            {
+                channelChanges[ found ].isDelivered = true;
+                nextChange[ i ] = found + 1;
+                latencies.push_back( double( command.timeNs - channelChanges[ found ].timeNs ) / 1e6 );
+            }
+        }
+    }
+
+    report.bytes = controller.bytes();
+    report.unknownBytes = controller.unknownBytes();
+    report.deferred = output.statistics().deferred;
+
+    for ( std::size_t i = 0; i < channels.size(); ++i )
+    {
+        ChannelReport channelReport;
+        channelReport.label = channels[ i ].channel.label;
+        channelReport.unit = channels[ i ].channel.unit;
+        channelReport.channel = channels[ i ].channel.channel;
+        channelReport.changes = changes[ i ].size();
+        channelReport.delivered = std::count_if( changes[ i ].begin(), changes[ i ].end(),
+                                                 []( const Change& change ){ return change.isDelivered; } );
+        channelReport.dropped = channelReport.changes - channelReport.delivered;
+        report.channels.push_back( channelReport );
+    }
+
+    report.samples = latencies.size();
+    if ( !latencies.empty() )
+    {
+        std::sort( latencies.begin(), latencies.end() );
+
+        double sum = 0.0;
+        for ( auto latency : latencies )
+        {
+            sum += latency;
+        }
+        report.meanMs = sum / double( latencies.size() );
+
+        double squares = 0.0;
+        for ( auto latency : latencies )
+        {
+            squares += ( latency - report.meanMs ) * ( latency - report.meanMs );
+        }
+        report.jitterMs = std::sqrt( squares / double( latencies.size() ) );
+
+        report.p50Ms = percentile( latencies, 0.5 );
+        report.p95Ms = percentile( latencies, 0.95 );
+        report.maxMs = latencies.back();
+    }
+
+    return true;
+}
@@ -0,0 +1,69 @@
+#ifndef COUTPUTBENCHMARK_H
+#define COUTPUTBENCHMARK_H
+
+#include <QString>
+#include <cstdint>
+#include <vector>
+#include "csequensegenerator.h"
+
+/**
+ * End-to-end measurement of the live output on a CVirtualLorController.
+ *
+ * The track is played in real time on the "no sound" device of BASS and a
+ * CLiveOutputThread renders it to the virtual controller, the channels
+ * without effects as the sequense configures them. Each change of a
+ * channel level in a rendered frame is compared with the command that
+ * carried it to the controller. Commands that repeat the level the controller
+ * already has are refreshes and are not counted as deliveries.
+ */
+class COutputBenchmark
+{
+   COutputBenchmark() = default;
+public:
+
+   struct Parameters
+   {
+      uint32_t baudRate = 115200;        // 0 is a line without limit
+      uint32_t seconds = 30;             // of the track, 0 plays all of it
+      uint32_t hysteresis = cDefaultOutputHysteresis;
+      uint32_t refreshMs = cDefaultOutputRefreshMs;
+   };
+
+   struct ChannelReport
+   {
+      QString label;
+      uint32_t unit = 0;
+      uint32_t channel = 0;
+      uint64_t changes = 0;              // level changes wanted by the render
+      uint64_t delivered = 0;            // of them, seen by the controller
+      uint64_t dropped = 0;              // superseded or never sent
+   };
+
+   struct Report
+   {
+      double seconds = 0.0;
+      uint64_t bytes = 0;
+      uint64_t commands = 0;
+      uint64_t heartbeats = 0;
+      uint64_t unknownBytes = 0;
+      uint64_t deferred = 0;             // reported by the output thread
+
+      // Latency of delivered changes, milliseconds
+      uint64_t samples = 0;
+      double meanMs = 0.0;
+      double p50Ms = 0.0;
+      double p95Ms = 0.0;
+      double maxMs = 0.0;
+      double jitterMs = 0.0;             // standard deviation
+
+      std::vector<ChannelReport> channels;
+   };
+
+   // BASS has to be initialized
+   static bool run( const CSequenseGenerator::Snapshot& snapshot,
+                    const Parameters& parameters,
+                    Report& report );
+
+};
+
+#endif // COUTPUTBENCHMARK_H
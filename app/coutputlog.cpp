@@ -0,0 +1,336 @@
+#include "coutputlog.h"
+#include <QDebug>
+#include <QHostInfo>
+#include <QUdpSocket>
+#include <QtSerialPort/QSerialPort>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <thread>
+#include "ce131output.h"
+
+constexpr char     cOutputLogMagic[8] = { 'R', 'L', 'G', 'O', 'U', 'T', 'P', 'T' };
+constexpr uint32_t cOutputLogVersion = 2;
+constexpr uint32_t cSerialOnlyVersion = 1;
+constexpr uint8_t  cTagPort = 1;
+constexpr uint8_t  cTagWrite = 2;
+constexpr int      cDrainTimeoutMs = 5000;
+
+COutputLog::~COutputLog()
+{
+    close();
+}
+
+bool COutputLog::open( const QString &fileName )
+{
+    close();
+
+    m_file.setFileName( fileName );
+    if ( !m_file.open( QIODevice::WriteOnly ) )
+    {
+        qWarning() << "Couldn't write output log:" << fileName << m_file.errorString();
+        return false;
+    }
+
+    m_hasWrite = false;
+    return write( cOutputLogMagic, sizeof( cOutputLogMagic ) )
+        && write( &cOutputLogVersion, sizeof( cOutputLogVersion ) );
+}
+
+void COutputLog::close()
+{
+    if ( m_file.isOpen() )
+    {
+        m_file.close();
+    }
+}
+
+void COutputLog::addPort( uint8_t index, const OutputPort &port )
+{
+    const QByteArray name = port.name.toUtf8();
+    const uint16_t nameSize = static_cast<uint16_t>( std::min<int>( name.size(), std::numeric_limits<uint16_t>::max() ) );
+    const QByteArray address = port.address.toUtf8();
+    const uint16_t addressSize = static_cast<uint16_t>( std::min<int>( address.size(), std::numeric_limits<uint16_t>::max() ) );
+    const uint8_t type = static_cast<uint8_t>( port.type );
+
+    write( &cTagPort, sizeof( cTagPort ) )
+        && write( &index, sizeof( index ) )
+        && write( &type, sizeof( type ) )
+        && write( &port.baudRate, sizeof( port.baudRate ) )
+        && write( &nameSize, sizeof( nameSize ) )
+        && write( name.constData(), nameSize )
+        && write( &addressSize, sizeof( addressSize ) )
+        && write( address.constData(), addressSize );
+}
+
+void COutputLog::append( uint8_t port, Clock::time_point time, const uint8_t *data, std::size_t size )
+{
+    if ( !m_file.isOpen() || 0 == size )
+    {
+        return;
+    }
+
+    uint64_t deltaUs = 0;
+    if ( m_hasWrite && time > m_lastWrite )
+    {
+        deltaUs = static_cast<uint64_t>( std::chrono::duration_cast<std::chrono::microseconds>( time - m_lastWrite ).count() );
+    }
+    m_hasWrite = true;
+    m_lastWrite = time;
+
+    uint32_t delta = static_cast<uint32_t>( std::min<uint64_t>( deltaUs, std::numeric_limits<uint32_t>::max() ) );
+
+    // A frame is far below the limit, split anyway rather than corrupt the log
+    while ( size > 0 )
+    {
+        const uint16_t chunk = static_cast<uint16_t>( std::min<std::size_t>( size, std::numeric_limits<uint16_t>::max() ) );
+        if ( !( write( &cTagWrite, sizeof( cTagWrite ) )
+                && write( &port, sizeof( port ) )
+                && write( &delta, sizeof( delta ) )
+                && write( &chunk, sizeof( chunk ) )
+                && write( data, chunk ) ) )
+        {
+            return;
+        }
+        data += chunk;
+        size -= chunk;
+        delta = 0;
+    }
+}
+
+bool COutputLog::write( const void *data, std::size_t size )
+{
+    if ( !m_file.isOpen() )
+    {
+        return false;
+    }
+
+    if ( static_cast<qint64>( size ) != m_file.write( static_cast<const char*>( data ), static_cast<qint64>( size ) ) )
+    {
+        qWarning() << "Couldn't write output log, recording stopped:" << m_file.fileName() << m_file.errorString();
+        m_file.close();
+        return false;
+    }
+    return true;
+}
+
+bool COutputLog::load( const QString &fileName, Recording &recording )
+{
+    QFile file( fileName );
+    if ( !file.open( QIODevice::ReadOnly ) )
+    {
+        qWarning() << "Couldn't open output log:" << fileName << file.errorString();
+        return false;
+    }
+
+    const QByteArray content = file.readAll();
+    const char* data = content.constData();
+    const std::size_t size = static_cast<std::size_t>( content.size() );
+    std::size_t offset = 0;
+
+    auto read = [&]( void* value, std::size_t valueSize ){
+        if ( size - offset < valueSize )
+        {
+            return false;
+        }
+        std::memcpy( value, data + offset, valueSize );
+        offset += valueSize;
+        return true;
+    };
+
+    auto readString = [&]( QString& value ){
+        uint16_t stringSize = 0;
+        if ( !read( &stringSize, sizeof( stringSize ) ) || size - offset < stringSize )
+        {
+            return false;
+        }
+        value = QString::fromUtf8( data + offset, stringSize );
+        offset += stringSize;
+        return true;
+    };
+
+    char magic[ sizeof( cOutputLogMagic ) ];
+    uint32_t version = 0;
+    if ( !read( magic, sizeof( magic ) )
+         || 0 != std::memcmp( magic, cOutputLogMagic, sizeof( magic ) )
+         || !read( &version, sizeof( version ) )
+         || ( cOutputLogVersion != version && cSerialOnlyVersion != version ) )
+    {
+        qWarning() << "Not an output log:" << fileName;
+        return false;
+    }
+
+    recording = Recording();
+
+    // Index in the log to the definition it refers to now
+    std::vector<uint32_t> definitions( std::numeric_limits<uint8_t>::max() + 1, std::numeric_limits<uint32_t>::max() );
+    uint64_t timeUs = 0;
+
+    // A log cut short by a crash keeps its complete entries
+    uint8_t tag = 0;
+    while ( read( &tag, sizeof( tag ) ) )
+    {
+        if ( cTagPort == tag )
+        {
+            const bool hasType = cSerialOnlyVersion != version;
+            uint8_t index = 0;
+            uint8_t type = static_cast<uint8_t>( EOutputType::LOR );
+            OutputPort port;
+            if ( !read( &index, sizeof( index ) )
+                 || ( hasType && !read( &type, sizeof( type ) ) )
+                 || !read( &port.baudRate, sizeof( port.baudRate ) )
+                 || !readString( port.name )
+                 || ( hasType && !readString( port.address ) ) )
+            {
+                qWarning() << "Output log is truncated:" << fileName;
+                break;
+            }
+
+            if ( static_cast<uint8_t>( EOutputType::E131 ) == type )
+            {
+                port.type = EOutputType::E131;
+            }
+            else if ( static_cast<uint8_t>( EOutputType::LOR ) != type )
+            {
+                qWarning() << "Output log has a port of an unknown type:" << fileName;
+                return false;
+            }
+
+            definitions[ index ] = static_cast<uint32_t>( recording.ports.size() );
+            recording.ports.push_back( port );
+        }
+        else if ( cTagWrite == tag )
+        {
+            uint8_t index = 0;
+            uint32_t deltaUs = 0;
+            uint16_t writeSize = 0;
+            if ( !read( &index, sizeof( index ) )
+                 || !read( &deltaUs, sizeof( deltaUs ) )
+                 || !read( &writeSize, sizeof( writeSize ) )
+                 || size - offset < writeSize )
+            {
+                qWarning() << "Output log is truncated:" << fileName;
+                break;
+            }
+
+            if ( std::numeric_limits<uint32_t>::max() == definitions[ index ] )
+            {
+                qWarning() << "Output log writes to an undefined port:" << fileName;
+                return false;
+            }
+
+            timeUs += deltaUs;
+            recording.writes.push_back( Write{ timeUs, definitions[ index ], static_cast<uint32_t>( recording.bytes.size() ), writeSize } );
+            recording.bytes.insert( recording.bytes.end(), data + offset, data + offset + writeSize );
+            offset += writeSize;
+        }
+        else
+        {
+            qWarning() << "Output log is corrupted:" << fileName;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Resolves the host of an E1.31 output, the replay is not time critical before its first write
+static bool resolveHost( OutputPort& port )
+{
+    if ( !port.address.isEmpty() || !CE131Output::isHostName( port.name ) )
+    {
+        return true;
+    }
+
+    const QHostInfo info = QHostInfo::fromName( port.name );
+    for ( const auto& address : info.addresses() )
+    {
+        if ( QAbstractSocket::IPv4Protocol == address.protocol() )
+        {
+            port.address = address.toString();
+            return true;
+        }
+    }
+
+    qWarning() << "Was not able to resolve E1.31 host" << port.name << info.errorString();
+    return false;
+}
+
+bool COutputLog::replay( const Recording &recording, const std::atomic_bool *isCanceled )
+{
+    // Opened when first written, a port that fails to open is skipped
+    std::vector< std::unique_ptr<QSerialPort> > ports( recording.ports.size() );
+    std::vector<bool> isFailed( recording.ports.size(), false );
+
+    // E1.31 outputs share one socket, their hosts are resolved when first written
+    QUdpSocket socket;
+    std::vector<OutputPort> hosts( recording.ports );
+    std::vector<bool> isResolved( recording.ports.size(), false );
+
+    const auto start = Clock::now();
+    for ( const auto& write : recording.writes )
+    {
+        if ( nullptr != isCanceled && isCanceled->load() )
+        {
+            return false;
+        }
+
+        std::this_thread::sleep_until( start + std::chrono::microseconds( write.timeUs ) );
+
+        const uint8_t* bytes = recording.bytes.data() + write.offset;
+        if ( EOutputType::E131 == recording.ports[ write.port ].type )
+        {
+            if ( !isResolved[ write.port ] && !isFailed[ write.port ] )
+            {
+                isResolved[ write.port ] = resolveHost( hosts[ write.port ] );
+                isFailed[ write.port ] = !isResolved[ write.port ];
+            }
+
+            if ( isResolved[ write.port ] )
+            {
+                socket.writeDatagram( reinterpret_cast<const char*>( bytes ), write.size,
+                                      CE131Output::destination( hosts[ write.port ], bytes, write.size ), CE131Output::cPort );
+            }
+            continue;
+        }
+
+        auto& port = ports[ write.port ];
+        if ( nullptr == port && !isFailed[ write.port ] )
+        {
+            const OutputPort& params = recording.ports[ write.port ];
+            port.reset( new QSerialPort() );
+            port->setPortName( params.name );
+            port->setBaudRate( static_cast<qint32>( params.baudRate ) );
+            if ( !port->open( QIODevice::WriteOnly ) )
+            {
+                qWarning() << "Was not able to open" << params.name << port->errorString();
+                port.reset();
+                isFailed[ write.port ] = true;
+            }
+        }
+
+        if ( nullptr != port )
+        {
+            port->write( reinterpret_cast<const char*>( bytes ), write.size );
+        }
+
+        // Completes pending writes, there is no event loop to do it
+        for ( auto& openPort : ports )
+        {
+            if ( nullptr != openPort && openPort->bytesToWrite() > 0 )
+            {
+                openPort->waitForBytesWritten( 0 );
+            }
+        }
+    }
+
+    for ( auto& port : ports )
+    {
+        while ( nullptr != port && port->bytesToWrite() > 0 && port->waitForBytesWritten( cDrainTimeoutMs ) )
+        {
+        }
+    }
+
+    return std::find( isFailed.begin(), isFailed.end(), true ) == isFailed.end();
+}
@@ -0,0 +1,84 @@
+#ifndef COUTPUTLOG_H
+#define COUTPUTLOG_H
+
+#include <QFile>
+#include <QString>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+#include "CConfiguration.h"
+
+/**
+ * Timestamped log of the bytes the live output writes to its serial ports,
+ * heartbeats included, and of the datagrams of its E1.31 outputs, and its
+ * replay.
+ *
+ * The writer belongs to the output thread: every write of a port is one
+ * entry with the microseconds since the previous write. QFile buffers the
+ * entries, a frame costs a copy and no system call. Ports are defined in
+ * the log when recording starts and again whenever the ports change.
+ *
+ * A replay opens the recorded ports and writes the same bytes with the
+ * original timing, no audio is analysed and no effect evaluated. A write of
+ * an E1.31 output is one datagram, sent over UDP to where the output sent
+ * it.
+ *
+ * Layout, native endian:
+ *   char     magic[8], uint32_t version
+ *   entries, each starting with a uint8_t tag:
+ *     port:  uint8_t index, uint8_t type, uint32_t baudRate,
+ *            uint16_t nameSize, name UTF-8, uint16_t addressSize, address UTF-8
+ *     write: uint8_t port, uint32_t deltaUs, uint16_t size, bytes
+ * Version 1 logs have serial ports only, a port without type and address.
+ */
+class COutputLog
+{
+public:
+
+   using Clock = std::chrono::steady_clock;
+
+   struct Write
+   {
+      uint64_t timeUs;      // since the first write
+      uint32_t port;        // index in Recording::ports
+      uint32_t offset;      // in Recording::bytes
+      uint16_t size;
+   };
+
+   struct Recording
+   {
+      std::vector<OutputPort> ports;     // every definition of the log, units are not recorded
+      std::vector<Write> writes;
+      std::vector<uint8_t> bytes;
+   };
+
+   ~COutputLog();
+
+   bool open( const QString& fileName );
+   void close();
+   bool isOpen() const { return m_file.isOpen(); }
+   QString fileName() const { return m_file.fileName(); }
+
+   // Writes of index go to this port from now on
+   void addPort( uint8_t index, const OutputPort& port );
+
+   void append( uint8_t port, Clock::time_point time, const uint8_t* data, std::size_t size );
+
+   static bool load( const QString& fileName, Recording& recording );
+
+   // Blocks until the last write left the ports, the ports are opened on the calling thread
+   static bool replay( const Recording& recording, const std::atomic_bool* isCanceled = nullptr );
+
+private:
+
+   bool write( const void* data, std::size_t size );
+
+private:
+
+   QFile m_file;
+   bool m_hasWrite = false;
+   Clock::time_point m_lastWrite;
+};
+
+#endif // COUTPUTLOG_H
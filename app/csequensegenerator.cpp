@@ -1,9 +1,17 @@
 #include "csequensegenerator.h"
-#include "clightsequence.h"
+#include "cspectrumanalyzer.h"
+#include "cspectrumcache.h"
+#include "cbandlayout.h"
+#include "cbeatdetector.h"
+#include "constants.h"
 #include <pugixml-1.10/src/pugixml.hpp>
 #include <QFileInfo>
+#include <QJsonArray>
+#include <map>
 #include <QColor>
 #include <QDateTime>
+#include <QTemporaryFile>
+#include <QDebug>
 
 template< typename TIntegral >
 inline TIntegral  milisecondToCentisecond(TIntegral miliseconds )
@@ -11,18 +19,17 @@ inline TIntegral  milisecondToCentisecond(TIntegral miliseconds )
     return miliseconds / 10;
 }
 
-uint64_t totalCentseconds( const CLightSequence *sequense )
+using Snapshot = CSequenseGenerator::Snapshot;
+
+// Frames per block of the channel intensity spill file
+constexpr std::size_t cSpillBlockFrames = 4096;
+
+// What the document needs from the whole track, known once the last frame is rendered
+struct TrackSummary
 {
-    if ( nullptr != sequense )
-    {
-        auto& spData = sequense->getAudioFile()->getSpectrum();
-        if ( !spData.empty() )
-        {
-            return milisecondToCentisecond( spData.back()->position ); // + uint64_t( max * 100.0 );
-        }
-    }
-    return 0;
-}
+    uint64_t centiseconds = 0;
+    BeatTrack beats;
+};
 
 template <typename Base, typename Derived>
 struct is_base {
@@ -108,29 +115,25 @@ class CTrackChannels : public CGeneratorNodeBase
 {
 public:
 
-    CTrackChannels( pugi::xml_node&& node, const CLightSequence *asequense )
+    CTrackChannels( pugi::xml_node&& node, const Snapshot& asnapshot )
         : CGeneratorNodeBase( std::move(node) )
-        , sequense( asequense )
+        , snapshot( asnapshot )
     { }
 
 protected:
 
     virtual void render() override
     {
-        if ( nullptr != sequense)
+        for ( uint32_t i = 0; i < snapshot.channels.size(); ++i )
         {
-            const auto& channels = sequense->getGlobalConfiguration().channels();
-            for ( uint32_t i = 0; i < channels.size(); ++i )
-            {
-                appendChild<CTrackChannel>( i );
-            }
+            appendChild<CTrackChannel>( i );
         }
     }
 
     virtual const char* getName( ) override
     { return "channels"; }
 
-    const CLightSequence *sequense;
+    const Snapshot& snapshot;
 
 };
 
@@ -140,21 +143,22 @@ class CTrack : public CGeneratorNodeBase
 {
 public:
 
-    CTrack( pugi::xml_node&& node, const CLightSequence *asequense )
+    CTrack( pugi::xml_node&& node, const Snapshot& asnapshot, const TrackSummary& asummary )
         : CGeneratorNodeBase( std::move(node) )
-        , sequense( asequense )
+        , snapshot( asnapshot )
+        , summary( asummary )
     { }
 
 protected:
 
     virtual void render() override
     {
-        auto centiSeconds = totalCentseconds( sequense );
+        auto centiSeconds = summary.centiseconds;
         if ( centiSeconds > 0 )
         {
             append_attribute( "totalCentiseconds" ) = centiSeconds;
             append_attribute( "timingGrid" ) = 0;
-            appendChild<CTrackChannels>( sequense );
+            appendChild<CTrackChannels>( snapshot );
             appendChild<CLoopLevels>(  );
         }
     }
@@ -163,7 +167,8 @@ protected:
     { return "track"; }
 
 private:
-    const CLightSequence *sequense;
+    const Snapshot& snapshot;
+    const TrackSummary& summary;
 };
 
 
@@ -172,23 +177,25 @@ class CTracks : public CGeneratorNodeBase
 {
 public:
 
-    CTracks( pugi::xml_node&& node, const CLightSequence *asequense )
+    CTracks( pugi::xml_node&& node, const Snapshot& asnapshot, const TrackSummary& asummary )
         : CGeneratorNodeBase( std::move(node) )
-        , sequense( asequense )
+        , snapshot( asnapshot )
+        , summary( asummary )
     { }
 
 protected:
 
     virtual void render() override
     {
-        appendChild<CTrack>( sequense );
+        appendChild<CTrack>( snapshot, summary );
     }
 
     virtual const char* getName( ) override
     { return "tracks"; }
 
 private:
-    const CLightSequence *sequense;
+    const Snapshot& snapshot;
+    const TrackSummary& summary;
 };
 
 
@@ -220,34 +227,48 @@ private:
 
 
 
-
 class CTimingGrid : public CGeneratorNodeBase
 {
 public:
 
-    CTimingGrid( pugi::xml_node&& node, const CLightSequence *asequense )
+    CTimingGrid( pugi::xml_node&& node, const TrackSummary& asummary )
         : CGeneratorNodeBase( std::move(node) )
-        , sequense( asequense )
+        , summary( asummary )
     { }
 
 protected:
 
     virtual void render() override
     {
-        auto centiSeconds = totalCentseconds( sequense );
+        auto centiSeconds = summary.centiseconds;
         if ( centiSeconds > 0 )
         {
-            append_attribute( "type" ) = "freeform";
+            // One grid line per beat instead of per spectrum frame. Without a
+            // tempo the onsets are used, they are still far fewer than frames.
+            const BeatTrack& beats = summary.beats;
+            const auto& positions = beats.beats.empty() ? beats.onsets : beats.beats;
+
             append_attribute( "saveID" ) = 0;
+            append_attribute( "name" ) = ( beats.bpm > 0.0
+                                           ? "Beats " + std::to_string( int( beats.bpm + 0.5 ) ) + " BPM"
+                                           : std::string( "Onsets" ) ).c_str();
+            append_attribute( "type" ) = "freeform";
 
-            appendChild<CTiming>( uint64_t(1) );
+            uint64_t last = 1;
+            appendChild<CTiming>( last );
 
-            auto& spData = sequense->getAudioFile()->getSpectrum();
-            for ( auto& spectrum : spData )
+            for ( auto position : positions )
             {
-                appendChild<CTiming>( milisecondToCentisecond( spectrum->position ) );
+                auto centisecond = milisecondToCentisecond( position );
+                if ( centisecond > last )
+                {
+                    appendChild<CTiming>( centisecond );
+                    last = centisecond;
+                }
             }
 
+            qDebug() << "Timing grid:" << beats.beats.size() << "beats,"
+                     << beats.onsets.size() << "onsets," << beats.bpm << "BPM";
         }
     }
 
@@ -255,7 +276,7 @@ protected:
     { return "timingGrid"; }
 
 private:
-    const CLightSequence *sequense;
+    const TrackSummary& summary;
 };
 
 
@@ -265,146 +286,372 @@ class CTimingGrids : public CGeneratorNodeBase
 {
 public:
 
-    CTimingGrids( pugi::xml_node&& node, const CLightSequence *asequense )
+    CTimingGrids( pugi::xml_node&& node, const TrackSummary& asummary )
         : CGeneratorNodeBase( std::move(node) )
-        , sequense( asequense )
+        , summary( asummary )
     { }
 
 protected:
 
     virtual void render() override
     {
-        appendChild<CTimingGrid>( sequense );
+        appendChild<CTimingGrid>( summary );
     }
 
     virtual const char* getName( ) override
     { return "timingGrids"; }
 
 private:
-    const CLightSequence *sequense;
+    const TrackSummary& summary;
 };
 
 
 
 
 
-class CEffectInten : public CGeneratorNodeBase
+// Attributes only, the effects are streamed in by CLMSChannelsRenderer
+class CLMSChannel : public CGeneratorNodeBase
 {
 public:
 
-    CEffectInten( pugi::xml_node&& node, uint32_t astartCentisecond, uint32_t aendCentisecond, uint32_t aintensity )
+    CLMSChannel( pugi::xml_node&& node
+                 , const Snapshot::ChannelParams& aparams
+                 , uint32_t& asavedIndex
+                 , uint32_t& acentiseconds )
         : CGeneratorNodeBase( std::move(node) )
-        , startCentisecond( astartCentisecond )
-        , endCentisecond( aendCentisecond )
-        , intensity( aintensity )
+        , channel( aparams.channel )
+        , savedIndex( asavedIndex )
+        , centiseconds( acentiseconds )
     { }
 
 protected:
 
     virtual void render() override
     {
-        append_attribute( "type" ) = "intensity";
-        append_attribute( "startCentisecond" ) = startCentisecond;
-        append_attribute( "endCentisecond" ) = endCentisecond;
-        append_attribute( "intensity" ) = intensity;
+        append_attribute( "name" ) = channel.label.toStdString().c_str();
+        auto color = QColor(channel.color);
+
+        uint32_t calcColor = (uint32_t(color.blue()) & 0xFF )<<16;
+        calcColor = calcColor | ((uint32_t(color.green()) & 0xFF )<<8);
+        calcColor = calcColor | (uint32_t(color.red()) & 0xFF );
+
+        append_attribute( "color" ) = calcColor; //color.red()*color.green()*color.blue();
+        append_attribute( "centiseconds" ) = centiseconds;
+        append_attribute( "deviceType" ) = "LOR";
+        append_attribute( "unit" ) = channel.unit;
+        append_attribute( "circuit" ) = channel.channel;
+        append_attribute( "savedIndex" ) = savedIndex;
     }
 
     virtual const char* getName( ) override
-    { return "effect"; }
+    { return "channel"; }
 
 private:
-    uint32_t startCentisecond;
-    uint32_t endCentisecond;
-    uint32_t intensity;
+    const Channel& channel;
+    uint32_t savedIndex;
+    uint32_t centiseconds;
 };
 
 
 
 
-
-class CLMSChannel : public CGeneratorNodeBase
+class CLMSChannels : public CGeneratorNodeBase
 {
 public:
 
-    CLMSChannel( pugi::xml_node&& node
-                 , const Channel& achannel
-                 , const CLightSequence *asequense
-                 , uint32_t& asavedIndex
-                 , uint32_t& acentiseconds )
+    CLMSChannels( pugi::xml_node&& node, const Snapshot& asnapshot, const TrackSummary& asummary )
         : CGeneratorNodeBase( std::move(node) )
-        , channel( achannel )
-        , sequense( asequense )
-        , savedIndex( asavedIndex )
-        , centiseconds( acentiseconds )
+        , snapshot( asnapshot )
+        , summary( asummary )
     { }
 
 protected:
 
     virtual void render() override
     {
-        if ( nullptr == sequense)
+        uint32_t centiSeconds = uint32_t( summary.centiseconds );
+        for ( uint32_t i = 0; i < snapshot.channels.size(); ++i )
         {
-            return;
+            const Snapshot::ChannelParams& params = snapshot.channels[i];
+            appendChild<CLMSChannel>( params, i, centiSeconds );
         }
+    }
+
+    virtual const char* getName( ) override
+    { return "channels"; }
+
+private:
+    const Snapshot& snapshot;
+    const TrackSummary& summary;
+};
+
+
+
+
+class CLMSSequence : public CGeneratorNodeBase
+{
+public:
+
+    CLMSSequence( pugi::xml_node&& node, const Snapshot& asnapshot, const TrackSummary& asummary )
+        : CGeneratorNodeBase( std::move(node) )
+        , snapshot( asnapshot )
+        , summary( asummary )
+    { }
+
+    virtual void render() override
+    {
+        append_attribute( "saveFileVersion" ) = 14;
+        append_attribute( "author" ) = "Ivan";
+        append_attribute( "createdAt" ) = QDateTime::currentDateTime().toString("dd/MM/yyyy h:m:s ap").toStdString().c_str();
+        append_attribute( "musicFilename" ) = QFileInfo( snapshot.fileName.c_str() ).fileName().toStdString().c_str();
+        append_attribute( "videoUsage" ) = 2;
+
+        appendChild<CLMSChannels>( snapshot, summary );
+        appendChild<CTimingGrids>( summary );
+        appendChild<CTracks>( snapshot, summary );
+    }
+
+    virtual const char* getName( ) override
+    { return "sequence"; }
+
+private:
+    const Snapshot& snapshot;
+    const TrackSummary& summary;
+};
+
+
 
-        auto& spectrum = sequense->getAudioFile()->getSpectrum();
 
-        if ( spectrum.empty() )
+class CFileWriter : public pugi::xml_writer
+{
+public:
+
+    CFileWriter( std::ofstream& aout )
+        : out( aout )
+    {}
+
+    virtual void write( const void* data, size_t size ) override
+    {
+        out.write( static_cast<const char*>( data ), std::streamsize( size ) );
+    }
+
+private:
+    std::ofstream& out;
+};
+
+
+// Start tag in the format of pugi::format_indent, for elements whose children are streamed
+void writeStartTag( std::ofstream& out, const pugi::xml_node& node, unsigned depth )
+{
+    out << std::string( depth, '\t' ) << '<' << node.name();
+    for ( auto attribute : node.attributes() )
+    {
+        out << ' ' << attribute.name() << "=\"";
+        for ( const char* c = attribute.value(); *c; ++c )
         {
-            return;
+            switch ( *c )
+            {
+            case '&': out << "&amp;"; break;
+            case '<': out << "&lt;"; break;
+            case '>': out << "&gt;"; break;
+            case '"': out << "&quot;"; break;
+            default:
+                if ( static_cast<unsigned char>( *c ) < 32 )
+                    out << "&#" << int( *c ) << ';';
+                else
+                    out << *c;
+            }
         }
+        out << '"';
+    }
+    out << ">\n";
+}
+
+
+void writeEndTag( std::ofstream& out, const char* name, unsigned depth )
+{
+    out << std::string( depth, '\t' ) << "</" << name << ">\n";
+}
+
+
 
-        double minimumLevel = 0.0;
-        double fading = channel.fade;
-        double gain = channel.gain;
-        uint32_t spectrumIndex = channel.spectrumIndex;
 
+/**
+ * Renders the channel intensities while the track is analysed, so neither
+ * the spectrum nor the effects of the whole track are held in memory.
+ *
+ * The document lists all effects of one channel before the next channel,
+ * but frames arrive for all channels at once. Intensities are therefore
+ * spilled to a temporary file in blocks of cSpillBlockFrames frames, each
+ * block channel by channel, and the document is written from it at the
+ * end: one contiguous read per channel and block. Memory is one block plus
+ * a few bytes per frame for the beat detection.
+ */
+class CLMSChannelsRenderer : public CSpectrumAnalyzer::IFrameSink
+{
+public:
 
-        auto channelConfigurationPtr = sequense->getConfiguration( channel.uuid );
+    CLMSChannelsRenderer( const Snapshot& asnapshot )
+        : snapshot( asnapshot )
+    { }
 
-        if ( channelConfigurationPtr )
+    virtual void begin( uint32_t sampleRate, uint32_t binCount, std::size_t /*expectedFrames*/ ) override
+    {
+        // One band per channel, all of them are computed in a single pass over the bins
+        std::vector<CBandLayout::Band> bandList;
+        bandList.reserve( snapshot.channels.size() );
+        encoders.clear();
+        for ( const auto& params : snapshot.channels )
         {
-            minimumLevel = channelConfigurationPtr->minimumLevel;
+            const Channel& channel = params.channel;
+            encoders.push_back( CIntensityEncoder::get( CIntensityEncoder::EFormat::LMS, channel.voltage, channel.curve ) );
+            if ( channel.band.isValid() )
+            {
+                bandList.push_back( channel.band );
+                continue;
+            }
 
-            if ( channelConfigurationPtr->isFadeSet() )
-                fading = *channelConfigurationPtr->fade;
+            // The index is a bin of the live spectrum, the same frequency at any FFT size
+            if ( channel.spectrumIndex >= uint32_t( cFFTSize ) )
+            {
+                qWarning() << "Spectrum index" << channel.spectrumIndex << "of" << channel.label << "is out of" << cFFTSize << "bins";
+            }
+            bandList.push_back( CBandLayout::spectrumIndexBand( channel.spectrumIndex, sampleRate ) );
+        }
+
+        layout = CBandLayout( bandList, binCount, sampleRate );
+        this->binCount = binCount;
+        values.assign( bandList.size(), 0.0f );
+        previousValues.assign( bandList.size(), 0.0f );
+        levels.assign( bandList.size(), 0.0 );
 
-            if ( channelConfigurationPtr->isGainSet() )
-                gain = *channelConfigurationPtr->gain;
+        starts.assign( cSpillBlockFrames, 0 );
+        ends.assign( cSpillBlockFrames, 0 );
+        intensities.assign( cSpillBlockFrames * bandList.size(), 0 );
+        blockFrames = 0;
+        frameCount = 0;
+
+        isSpillOk = spill.open();
+        if ( !isSpillOk )
+        {
+            qDebug() << "Was not able to create spill file" << spill.fileName();
+        }
+    }
 
-            if ( channelConfigurationPtr->isSpectrumIndexSet() )
-                spectrumIndex = *channelConfigurationPtr->spectrumIndex;
+    virtual bool append( uint64_t position, const float* bins ) override
+    {
+        if ( !isSpillOk )
+        {
+            return false;
         }
 
+        detector.append( position, bins, binCount );
+        layout.apply( bins, values.data() );
+
+        if ( 0 == frameCount )
+        {
+            firstPosition = position;
+        }
+        else
+        {
+            // The effect of a frame lasts until the next one
+            renderFrame( lastPosition, position );
+        }
+
+        std::swap( values, previousValues );
+        lastPosition = position;
+        ++frameCount;
+        return isSpillOk;
+    }
+
+    // After the last frame, false if nothing was rendered
+    bool finish( TrackSummary& summary )
+    {
+        if ( !isSpillOk || 0 == frameCount )
+        {
+            return false;
+        }
 
-        auto current = spectrum.begin();
+        if ( blockFrames > 0 )
+        {
+            flushBlock();
+        }
 
-        appendChild<CEffectInten>(1u, milisecondToCentisecond( (*current)->position ), 0u);
+        summary.centiseconds = milisecondToCentisecond( lastPosition );
+        summary.beats = detector.detect();
+        return isSpillOk && spill.flush();
+    }
 
-        auto prev = current;
-        ++current;
+    // Second pass, channels is the rendered <channels> element without effects
+    bool writeChannels( std::ofstream& out, const pugi::xml_node& channels, unsigned depth )
+    {
+        writeStartTag( out, channels, depth );
 
-        // To simulate fade effect will be used linear finction:
-        // Y(x) = k*x + b
+        std::vector<uint32_t> blockStarts( cSpillBlockFrames );
+        std::vector<uint32_t> blockEnds( cSpillBlockFrames );
+        std::vector<uint32_t> blockIntensities( cSpillBlockFrames );
+        const uint64_t rendered = frameCount - 1;
 
-        auto getDelta = [ b = 1.0, k = (-1.0 / (1000.0 *fading)) ] ( uint64_t prev, uint64_t current ) -> double
+        uint64_t index = 0;
+        for ( auto channel : channels.children() )
         {
-            auto dt = current - prev;
-            double y = k * double(dt) + b;
-            return b - y;
-        };
+            writeStartTag( out, channel, depth + 1 );
+
+            const std::string indent( depth + 2, '\t' );
+            writeEffect( out, indent, 1u, uint32_t( milisecondToCentisecond( firstPosition ) ), 0u );
+
+            for ( uint64_t block = 0; block * cSpillBlockFrames < rendered; ++block )
+            {
+                const std::size_t frames = std::size_t( std::min<uint64_t>( cSpillBlockFrames, rendered - block * cSpillBlockFrames ) );
+                const qint64 offset = qint64( block * blockBytes() );
+                if ( !readSpill( offset, blockStarts.data() )
+                     || !readSpill( offset + qint64( cSpillBlockFrames * sizeof( uint32_t ) ), blockEnds.data() )
+                     || !readSpill( offset + qint64( ( 2 + index ) * cSpillBlockFrames * sizeof( uint32_t ) ), blockIntensities.data() ) )
+                {
+                    qDebug() << "Was not able to read spill file" << spill.fileName();
+                    return false;
+                }
+
+                for ( std::size_t frame = 0; frame < frames; ++frame )
+                {
+                    writeEffect( out, indent, blockStarts[ frame ], blockEnds[ frame ], blockIntensities[ frame ] );
+                }
+            }
+
+            writeEndTag( out, channel.name(), depth + 1 );
+            ++index;
+        }
+
+        writeEndTag( out, channels.name(), depth );
+        return bool( out );
+    }
 
-        double currentIntensity = 0.0;
+private:
+
+    void renderFrame( uint64_t previous, uint64_t current )
+    {
+        starts[ blockFrames ] = uint32_t( milisecondToCentisecond( previous ) );
+        ends[ blockFrames ] = uint32_t( milisecondToCentisecond( current ) );
 
-        for ( ; current != spectrum.end(); ++prev, ++current)
+        for ( std::size_t i = 0; i < snapshot.channels.size(); ++i )
         {
-            double intensity = (*prev)->spectrum[spectrumIndex] * gain;
-            if ( intensity < minimumLevel )
+            const Snapshot::ChannelParams& params = snapshot.channels[i];
+            const Channel& channel = params.channel;
+
+            // To simulate fade effect will be used linear finction:
+            // Y(x) = k*x + b
+            const double b = 1.0;
+            const double k = -1.0 / ( 1000.0 * channel.fade );
+            const double delta = b - ( k * double( current - previous ) + b );
+
+            double intensity = previousValues[ i ] * channel.gain;
+            if ( intensity < params.minimumLevel )
             {
                 intensity = 0.0;
             }
 
-            currentIntensity -= getDelta( (*prev)->position, (*current)->position );
+            double& currentIntensity = levels[ i ];
+            currentIntensity -= delta;
 
             if ( intensity > currentIntensity )
             {
@@ -416,125 +663,224 @@ protected:
                 currentIntensity = 1.0;
             }
 
-            intensity = (100.0 * currentIntensity) * (channel.voltage / (220.0));
-
-            appendChild<CEffectInten>( milisecondToCentisecond( (*prev)->position ),
-                                           milisecondToCentisecond( (*current)->position ),
-                                           uint32_t(intensity) );
+            intensities[ i * cSpillBlockFrames + blockFrames ] = encoders[ i ].encode( currentIntensity );
         }
 
-        append_attribute( "name" ) = channel.label.toStdString().c_str();
-        auto color = QColor(channel.color);
-
-        uint32_t calcColor = (uint32_t(color.blue()) & 0xFF )<<16;
-        calcColor = calcColor | ((uint32_t(color.green()) & 0xFF )<<8);
-        calcColor = calcColor | (uint32_t(color.red()) & 0xFF );
+        if ( ++blockFrames == cSpillBlockFrames )
+        {
+            flushBlock();
+        }
+    }
 
-        append_attribute( "color" ) = calcColor; //color.red()*color.green()*color.blue();
-        append_attribute( "centiseconds" ) = centiseconds;
-        append_attribute( "deviceType" ) = "LOR";
-        append_attribute( "unit" ) = channel.unit;
-        append_attribute( "circuit" ) = channel.channel;
-        append_attribute( "savedIndex" ) = savedIndex;
+    // Blocks are always written whole, so block n starts at n * blockBytes()
+    void flushBlock()
+    {
+        const qint64 lineBytes = qint64( cSpillBlockFrames * sizeof( uint32_t ) );
+        isSpillOk = isSpillOk
+                && lineBytes == spill.write( reinterpret_cast<const char*>( starts.data() ), lineBytes )
+                && lineBytes == spill.write( reinterpret_cast<const char*>( ends.data() ), lineBytes )
+                && qint64( intensities.size() * sizeof( uint32_t ) ) == spill.write( reinterpret_cast<const char*>( intensities.data() ), qint64( intensities.size() * sizeof( uint32_t ) ) );
+        if ( !isSpillOk )
+        {
+            qDebug() << "Was not able to write spill file" << spill.fileName();
+        }
+        blockFrames = 0;
+    }
 
+    uint64_t blockBytes() const
+    {
+        return uint64_t( 2 + snapshot.channels.size() ) * cSpillBlockFrames * sizeof( uint32_t );
+    }
 
+    bool readSpill( qint64 offset, uint32_t* line )
+    {
+        const qint64 lineBytes = qint64( cSpillBlockFrames * sizeof( uint32_t ) );
+        return spill.seek( offset ) && lineBytes == spill.read( reinterpret_cast<char*>( line ), lineBytes );
     }
 
-    virtual const char* getName( ) override
-    { return "channel"; }
+    static void writeEffect( std::ofstream& out, const std::string& indent, uint32_t start, uint32_t end, uint32_t intensity )
+    {
+        out << indent << "<effect type=\"intensity\" startCentisecond=\"" << start
+            << "\" endCentisecond=\"" << end << "\" intensity=\"" << intensity << "\" />\n";
+    }
 
 private:
-    const Channel& channel;
-    const CLightSequence *sequense;
-    uint32_t savedIndex;
-    uint32_t centiseconds;
+    const Snapshot& snapshot;
+    CBandLayout layout;
+    CBeatDetector detector;
+    uint32_t binCount = 0;
+
+    std::vector<float> values;
+    std::vector<float> previousValues;
+    std::vector<double> levels;       // faded intensity per channel
+    std::vector<CIntensityEncoder> encoders;
+
+    // Current block, intensities are [ channel ][ frame ]
+    std::vector<uint32_t> starts;
+    std::vector<uint32_t> ends;
+    std::vector<uint32_t> intensities;
+    std::size_t blockFrames = 0;
+
+    uint64_t frameCount = 0;
+    uint64_t firstPosition = 0;
+    uint64_t lastPosition = 0;
+
+    QTemporaryFile spill;
+    bool isSpillOk = false;
 };
 
 
-
-
-
-class CLMSChannels : public CGeneratorNodeBase
+bool writeLms( const Snapshot& snapshot, CLMSChannelsRenderer& renderer )
 {
-public:
+    TrackSummary summary;
+    if ( !renderer.finish( summary ) )
+    {
+        return false;
+    }
 
-    CLMSChannels( pugi::xml_node&& node, const CLightSequence *asequense )
-        : CGeneratorNodeBase( std::move(node) )
-        , sequense( asequense )
-    { }
+    // Small part of the document, without the channels
+    pugi::xml_document xml;
+    CLMSSequence lms(xml.append_child( pugi::node_element ), snapshot, summary);
+    lms.set_name( lms.getName() );
+    lms.render();
 
-protected:
+    QString fileName = snapshot.destination
+            + "/" + QFileInfo(snapshot.fileName.c_str()).fileName() + ".lms";
+    std::ofstream out( fileName.toStdString(), std::ios::binary | std::ios::trunc );
+    if ( !out )
+    {
+        qDebug() << "Was not able to open" << fileName;
+        return false;
+    }
 
-    virtual void render() override
+    out << "<?xml version=\"1.0\"?>\n";
+    writeStartTag( out, lms, 0 );
+
+    const pugi::xml_node channels = lms.child( "channels" );
+    CFileWriter writer( out );
+    for ( auto child : lms.children() )
     {
-        if ( nullptr != sequense)
+        if ( child == channels )
         {
-            uint32_t centiSeconds = totalCentseconds( sequense );
-            const auto& channels = sequense->getGlobalConfiguration().channels();
-            for ( uint32_t i = 0; i < channels.size(); ++i )
+            if ( !renderer.writeChannels( out, child, 1 ) )
             {
-                const Channel& channel = channels[i];
-                appendChild<CLMSChannel>( channel, sequense, i, centiSeconds );
+                return false;
             }
+            continue;
         }
+        child.print( writer, "\t", pugi::format_default, pugi::encoding_utf8, 1 );
     }
 
-    virtual const char* getName( ) override
-    { return "channels"; }
-
-private:
-    const CLightSequence *sequense;
-};
+    writeEndTag( out, lms.name(), 0 );
+    out.flush();
+    return bool( out );
+}
 
 
 
 
-class CLMSSequence : public CGeneratorNodeBase
+CSequenseGenerator::Snapshot CSequenseGenerator::makeSnapshot( const QJsonObject &sequense, const CConfigation &configuration )
 {
-public:
-
-    CLMSSequence( pugi::xml_node&& node, const CLightSequence *asequense )
-        : CGeneratorNodeBase( std::move(node) )
-        , sequense( asequense )
-    { }
+    Snapshot snapshot;
+    snapshot.fileName = sequense[ cKeyFileName ].toString().toStdString();
+    snapshot.destination = configuration.getDestination();
+    snapshot.analysis.hopMs = configuration.getAnalysisHopMs();
+    snapshot.analysis.fftSize = configuration.getAnalysisFFTSize();
+    snapshot.analysis.window = configuration.getAnalysisWindow();
+
+    // Per sequense overrides, same rules as CLightSequence::SequenceChannelConfigation::fromJson
+    std::map< QUuid, QJsonObject > overrides;
+    for ( const auto& ccJo : sequense[ cKeyChannelConfiguration ].toArray() )
+    {
+        QUuid uuid( ccJo.toObject()[ cKeyChannelUUID ].toString() );
+        if ( !uuid.isNull() )
+        {
+            overrides[ uuid ] = ccJo.toObject();
+        }
+    }
 
-    virtual void render() override
+    const auto& channels = configuration.channels();
+    snapshot.channels.reserve( channels.size() );
+    for ( const auto& channel : channels )
     {
-        append_attribute( "saveFileVersion" ) = 14;
-        append_attribute( "author" ) = "Ivan";
-        append_attribute( "createdAt" ) = QDateTime::currentDateTime().toString("dd/MM/yyyy h:m:s ap").toStdString().c_str();
-        append_attribute( "musicFilename" ) = QFileInfo( sequense->getFileName().c_str() ).fileName().toStdString().c_str();
-        append_attribute( "videoUsage" ) = 2;
+        Snapshot::ChannelParams params{ channel, cDefaultThreshholdValue };
 
-        appendChild<CLMSChannels>( sequense );
-        appendChild<CTimingGrids>( sequense );
-        appendChild<CTracks>( sequense );
-    }
+        auto it = overrides.find( channel.uuid );
+        if ( overrides.end() != it )
+        {
+            const QJsonObject& jo = it->second;
 
-    virtual const char* getName( ) override
-    { return "sequence"; }
+            // Spectrum index chosen for this sequense wins over the channel frequency range
+            int index = jo[ cKeyChannelSpectrumIndex ].toInt(-1);
+            if ( -1 != index )
+            {
+                params.channel.spectrumIndex = index;
+                params.channel.band = CBandLayout::Band();
+            }
 
-private:
-    const CLightSequence *sequense;
-};
+            double m = jo[ cKeyChannelGain ].toDouble(-1.0);
+            if ( -1.0 != m )
+                params.channel.gain = m;
+
+            m = jo[ cKeyChannelMinimumLevel ].toDouble(-1.0);
+            if ( -1.0 != m )
+                params.minimumLevel = m;
 
+            m = jo[ cKeyChannelFading ].toDouble(-1.0);
+            if ( -1.0 != m )
+                params.channel.fade = m;
+        }
+
+        snapshot.channels.push_back( params );
+    }
 
+    return snapshot;
+}
 
 
-bool CSequenseGenerator::generateLms(const CLightSequence *sequense)
+bool CSequenseGenerator::generateLms( const Snapshot &snapshot, const SpectrumStore& spectrum )
 {
-    if ( nullptr == sequense )
+    if ( snapshot.fileName.empty() || spectrum.empty() )
     {
         return false;
     }
 
-    pugi::xml_document xml;
-    CLMSSequence lms(xml.append_child( pugi::node_element ), sequense);
-    lms.set_name( lms.getName() );
-    lms.render();
-    QString fileName = sequense->getGlobalConfiguration().getDestination()
-            + "/" + QFileInfo(sequense->getFileName().c_str()).fileName() + ".lms";
-    return xml.save_file( fileName.toStdString().c_str() );
+    CLMSChannelsRenderer renderer( snapshot );
+    renderer.begin( spectrum.sampleRate(), spectrum.binCount(), spectrum.size() );
+    for ( std::size_t i = 0; i < spectrum.size(); ++i )
+    {
+        if ( !renderer.append( spectrum.position( i ), spectrum.frame( i ).data() ) )
+        {
+            return false;
+        }
+    }
+
+    return writeLms( snapshot, renderer );
 }
 
 
+bool CSequenseGenerator::generate( const Snapshot &snapshot, const std::atomic_bool *isCanceled )
+{
+    if ( snapshot.fileName.empty() )
+    {
+        return false;
+    }
+
+    // Frames are rendered as they are analysed, the spectrum of the track is never held
+    CLMSChannelsRenderer renderer( snapshot );
+    bool isAnalysed = snapshot.useCache
+            ? CSpectrumCache::analyse( snapshot.fileName, renderer, snapshot.analysis, isCanceled )
+            : CSpectrumAnalyzer::analyse( snapshot.fileName, renderer, snapshot.analysis, isCanceled );
+
+    if ( !isAnalysed )
+    {
+        return false;
+    }
+
+    if ( nullptr != isCanceled && isCanceled->load() )
+    {
+        return false;
+    }
+
+    return writeLms( snapshot, renderer );
+}
@@ -1,15 +1,47 @@
 #ifndef CSEQUENSEGENERATOR_H
 #define CSEQUENSEGENERATOR_H
 #include <fstream>
+#include <atomic>
+#include <vector>
 #include <QString>
-
-class CLightSequence;
+#include <QJsonObject>
+#include "CConfiguration.h"
+#include "cspectrumanalyzer.h"
 
 class CSequenseGenerator
-{   
+{
     CSequenseGenerator() = default;
 public:
-    static bool generateLms( const CLightSequence* sequense );
+
+    /**
+     * Copy of everything the .lms render reads from the sequense and the
+     * global configuration. It is built from the sequense JSON, so the
+     * generation does not need CLightSequence: it can run on a worker
+     * thread or without any widgets at all.
+     */
+    struct Snapshot
+    {
+        struct ChannelParams
+        {
+            Channel channel;      // gain, fade and spectrumIndex already overridden by the sequense
+            double minimumLevel;
+        };
+
+        std::string fileName;
+        QString destination;
+        CSpectrumAnalyzer::Parameters analysis;
+        bool useCache = true;
+        std::vector<ChannelParams> channels;
+    };
+
+    // sequense is an entry of the "sequenses" array written by MainWindow::persist
+    static Snapshot makeSnapshot( const QJsonObject& sequense, const CConfigation& configuration );
+
+    static bool generateLms( const Snapshot& snapshot, const SpectrumStore& spectrum );
+
+    // Decode, analyse and render in one go, safe to call from any thread.
+    // Frames are rendered as they are decoded, memory does not grow with the track.
+    static bool generate( const Snapshot& snapshot, const std::atomic_bool* isCanceled = nullptr );
 
 };
 
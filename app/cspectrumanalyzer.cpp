@@ -0,0 +1,194 @@
+#include "cspectrumanalyzer.h"
+#include <bass.h>
+#include <QDebug>
+#include <vector>
+#include <algorithm>
+#include "constants.h"
+
+// Sample frames requested from the decoder per call
+constexpr uint32_t cDecodeFrames = 4096;
+
+
+uint64_t CSpectrumAnalyzer::hopFrames( uint32_t sampleRate, uint32_t hopMs )
+{
+   uint64_t frames = ( uint64_t( sampleRate ) * hopMs + 500 ) / 1000;
+   return std::max<uint64_t>( frames, 1 );
+}
+
+
+namespace
+{
+
+class CStoreSink : public CSpectrumAnalyzer::IFrameSink
+{
+public:
+
+   CStoreSink( SpectrumStore& aspectrum )
+      : spectrum( aspectrum )
+   {}
+
+   virtual void begin( uint32_t sampleRate, uint32_t binCount, std::size_t expectedFrames ) override
+   {
+      spectrum = SpectrumStore( binCount );
+      spectrum.setSampleRate( sampleRate );
+      spectrum.reserve( expectedFrames );
+   }
+
+   virtual bool append( uint64_t position, const float* bins ) override
+   {
+      spectrum.append( position, bins );
+      return true;
+   }
+
+private:
+   SpectrumStore& spectrum;
+};
+
+}
+
+
+bool CSpectrumAnalyzer::analyse( const std::string &fileName,
+                                 SpectrumStore &spectrum,
+                                 const Parameters &parameters,
+                                 const std::atomic_bool *isCanceled )
+{
+   spectrum.clear();
+   CStoreSink sink( spectrum );
+   if ( !analyse( fileName, sink, parameters, isCanceled ) )
+   {
+      spectrum.clear();
+      return false;
+   }
+   return true;
+}
+
+
+bool CSpectrumAnalyzer::analyse( const std::string &fileName,
+                                 IFrameSink &sink,
+                                 const Parameters &parameters,
+                                 const std::atomic_bool *isCanceled )
+{
+   if ( !CFFTEngine::isValidSize( parameters.fftSize ) )
+   {
+      qDebug() << "Unsupported FFT size" << parameters.fftSize;
+      return false;
+   }
+
+   CFFTEngine engine( parameters.fftSize, parameters.window );
+
+   HSTREAM decoder = BASS_StreamCreateFile( FALSE, fileName.c_str(), 0, 0, BASS_STREAM_DECODE | BASS_SAMPLE_FLOAT );
+   if ( 0 == decoder )
+   {
+      qDebug() << "Was not able to create decode stream from file" << fileName.c_str() << "error:" << BASS_ErrorGetCode();
+      return false;
+   }
+
+   BASS_CHANNELINFO info;
+   if ( !BASS_ChannelGetInfo( decoder, &info ) || 0 == info.freq || 0 == info.chans )
+   {
+      qDebug() << "Was not able to get channel info" << fileName.c_str();
+      BASS_StreamFree( decoder );
+      return false;
+   }
+
+   // Hop is a whole number of sample frames, every FFT window starts at a
+   // multiple of it. Frame timestamps are computed from the sample index,
+   // so they do not depend on timers, load or float rounding.
+   const uint64_t hop = hopFrames( info.freq, parameters.hopMs );
+   if ( hop * 1000 != uint64_t( info.freq ) * parameters.hopMs )
+   {
+      qDebug() << "Hop of" << parameters.hopMs << "ms is rounded to" << hop << "samples at" << info.freq << "Hz";
+   }
+
+   const uint32_t fftSize = engine.size();
+   std::vector<float> decoded( size_t( cDecodeFrames ) * info.chans );
+   std::vector<float> padded( fftSize );
+   std::vector<float> bins( engine.binCount() );
+
+   // Mono samples from sample index monoStart on, never much more than one window
+   std::vector<float> mono;
+   mono.reserve( fftSize + cDecodeFrames );
+   uint64_t monoStart = 0;
+
+   std::size_t expectedFrames = 0;
+   const QWORD length = BASS_ChannelGetLength( decoder, BASS_POS_BYTE );
+   if ( QWORD(-1) != length && length > 0 )
+   {
+      expectedFrames = std::size_t( length / ( hop * info.chans * sizeof( float ) ) + 1 );
+   }
+   sink.begin( info.freq, engine.binCount(), expectedFrames );
+
+   bool isOk = true;
+   bool isEnded = false;
+   for ( uint64_t sampleIndex = 0; ; sampleIndex += hop )
+   {
+      if ( nullptr != isCanceled && isCanceled->load() )
+      {
+         isOk = false;
+         break;
+      }
+
+      // Drop what is before this window, then decode until the window is complete
+      for ( ;; )
+      {
+         const std::size_t drop = std::size_t( std::min<uint64_t>( sampleIndex - monoStart, mono.size() ) );
+         mono.erase( mono.begin(), mono.begin() + drop );
+         monoStart += drop;
+
+         if ( isEnded || monoStart + mono.size() >= sampleIndex + fftSize )
+         {
+            break;
+         }
+
+         DWORD read = BASS_ChannelGetData( decoder, decoded.data(), DWORD( decoded.size() * sizeof( float ) ) | BASS_DATA_FLOAT );
+         if ( DWORD(-1) == read || 0 == read )
+         {
+            isEnded = true;
+            break;
+         }
+
+         const std::size_t frames = read / ( info.chans * sizeof( float ) );
+         for ( std::size_t frame = 0; frame < frames; ++frame )
+         {
+            const float* sample = decoded.data() + frame * info.chans;
+            float sum = 0.0f;
+            for ( DWORD chan = 0; chan < info.chans; ++chan )
+            {
+               sum += sample[ chan ];
+            }
+            mono.push_back( sum / info.chans );
+         }
+      }
+
+      // Last windows of the track are zero padded, the frame exists as long as it starts inside
+      if ( monoStart + mono.size() <= sampleIndex )
+      {
+         break;
+      }
+
+      const float* window = mono.data() + ( sampleIndex - monoStart );
+      if ( mono.size() - ( sampleIndex - monoStart ) < fftSize )
+      {
+         auto tail = std::copy( window, static_cast<const float*>( mono.data() + mono.size() ), padded.begin() );
+         std::fill( tail, padded.end(), 0.0f );
+         window = padded.data();
+      }
+
+      engine.process( window, bins.data() );
+      if ( !sink.append( sampleIndex * 1000 / info.freq, bins.data() ) )
+      {
+         isOk = false;
+         break;
+      }
+   }
+
+   if ( isOk && BASS_ERROR_ENDED != BASS_ErrorGetCode() )
+   {
+      qDebug() << "Decoding of" << fileName.c_str() << "failed, error:" << BASS_ErrorGetCode();
+      isOk = false;
+   }
+
+   BASS_StreamFree( decoder );
+
+   return isOk;
+}
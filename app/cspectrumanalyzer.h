@@ -0,0 +1,65 @@
+#ifndef CSPECTRUMANALYZER_H
+#define CSPECTRUMANALYZER_H
+
+#include <atomic>
+#include <string>
+#include "SpectrumStore.h"
+#include "cfftengine.h"
+#include "constants.h"
+
+/**
+ * Offline spectrum analysis. Opens the audio file as a decode-only BASS
+ * stream, mixes the PCM down to mono and runs CFFTEngine on it as fast as
+ * the decoder allows, instead of sampling a playing stream from a timer.
+ *
+ * Frames are taken every hopMs, rounded to whole sample frames, and their
+ * positions are derived from the sample count. The same file and
+ * parameters give the same frames on any machine and under any load.
+ * Windows overlap when the FFT is longer than the hop.
+ */
+class CSpectrumAnalyzer
+{
+   CSpectrumAnalyzer() = default;
+public:
+
+   using EWindow = CFFTEngine::EWindow;
+
+   // Everything that changes the result, all of it is part of the spectrum cache key
+   struct Parameters
+   {
+      uint32_t hopMs = cDefaultAnalysisHopMs;
+      uint32_t fftSize = cDefaultFFTSize;
+      EWindow window = EWindow::Hann;
+   };
+
+   // Receives the frames in order while the file is decoded
+   class IFrameSink
+   {
+   public:
+      virtual ~IFrameSink() = default;
+
+      // Once before the first frame, expectedFrames is 0 if the length is unknown
+      virtual void begin( uint32_t sampleRate, uint32_t binCount, std::size_t expectedFrames ) = 0;
+
+      // bins are binCount values valid during the call only, false stops the analysis
+      virtual bool append( uint64_t position, const float* bins ) = 0;
+   };
+
+   // Whole track in memory
+   static bool analyse( const std::string& fileName,
+                        SpectrumStore& spectrum,
+                        const Parameters& parameters,
+                        const std::atomic_bool* isCanceled = nullptr );
+
+   // Streams the frames, memory does not depend on the track length
+   static bool analyse( const std::string& fileName,
+                        IFrameSink& sink,
+                        const Parameters& parameters,
+                        const std::atomic_bool* isCanceled = nullptr );
+
+   // Hop in sample frames, at least one
+   static uint64_t hopFrames( uint32_t sampleRate, uint32_t hopMs );
+
+};
+
+#endif // CSPECTRUMANALYZER_H
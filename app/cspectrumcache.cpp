@@ -0,0 +1,303 @@
+#include "cspectrumcache.h"
+#include <QCryptographicHash>
+#include <QStandardPaths>
+#include <QSaveFile>
+#include <QFile>
+#include <QDir>
+#include <QDebug>
+#include <cstring>
+
+constexpr uint32_t cCacheMagic = 0x43534c52; // "RLSC"
+// 2: frames of CFFTEngine instead of BASS_DATA_FFT256
+// 3: sample rate in place of the reserved field
+constexpr uint32_t cCacheVersion = 3;
+
+// A streamed analysis keeps at most this much spectrum to store it afterwards
+constexpr uint64_t cMaxStreamedCacheBytes = 256ull * 1024 * 1024;
+
+namespace
+{
+
+struct Header
+{
+   uint32_t magic;
+   uint32_t version;
+   uint32_t binCount;
+   uint32_t window;
+   uint32_t hopMs;
+   uint32_t sampleRate;
+   uint64_t frameCount;
+};
+
+
+uint64_t spectrumBytes( std::size_t frames, uint32_t binCount )
+{
+   return uint64_t( frames ) * ( sizeof( uint64_t ) + binCount * sizeof( float ) );
+}
+
+
+// Passes the frames through and keeps a copy while it stays under the limit
+class CCachingSink : public CSpectrumAnalyzer::IFrameSink
+{
+public:
+
+   CCachingSink( CSpectrumAnalyzer::IFrameSink& asink )
+      : sink( asink )
+   {}
+
+   virtual void begin( uint32_t sampleRate, uint32_t binCount, std::size_t expectedFrames ) override
+   {
+      isKept = spectrumBytes( expectedFrames, binCount ) <= cMaxStreamedCacheBytes;
+      if ( isKept )
+      {
+         spectrum = SpectrumStore( binCount );
+         spectrum.setSampleRate( sampleRate );
+         spectrum.reserve( expectedFrames );
+      }
+      sink.begin( sampleRate, binCount, expectedFrames );
+   }
+
+   virtual bool append( uint64_t position, const float* bins ) override
+   {
+      if ( isKept )
+      {
+         if ( spectrumBytes( spectrum.size() + 1, spectrum.binCount() ) > cMaxStreamedCacheBytes )
+         {
+            isKept = false;
+            spectrum = SpectrumStore();
+         }
+         else
+         {
+            spectrum.append( position, bins );
+         }
+      }
+      return sink.append( position, bins );
+   }
+
+   bool isKept = false;
+   SpectrumStore spectrum;
+
+private:
+   CSpectrumAnalyzer::IFrameSink& sink;
+};
+
+}
+
+
+CSpectrumCache::Key CSpectrumCache::makeKey( const std::string &fileName, const CSpectrumAnalyzer::Parameters &parameters )
+{
+   Key key;
+   key.binCount = parameters.fftSize / 2;
+   key.window = uint32_t( parameters.window );
+   key.hopMs = parameters.hopMs;
+
+   QFile file( fileName.c_str() );
+   if ( !file.open( QIODevice::ReadOnly ) )
+   {
+      qDebug() << "Was not able to open for hashing" << fileName.c_str();
+      return key;
+   }
+
+   QCryptographicHash hash( QCryptographicHash::Sha1 );
+   if ( hash.addData( &file ) )
+   {
+      key.contentHash = hash.result();
+   }
+
+   return key;
+}
+
+
+QString CSpectrumCache::cacheDirectory()
+{
+   // Generic location, so GUI and spectrum-cli share one cache
+   return QStandardPaths::writableLocation( QStandardPaths::GenericCacheLocation ) + "/rama-light-generator/spectrum";
+}
+
+
+QString CSpectrumCache::cacheFileName( const Key &key )
+{
+   QCryptographicHash hash( QCryptographicHash::Sha1 );
+   hash.addData( key.contentHash );
+   hash.addData( reinterpret_cast<const char*>( &key.binCount ), sizeof( key.binCount ) );
+   hash.addData( reinterpret_cast<const char*>( &key.window ), sizeof( key.window ) );
+   hash.addData( reinterpret_cast<const char*>( &key.hopMs ), sizeof( key.hopMs ) );
+   return cacheDirectory() + "/" + QString::fromLatin1( hash.result().toHex() ) + ".spectrum";
+}
+
+
+bool CSpectrumCache::load( const Key &key, SpectrumStore &spectrum )
+{
+   spectrum.clear();
+   if ( !key.isValid() )
+   {
+      return false;
+   }
+
+   // The file stays open and mapped for as long as a store references it
+   std::shared_ptr<QFile> filePtr( new QFile( cacheFileName( key ) ) );
+   QFile& file = *filePtr;
+   if ( !file.exists() || !file.open( QIODevice::ReadOnly ) )
+   {
+      return false;
+   }
+
+   const qint64 size = file.size();
+   if ( size < qint64( sizeof( Header ) ) )
+   {
+      qDebug() << "Spectrum cache is truncated" << file.fileName();
+      return false;
+   }
+
+   const uchar* data = file.map( 0, size );
+   if ( nullptr == data )
+   {
+      qDebug() << "Was not able to map spectrum cache" << file.fileName();
+      return false;
+   }
+
+   Header header;
+   std::memcpy( &header, data, sizeof( header ) );
+
+   const uint64_t expectedSize = sizeof( Header )
+         + header.frameCount * sizeof( uint64_t )
+         + header.frameCount * header.binCount * sizeof( float );
+
+   if ( cCacheMagic != header.magic
+        || cCacheVersion != header.version
+        || key.binCount != header.binCount
+        || key.window != header.window
+        || key.hopMs != header.hopMs
+        || uint64_t( size ) != expectedSize )
+   {
+      qDebug() << "Spectrum cache does not match, ignored" << file.fileName();
+      return false;
+   }
+
+   // Header is 32 bytes and the mapping is page aligned, so both arrays are aligned
+   const uchar* positions = data + sizeof( Header );
+   const uchar* bins = positions + header.frameCount * sizeof( uint64_t );
+
+   spectrum.adopt( filePtr,
+                   reinterpret_cast<const uint64_t*>( positions ),
+                   reinterpret_cast<const float*>( bins ),
+                   std::size_t( header.frameCount ),
+                   header.binCount );
+   spectrum.setSampleRate( header.sampleRate );
+
+   return !spectrum.empty();
+}
+
+
+bool CSpectrumCache::save( const Key &key, const SpectrumStore &spectrum )
+{
+   if ( !key.isValid() || spectrum.empty() )
+   {
+      return false;
+   }
+
+   if ( spectrum.binCount() != key.binCount )
+   {
+      qDebug() << "Unexpected frame size" << spectrum.binCount() << ", spectrum cache not written";
+      return false;
+   }
+
+   if ( !QDir().mkpath( cacheDirectory() ) )
+   {
+      qDebug() << "Was not able to create spectrum cache directory" << cacheDirectory();
+      return false;
+   }
+
+   // QSaveFile writes to a temporary file and renames it on commit, so a
+   // concurrent reader never sees a half written cache
+   QSaveFile file( cacheFileName( key ) );
+   if ( !file.open( QIODevice::WriteOnly ) )
+   {
+      qDebug() << "Was not able to write spectrum cache" << file.fileName();
+      return false;
+   }
+
+   Header header{ cCacheMagic, cCacheVersion, key.binCount, key.window, key.hopMs, spectrum.sampleRate(), spectrum.size() };
+   file.write( reinterpret_cast<const char*>( &header ), sizeof( header ) );
+
+   auto positions = spectrum.positions();
+   auto bins = spectrum.bins();
+   file.write( reinterpret_cast<const char*>( positions.data() ), positions.size() * sizeof( uint64_t ) );
+   file.write( reinterpret_cast<const char*>( bins.data() ), bins.size() * sizeof( float ) );
+
+   return file.commit();
+}
+
+
+bool CSpectrumCache::analyse( const std::string &fileName,
+                              SpectrumStore &spectrum,
+                              const CSpectrumAnalyzer::Parameters &parameters,
+                              const std::atomic_bool *isCanceled )
+{
+   auto key = makeKey( fileName, parameters );
+   if ( load( key, spectrum ) )
+   {
+      qDebug() << "Spectrum cache hit" << fileName.c_str();
+      return true;
+   }
+
+   if ( !CSpectrumAnalyzer::analyse( fileName, spectrum, parameters, isCanceled ) )
+   {
+      return false;
+   }
+
+   if ( !save( key, spectrum ) )
+   {
+      qDebug() << "Spectrum cache not saved" << fileName.c_str();
+   }
+
+   return true;
+}
+
+
+bool CSpectrumCache::analyse( const std::string &fileName,
+                              CSpectrumAnalyzer::IFrameSink &sink,
+                              const CSpectrumAnalyzer::Parameters &parameters,
+                              const std::atomic_bool *isCanceled )
+{
+   auto key = makeKey( fileName, parameters );
+
+   SpectrumStore spectrum;
+   if ( load( key, spectrum ) )
+   {
+      qDebug() << "Spectrum cache hit" << fileName.c_str();
+
+      // Pages of the mapping are read as they are replayed and can be dropped again
+      sink.begin( spectrum.sampleRate(), spectrum.binCount(), spectrum.size() );
+      for ( std::size_t i = 0; i < spectrum.size(); ++i )
+      {
+         if ( nullptr != isCanceled && isCanceled->load() )
+         {
+            return false;
+         }
+
+         if ( !sink.append( spectrum.position( i ), spectrum.frame( i ).data() ) )
+         {
+            return false;
+         }
+      }
+      return true;
+   }
+
+   CCachingSink cachingSink( sink );
+   if ( !CSpectrumAnalyzer::analyse( fileName, cachingSink, parameters, isCanceled ) )
+   {
+      return false;
+   }
+
+   if ( !cachingSink.isKept )
+   {
+      qDebug() << "Spectrum of" << fileName.c_str() << "is too long for the cache";
+   }
+   else if ( !save( key, cachingSink.spectrum ) )
+   {
+      qDebug() << "Spectrum cache not saved" << fileName.c_str();
+   }
+
+   return true;
+}
@@ -0,0 +1,63 @@
+#ifndef CSPECTRUMCACHE_H
+#define CSPECTRUMCACHE_H
+
+#include <QByteArray>
+#include <QString>
+#include <string>
+#include "cspectrumanalyzer.h"
+
+/**
+ * On-disk cache of analysed spectrum, one binary file per track and
+ * analysis parameters. The file name is a hash of the audio content plus
+ * FFT size, window and hop, so a renamed track still hits and a changed
+ * parameter never does. Files are memory-mapped on load.
+ *
+ * Layout, native endian:
+ *   Header
+ *   uint64_t positions[ frameCount ]
+ *   float    bins[ frameCount * binCount ]
+ */
+class CSpectrumCache
+{
+   CSpectrumCache() = default;
+public:
+
+   struct Key
+   {
+      QByteArray contentHash;
+      uint32_t binCount = cDefaultFFTSize / 2;
+      uint32_t window = uint32_t( CSpectrumAnalyzer::EWindow::Hann );
+      uint32_t hopMs = cDefaultAnalysisHopMs;
+
+      bool isValid() const { return !contentHash.isEmpty(); }
+   };
+
+   // Hashes the whole audio file, empty key if the file can not be read
+   static Key makeKey( const std::string& fileName, const CSpectrumAnalyzer::Parameters& parameters );
+
+   // On a hit the store borrows the mapped file, no frame is copied
+   static bool load( const Key& key, SpectrumStore& spectrum );
+   static bool save( const Key& key, const SpectrumStore& spectrum );
+
+   // Cache lookup, on a miss the file is analysed and the result stored
+   static bool analyse( const std::string& fileName,
+                        SpectrumStore& spectrum,
+                        const CSpectrumAnalyzer::Parameters& parameters = CSpectrumAnalyzer::Parameters(),
+                        const std::atomic_bool* isCanceled = nullptr );
+
+   // Same for a streamed analysis: a hit replays the mapped frames, a miss
+   // is stored on the way only if its spectrum is small enough to hold
+   static bool analyse( const std::string& fileName,
+                        CSpectrumAnalyzer::IFrameSink& sink,
+                        const CSpectrumAnalyzer::Parameters& parameters,
+                        const std::atomic_bool* isCanceled = nullptr );
+
+   static QString cacheDirectory();
+
+private:
+
+   static QString cacheFileName( const Key& key );
+
+};
+
+#endif // CSPECTRUMCACHE_H
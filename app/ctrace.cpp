@@ -0,0 +1,248 @@
+#include "ctrace.h"
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QDebug>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <mutex>
+
+constexpr std::size_t cTraceRingSize = 8192;   // power of two
+constexpr char        cTraceMagic[8] = { 'R', 'L', 'G', 'T', 'R', 'A', 'C', 'E' };
+constexpr uint32_t    cTraceVersion = 1;
+
+static_assert( 32 == sizeof( CTrace::Record ), "Record layout is the dump format" );
+static_assert( 0 == ( cTraceRingSize & ( cTraceRingSize - 1 ) ), "Ring size must be a power of two" );
+
+struct EventInfo
+{
+   const char* name;
+   const char* a;
+   const char* b;
+};
+
+static const EventInfo cEvents[] =
+{
+   { "OutputFrame",       "position",  "channels" },
+   { "SerialWrite",       "bytes",     "deferred" },
+   { "EffectSpectrumBar", "position",  "level" },
+   { "EffectWave",        "seconds",   "level" },
+   { "SpectrographBar",   "bar",       "level" },
+   { "E131Send",          "universe",  "bytes" },
+};
+
+static_assert( sizeof( cEvents ) / sizeof( cEvents[0] ) == static_cast<std::size_t>( ETraceEvent::Count ),
+               "Every event needs a name" );
+
+namespace
+{
+
+struct Ring
+{
+   // Written by the owning thread only, read by snapshot
+   std::atomic<uint64_t> head{ 0 };
+   uint32_t thread = 0;
+   CTrace::Record records[ cTraceRingSize ];
+};
+
+std::mutex& registryMutex()
+{
+   static std::mutex mutex;
+   return mutex;
+}
+
+std::vector< std::shared_ptr<Ring> >& registry()
+{
+   static std::vector< std::shared_ptr<Ring> > rings;
+   return rings;
+}
+
+Ring& localRing()
+{
+   // Rings outlive their threads, so a dump still has what a finished thread did
+   thread_local std::shared_ptr<Ring> ring;
+   if ( nullptr == ring )
+   {
+      auto created = std::make_shared<Ring>();
+      std::lock_guard<std::mutex> lock( registryMutex() );
+      created->thread = static_cast<uint32_t>( registry().size() );
+      registry().push_back( created );
+      ring = created;
+   }
+   return *ring;
+}
+
+}
+
+void CTrace::record( ETraceCategory category, ETraceEvent event, double a, double b )
+{
+   Ring& ring = localRing();
+   const uint64_t head = ring.head.load( std::memory_order_relaxed );
+
+   Record& record = ring.records[ head & ( cTraceRingSize - 1 ) ];
+   record.timeNs = static_cast<uint64_t>( std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      std::chrono::steady_clock::now().time_since_epoch() ).count() );
+   record.thread = ring.thread;
+   record.category = static_cast<uint16_t>( category );
+   record.event = static_cast<uint16_t>( event );
+   record.a = a;
+   record.b = b;
+
+   ring.head.store( head + 1, std::memory_order_release );
+}
+
+std::vector<CTrace::Record> CTrace::snapshot()
+{
+   std::vector< std::shared_ptr<Ring> > rings;
+   {
+      std::lock_guard<std::mutex> lock( registryMutex() );
+      rings = registry();
+   }
+
+   std::vector<Record> records;
+   for ( const auto& ring : rings )
+   {
+      const uint64_t end = ring->head.load( std::memory_order_acquire );
+      const uint64_t begin = end > cTraceRingSize ? end - cTraceRingSize : 0;
+
+      const std::size_t first = records.size();
+      for ( auto index = begin; index < end; ++index )
+      {
+         records.push_back( ring->records[ index & ( cTraceRingSize - 1 ) ] );
+      }
+
+      // Slots the owner reached while copying may be torn, the one it writes now included
+      const uint64_t after = ring->head.load( std::memory_order_acquire );
+      const uint64_t valid = after + 1 > cTraceRingSize ? after + 1 - cTraceRingSize : 0;
+      if ( valid > begin )
+      {
+         const auto torn = static_cast<std::size_t>( std::min( valid, end ) - begin );
+         records.erase( records.begin() + first, records.begin() + first + torn );
+      }
+   }
+
+   std::sort( records.begin(), records.end(), []( const Record& left, const Record& right ){
+      return left.timeNs < right.timeNs;
+   });
+   return records;
+}
+
+bool CTrace::dump( const QString &fileName )
+{
+   const auto records = snapshot();
+
+   QFile file( fileName );
+   if ( !file.open( QIODevice::WriteOnly ) )
+   {
+      qWarning() << "Couldn't write trace:" << fileName << file.errorString();
+      return false;
+   }
+
+   const uint64_t count = records.size();
+   bool isOk = sizeof( cTraceMagic ) == file.write( cTraceMagic, sizeof( cTraceMagic ) )
+            && sizeof( cTraceVersion ) == file.write( reinterpret_cast<const char*>( &cTraceVersion ), sizeof( cTraceVersion ) )
+            && sizeof( count ) == file.write( reinterpret_cast<const char*>( &count ), sizeof( count ) );
+
+   const qint64 bytes = static_cast<qint64>( count * sizeof( Record ) );
+   isOk = isOk && ( 0 == bytes || bytes == file.write( reinterpret_cast<const char*>( records.data() ), bytes ) );
+
+   if ( !isOk )
+   {
+      qWarning() << "Couldn't write trace:" << fileName << file.errorString();
+   }
+   return isOk;
+}
+
+bool CTrace::load( const QString &fileName, std::vector<Record> &records )
+{
+   QFile file( fileName );
+   if ( !file.open( QIODevice::ReadOnly ) )
+   {
+      qWarning() << "Couldn't open trace:" << fileName << file.errorString();
+      return false;
+   }
+
+   char magic[ sizeof( cTraceMagic ) ];
+   uint32_t version = 0;
+   uint64_t count = 0;
+   if ( sizeof( magic ) != file.read( magic, sizeof( magic ) )
+        || 0 != std::memcmp( magic, cTraceMagic, sizeof( magic ) )
+        || sizeof( version ) != file.read( reinterpret_cast<char*>( &version ), sizeof( version ) )
+        || cTraceVersion != version
+        || sizeof( count ) != file.read( reinterpret_cast<char*>( &count ), sizeof( count ) ) )
+   {
+      qWarning() << "Not a trace file:" << fileName;
+      return false;
+   }
+
+   const qint64 bytes = static_cast<qint64>( count * sizeof( Record ) );
+   if ( bytes != file.size() - file.pos() )
+   {
+      qWarning() << "Trace file is truncated:" << fileName;
+      return false;
+   }
+
+   records.resize( count );
+   return 0 == bytes || bytes == file.read( reinterpret_cast<char*>( records.data() ), bytes );
+}
+
+bool CTrace::toTimeline( const std::vector<Record> &records, const QString &fileName )
+{
+   const uint64_t startNs = records.empty() ? 0 : records.front().timeNs;
+
+   QJsonArray events;
+   for ( const auto& record : records )
+   {
+      QJsonObject args;
+      if ( record.event < static_cast<uint16_t>( ETraceEvent::Count ) )
+      {
+         args[ cEvents[ record.event ].a ] = record.a;
+         args[ cEvents[ record.event ].b ] = record.b;
+      }
+
+      // Counter events, every event is a graph over time per thread
+      QJsonObject event;
+      event[ "name" ] = eventName( record.event );
+      event[ "cat" ] = categoryName( record.category );
+      event[ "ph" ] = "C";
+      event[ "ts" ] = double( record.timeNs - startNs ) / 1000.0;
+      event[ "pid" ] = 1;
+      event[ "tid" ] = static_cast<int>( record.thread );
+      event[ "args" ] = args;
+      events.append( event );
+   }
+
+   QJsonObject timeline;
+   timeline[ "traceEvents" ] = events;
+   timeline[ "displayTimeUnit" ] = "ms";
+
+   QFile file( fileName );
+   if ( !file.open( QIODevice::WriteOnly ) )
+   {
+      qWarning() << "Couldn't write timeline:" << fileName << file.errorString();
+      return false;
+   }
+   file.write( QJsonDocument( timeline ).toJson( QJsonDocument::Compact ) );
+   return true;
+}
+
+const char *CTrace::eventName( uint16_t event )
+{
+   return event < static_cast<uint16_t>( ETraceEvent::Count ) ? cEvents[ event ].name : "Unknown";
+}
+
+const char *CTrace::categoryName( uint16_t category )
+{
+   switch ( static_cast<ETraceCategory>( category ) )
+   {
+   case ETraceCategory::Output:       return "output";
+   case ETraceCategory::Serial:       return "serial";
+   case ETraceCategory::Effect:       return "effect";
+   case ETraceCategory::Spectrograph: return "spectrograph";
+   }
+   return "unknown";
+}
@@ -0,0 +1,85 @@
+#ifndef CTRACE_H
+#define CTRACE_H
+
+#include <cstdint>
+#include <vector>
+#include <QString>
+
+// Categories compiled in, e.g. qmake DEFINES+=TRACE_CATEGORIES=0x3, all by default
+#ifndef TRACE_CATEGORIES
+#define TRACE_CATEGORIES 0xFFFFFFFFu
+#endif
+
+enum class ETraceCategory : uint32_t
+{
+   Output       = 0x1,
+   Serial       = 0x2,
+   Effect       = 0x4,
+   Spectrograph = 0x8,
+};
+
+// Stored by value in dumps, append only
+enum class ETraceEvent : uint16_t
+{
+   OutputFrame,         // position ms, channels
+   SerialWrite,         // bytes, deferred updates
+   EffectSpectrumBar,   // position ms, level
+   EffectWave,          // seconds since effect start, level
+   SpectrographBar,     // bar index, level
+   E131Send,            // universe, bytes
+   Count
+};
+
+/**
+ * Binary trace for hot paths, instead of formatted log lines.
+ *
+ * Every thread records into its own ring of the last cTraceRingSize records,
+ * recording is a clock read and a 32 byte store without locks or formatting.
+ * Only the first record of a thread takes a lock to register its ring.
+ * Categories outside TRACE_CATEGORIES compile to nothing.
+ *
+ * dump() writes the rings on demand, toTimeline() turns a dump into the
+ * Chrome trace event format that chrome://tracing and Perfetto display.
+ */
+class CTrace
+{
+public:
+
+   struct Record
+   {
+      uint64_t timeNs;     // steady clock
+      uint32_t thread;     // in order of the first record
+      uint16_t category;
+      uint16_t event;
+      double a;
+      double b;
+   };
+
+   static constexpr bool isEnabled( ETraceCategory category )
+   {
+      return 0 != ( TRACE_CATEGORIES & static_cast<uint32_t>( category ) );
+   }
+
+   static void record( ETraceCategory category, ETraceEvent event, double a, double b );
+
+   // Records of all threads sorted by time, safe while threads record.
+   // Records overwritten during the copy are left out.
+   static std::vector<Record> snapshot();
+
+   static bool dump( const QString& fileName );
+   static bool load( const QString& fileName, std::vector<Record>& records );
+   static bool toTimeline( const std::vector<Record>& records, const QString& fileName );
+
+   static const char* eventName( uint16_t event );
+   static const char* categoryName( uint16_t category );
+};
+
+#define TRACE( category, event, a, b ) \
+   do { \
+      if ( CTrace::isEnabled( category ) ) \
+      { \
+         CTrace::record( category, event, double( a ), double( b ) ); \
+      } \
+   } while ( false )
+
+#endif // CTRACE_H
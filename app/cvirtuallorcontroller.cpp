@@ -0,0 +1,240 @@
+#include "cvirtuallorcontroller.h"
+#include <QDebug>
+#include <algorithm>
+#include <chrono>
+
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+#endif
+
+constexpr uint8_t  cCommandIntensity = 0x03;
+constexpr uint8_t  cCommandIntensityMask8 = 0x33;
+constexpr uint8_t  cCommandIntensityMask16 = 0x13;
+constexpr uint8_t  cHeartbeatUnit = 0xFF;
+constexpr uint8_t  cHeartbeatCommand = 0x81;
+constexpr int      cPollMs = 1;
+
+// 8N1, ten bits on the line for every byte
+constexpr uint64_t cBitsPerByte = 10;
+
+static uint64_t steadyNs()
+{
+    return static_cast<uint64_t>( std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                     std::chrono::steady_clock::now().time_since_epoch() ).count() );
+}
+
+CVirtualLorController::~CVirtualLorController()
+{
+    close();
+}
+
+bool CVirtualLorController::open( uint32_t baudRate )
+{
+#ifdef Q_OS_UNIX
+    close();
+
+    m_master = posix_openpt( O_RDWR | O_NOCTTY );
+    if ( m_master < 0 || 0 != grantpt( m_master ) || 0 != unlockpt( m_master ) )
+    {
+        qWarning() << "Was not able to create a pseudo-terminal";
+        close();
+        return false;
+    }
+
+    m_portName = QString::fromLocal8Bit( ptsname( m_master ) );
+
+    // Held open, so the master does not see a hangup while the port reopens
+    m_slave = ::open( ptsname( m_master ), O_RDWR | O_NOCTTY );
+    if ( m_slave < 0 )
+    {
+        qWarning() << "Was not able to open" << m_portName;
+        close();
+        return false;
+    }
+
+    termios attributes;
+    if ( 0 == tcgetattr( m_slave, &attributes ) )
+    {
+        cfmakeraw( &attributes );
+        tcsetattr( m_slave, TCSANOW, &attributes );
+    }
+
+    m_baudRate = baudRate;
+    m_pending.clear();
+    m_commands.clear();
+    m_bytes.store( 0 );
+    m_unknownBytes.store( 0 );
+    m_isStopping.store( false );
+    m_reader = std::thread( &CVirtualLorController::read, this );
+    return true;
+#else
+    Q_UNUSED( baudRate );
+    qWarning() << "Virtual LOR controller needs a pseudo-terminal, not supported on this platform";
+    return false;
+#endif
+}
+
+void CVirtualLorController::close()
+{
+    m_isStopping.store( true );
+    if ( m_reader.joinable() )
+    {
+        m_reader.join();
+    }
+
+#ifdef Q_OS_UNIX
+    if ( m_slave >= 0 )
+    {
+        ::close( m_slave );
+        m_slave = -1;
+    }
+    if ( m_master >= 0 )
+    {
+        ::close( m_master );
+        m_master = -1;
+    }
+#endif
+}
+
+std::vector<CVirtualLorController::Command> CVirtualLorController::takeCommands()
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    std::vector<Command> commands;
+    commands.swap( m_commands );
+    return commands;
+}
+
+void CVirtualLorController::read()
+{
+#ifdef Q_OS_UNIX
+    const uint64_t startNs = steadyNs();
+    uint64_t received = 0;
+    uint8_t buffer[ 4096 ];
+
+    while ( !m_isStopping.load() )
+    {
+        pollfd descriptor{ m_master, POLLIN, 0 };
+        if ( poll( &descriptor, 1, cPollMs ) <= 0 || 0 == ( descriptor.revents & POLLIN ) )
+        {
+            continue;
+        }
+
+        // The line has moved only so many bytes since the start
+        std::size_t allowed = sizeof( buffer );
+        if ( 0 != m_baudRate )
+        {
+            const uint64_t line = ( steadyNs() - startNs ) * m_baudRate / ( cBitsPerByte * 1000000000ull );
+            if ( line <= received )
+            {
+                std::this_thread::sleep_for( std::chrono::milliseconds( cPollMs ) );
+                continue;
+            }
+            allowed = static_cast<std::size_t>( std::min<uint64_t>( line - received, sizeof( buffer ) ) );
+        }
+
+        const auto count = ::read( m_master, buffer, allowed );
+        if ( count <= 0 )
+        {
+            continue;
+        }
+
+        received += static_cast<uint64_t>( count );
+        m_bytes += static_cast<uint64_t>( count );
+        decode( buffer, static_cast<std::size_t>( count ), steadyNs() );
+    }
+#endif
+}
+
+void CVirtualLorController::decode( const uint8_t *data, std::size_t size, uint64_t timeNs )
+{
+    m_pending.insert( m_pending.end(), data, data + size );
+
+    std::vector<Command> commands;
+    std::size_t offset = 0;
+    while ( offset < m_pending.size() )
+    {
+        const uint8_t* bytes = m_pending.data() + offset;
+        const std::size_t available = m_pending.size() - offset;
+
+        // Every command starts with 00, padding zeros between them are skipped
+        if ( 0x00 != bytes[0] )
+        {
+            ++m_unknownBytes;
+            ++offset;
+            continue;
+        }
+        if ( available < 3 )
+        {
+            break;
+        }
+        if ( 0x00 == bytes[1] )
+        {
+            ++offset;
+            continue;
+        }
+
+        const uint8_t unit = bytes[1];
+        const uint8_t command = bytes[2];
+        std::size_t length = 0;
+        Command decoded{ timeNs, ECommand::Unknown, unit, 0, 0 };
+
+        if ( cHeartbeatUnit == unit && cHeartbeatCommand == command )
+        {
+            length = 5;
+            decoded.type = ECommand::Heartbeat;
+        }
+        else if ( cCommandIntensity == command || cCommandIntensityMask8 == command )
+        {
+            length = 6;
+        }
+        else if ( cCommandIntensityMask16 == command )
+        {
+            length = 7;
+        }
+        else
+        {
+            // Unknown command, resynchronised on the next 00
+            ++m_unknownBytes;
+            ++offset;
+            continue;
+        }
+
+        if ( available < length )
+        {
+            break;
+        }
+
+        if ( ECommand::Heartbeat != decoded.type )
+        {
+            decoded.type = ECommand::Intensity;
+            decoded.level = bytes[3];
+            if ( cCommandIntensity == command )
+            {
+                decoded.channels = static_cast<uint16_t>( 1u << ( bytes[4] & 0x0F ) );
+            }
+            else if ( cCommandIntensityMask8 == command )
+            {
+                decoded.channels = bytes[4];
+            }
+            else
+            {
+                decoded.channels = static_cast<uint16_t>( bytes[4] | ( bytes[5] << 8 ) );
+            }
+        }
+
+        commands.push_back( decoded );
+        offset += length;
+    }
+
+    m_pending.erase( m_pending.begin(), m_pending.begin() + offset );
+
+    if ( !commands.empty() )
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        m_commands.insert( m_commands.end(), commands.begin(), commands.end() );
+    }
+}
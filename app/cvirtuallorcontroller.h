@@ -0,0 +1,81 @@
+#ifndef CVIRTUALLORCONTROLLER_H
+#define CVIRTUALLORCONTROLLER_H
+
+#include <QString>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * LOR controller stand-in on a pseudo-terminal, for measuring the live
+ * output without hardware. Unix only.
+ *
+ * portName() is the slave side, it opens like any serial port. A reader
+ * thread takes the bytes from the master side at the pace of the baud
+ * rate, so a port that writes more than the line carries backs up as it
+ * would on a real line. Commands are decoded as described in
+ * doc/capturedCOM-data and timestamped on the steady clock when their last
+ * byte arrives.
+ */
+class CVirtualLorController
+{
+public:
+
+   enum class ECommand : uint8_t
+   {
+      Heartbeat,
+      Intensity,
+      Unknown
+   };
+
+   struct Command
+   {
+      uint64_t timeNs;       // steady clock
+      ECommand type;
+      uint8_t unit;
+      uint8_t level;
+      uint16_t channels;     // bit n is channel n+1
+   };
+
+   CVirtualLorController() = default;
+   ~CVirtualLorController();
+
+   // baudRate 0 reads as fast as the port writes
+   bool open( uint32_t baudRate );
+   void close();
+
+   const QString& portName() const { return m_portName; }
+
+   // Commands decoded since the last call
+   std::vector<Command> takeCommands();
+
+   uint64_t bytes() const { return m_bytes.load(); }
+   uint64_t unknownBytes() const { return m_unknownBytes.load(); }
+
+private:
+
+   void read();
+   void decode( const uint8_t* data, std::size_t size, uint64_t timeNs );
+
+private:
+
+   int m_master = -1;
+   int m_slave = -1;
+   QString m_portName;
+   uint32_t m_baudRate = 0;
+
+   std::thread m_reader;
+   std::atomic_bool m_isStopping{ false };
+   std::atomic<uint64_t> m_bytes{ 0 };
+   std::atomic<uint64_t> m_unknownBytes{ 0 };
+
+   // Owned by the reader thread
+   std::vector<uint8_t> m_pending;
+
+   std::mutex m_mutex;
+   std::vector<Command> m_commands;
+};
+
+#endif // CVIRTUALLORCONTROLLER_H
@@ -0,0 +1,86 @@
+#include <QVBoxLayout>
+#include <QLabel>
+
+#include "widgets/FloatSliderWidget.h"
+#include "CEffectBeat.h"
+#include "cbeatdetector.h"
+#include "constants.h"
+
+const QString cKeyIntensityValue( "intensityValue" );
+const QString cKeyFadeValue( "fadeValue" );
+
+
+QJsonObject CEffectBeat::toJsonParameters() const
+{
+   QJsonObject parameters;
+
+   parameters[ cKeyIntensityValue ] = m_intensity;
+   parameters[ cKeyFadeValue ] = m_fade;
+
+   return parameters;
+}
+
+bool CEffectBeat::parseParameters(const QJsonObject &parameters)
+{
+   bool isOk = false;
+   if ( parameters.contains( cKeyIntensityValue )
+        && parameters.contains( cKeyFadeValue )  )
+   {
+      if ( parameters[ cKeyIntensityValue ].isDouble()
+           && parameters[ cKeyFadeValue ].isDouble() )
+      {
+         m_intensity = parameters[ cKeyIntensityValue ].toDouble( );
+         m_fade = parameters[ cKeyFadeValue ].toDouble( );
+         isOk = true;
+      }
+   }
+   return isOk;
+}
+
+double CEffectBeat::calculateIntensity(const SpectrumData &spectrumData, State &)
+{
+   // Beats are detected in the background, the effect stays dark until they are known
+   if ( nullptr == spectrumData.beats )
+   {
+      return 0.0;
+   }
+
+   auto sinceBeat = spectrumData.beats->sinceLastBeat( spectrumData.position );
+   if ( sinceBeat < 0 )
+   {
+      return 0.0;
+   }
+
+   double fadeMs = 1000.0 * ( m_fade < 0.01 ? 0.01 : m_fade );
+   double level = m_intensity * ( 1.0 - double( sinceBeat ) / fadeMs );
+   return level > 0.0 ? level : 0.0;
+}
+
+QWidget *CEffectBeat::buildWidget(QWidget *parent)
+{
+   QWidget* configWidget = new QWidget( parent );
+
+   auto vlayout = new QVBoxLayout( );
+
+   vlayout->addWidget( new QLabel("Intensity: ", configWidget) );
+   FloatSliderWidget * intensity = new FloatSliderWidget( cMaxIntensity, cMinIntensity, m_intensity, configWidget );
+   vlayout->addWidget( intensity );
+
+   vlayout->addWidget( new QLabel("Fade: ", configWidget) );
+   FloatSliderWidget * fade = new FloatSliderWidget( cMaxFadeValue, cMinFadeValue, m_fade, configWidget );
+   vlayout->addWidget( fade );
+
+   QObject::connect( intensity, &FloatSliderWidget::valueChanged, [ this ]( double value ){ m_intensity = value; parametersChanged(); });
+   QObject::connect( fade, &FloatSliderWidget::valueChanged, [ this ]( double value ){ m_fade = value; parametersChanged(); });
+
+   configWidget->setLayout( vlayout );
+
+   return configWidget;
+}
+
+std::shared_ptr<IEffectGenerator> CEffectBeat::makeCopy() const
+{
+    return std::make_shared<CEffectBeat>(*this);
+}
+
+DECLARE_EFFECT_FACTORY( Beat, CEffectBeat )
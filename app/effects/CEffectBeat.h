@@ -0,0 +1,33 @@
+#ifndef CEFFECTBEAT_H
+#define CEFFECTBEAT_H
+
+#include "timeline/IEffectGenerator.h"
+
+// Flashes on every detected beat of the track and fades out until the next one
+class CEffectBeat: public IEffectGenerator
+{
+public:
+
+   CEffectBeat( IEffectGeneratorFactory& afactory )
+      : IEffectGenerator( afactory )
+   {}
+
+   CEffectBeat( IEffectGeneratorFactory& afactory, const QUuid& uuid )
+      : IEffectGenerator(afactory, uuid)
+   {}
+
+protected:
+   virtual QJsonObject toJsonParameters() const override;
+   virtual bool parseParameters( const QJsonObject& parameters ) override;
+   virtual double calculateIntensity( const SpectrumData& spectrumData, State& state ) override;
+   virtual QWidget *buildWidget(QWidget *parent) override;
+   virtual std::shared_ptr<IEffectGenerator> makeCopy() const override;
+
+private:
+
+   double m_intensity = 1.0;
+   double m_fade = 0.5;
+};
+
+
+#endif // CEFFECTBEAT_H
@@ -36,7 +36,7 @@ bool CEffectFade::parseParameters(const QJsonObject &parameters)
    return isOk;
 }
 
-double CEffectFade::calculateIntensity(const SpectrumData &spectrumData)
+double CEffectFade::calculateIntensity(const SpectrumData &spectrumData, State &)
 {
    double& y0 = m_start_intensity;
    double& y1 = m_end_intensity;
@@ -47,6 +47,26 @@ double CEffectFade::calculateIntensity(const SpectrumData &spectrumData)
    return y;
 }
 
+void CEffectFade::calculateIntensities( const SpectrumStore &spectrum,
+                                        const std::shared_ptr<const BeatTrack> &,
+                                        std::size_t first,
+                                        std::size_t count,
+                                        float *out,
+                                        State & )
+{
+   const double y0 = m_start_intensity;
+   const double y1 = m_end_intensity;
+   const double x0 = effectStartPosition();
+   const double x1 = effectDuration() + effectStartPosition();
+   const uint64_t* positions = spectrum.positions().data() + first;
+
+   // Same expression as calculateIntensity(), a straight loop without state
+   for ( std::size_t i = 0; i < count; ++i )
+   {
+      out[ i ] = float( y0 + (positions[ i ] - x0)*(y1 - y0)/(x1 - x0) );
+   }
+}
+
 QWidget *CEffectFade::buildWidget(QWidget *parent)
 {
    QWidget* configWidget = new QWidget( parent );
@@ -63,10 +83,12 @@ QWidget *CEffectFade::buildWidget(QWidget *parent)
 
    QObject::connect( startIntensity, &FloatSliderWidget::valueChanged, [ this ]( double value ){
       m_start_intensity = value;
+      parametersChanged();
    });
 
    QObject::connect( endIntensity, &FloatSliderWidget::valueChanged, [ this ]( double value ){
       m_end_intensity = value;
+      parametersChanged();
    });
 
    configWidget->setLayout( vlayout );
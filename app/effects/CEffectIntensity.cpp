@@ -1,4 +1,5 @@
 #include "CEffectIntensity.h"
+#include <algorithm>
 #include "widgets/FloatSliderWidget.h"
 #include "constants.h"
 
@@ -28,11 +29,21 @@ bool CEffectIntensity::parseParameters(const QJsonObject &parameters)
     return isOk;
 }
 
-double CEffectIntensity::calculateIntensity(const SpectrumData &)
+double CEffectIntensity::calculateIntensity(const SpectrumData &, State &)
 {
     return m_intensity;
 }
 
+void CEffectIntensity::calculateIntensities( const SpectrumStore &,
+                                             const std::shared_ptr<const BeatTrack> &,
+                                             std::size_t,
+                                             std::size_t count,
+                                             float *out,
+                                             State & )
+{
+    std::fill( out, out + count, float( m_intensity ) );
+}
+
 QWidget *CEffectIntensity::buildWidget(QWidget *parent)
 {
     QWidget* configWidget = new QWidget( parent );
@@ -42,7 +53,7 @@ QWidget *CEffectIntensity::buildWidget(QWidget *parent)
 
     FloatSliderWidget * intensity = new FloatSliderWidget( cMaxIntensity, cMinIntensity, m_intensity, configWidget );
 
-    QObject::connect(intensity, &FloatSliderWidget::valueChanged, [ this ]( double value ){ m_intensity = value; });
+    QObject::connect(intensity, &FloatSliderWidget::valueChanged, [ this ]( double value ){ m_intensity = value; parametersChanged(); });
 
     vlayout->addWidget( intensity );
     configWidget->setLayout( vlayout );
@@ -24,7 +24,13 @@ protected:
    virtual QJsonObject toJsonParameters() const override;
    virtual bool parseParameters( const QJsonObject& parameters ) override;
 
-   virtual double calculateIntensity( const SpectrumData& spectrumData  ) override;
+   virtual double calculateIntensity( const SpectrumData& spectrumData, State& state ) override;
+   virtual void calculateIntensities( const SpectrumStore& spectrum,
+                                      const std::shared_ptr<const BeatTrack>& beats,
+                                      std::size_t first,
+                                      std::size_t count,
+                                      float* out,
+                                      State& state ) override;
 
    virtual QWidget *buildWidget(QWidget *parent) override;
    virtual std::shared_ptr<IEffectGenerator> makeCopy() const override;
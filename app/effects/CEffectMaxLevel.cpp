@@ -7,6 +7,44 @@
 
 #include "CEffectMaxLevel.h"
 
+#if defined( __SSE2__ ) || defined( _M_X64 )
+#include <emmintrin.h>
+#define EFFECT_USE_SSE2
+#endif
+
+namespace
+{
+
+// Largest bin, not below 0, NaN bins are skipped
+float maxOf( const float* bins, std::size_t count )
+{
+    float maxLevel = 0;
+    std::size_t i = 0;
+
+#if defined( EFFECT_USE_SSE2 )
+    // max( x, acc ) gives acc when x is NaN
+    __m128 acc = _mm_setzero_ps();
+    for ( ; i + 4 <= count; i += 4 )
+    {
+        acc = _mm_max_ps( _mm_loadu_ps( bins + i ), acc );
+    }
+    acc = _mm_max_ps( acc, _mm_shuffle_ps( acc, acc, _MM_SHUFFLE( 1, 0, 3, 2 ) ) );
+    acc = _mm_max_ps( acc, _mm_shuffle_ps( acc, acc, _MM_SHUFFLE( 2, 3, 0, 1 ) ) );
+    maxLevel = _mm_cvtss_f32( acc );
+#endif
+
+    for ( ; i < count; ++i )
+    {
+        if ( bins[ i ] > maxLevel )
+        {
+            maxLevel = bins[ i ];
+        }
+    }
+    return maxLevel;
+}
+
+}
+
 
 const QString cKeyGainValue( "gainValue" );
 const QString cKeyFadeValue( "fadeValue" );
@@ -39,43 +77,46 @@ bool CEffectMaxLevel::parseParameters(const QJsonObject &parameters)
    return isOk;
 }
 
-double CEffectMaxLevel::calculateIntensity(const SpectrumData &spectrumData)
+double CEffectMaxLevel::calculateIntensity(const SpectrumData &spectrumData, State &state)
 {
-    float maxLevel = 0;
-    for ( auto& level : spectrumData.spectrum )
+    return follow( state, spectrumData.position, maxOf( spectrumData.spectrum.data(), spectrumData.spectrum.size() ) );
+}
+
+void CEffectMaxLevel::calculateIntensities( const SpectrumStore &spectrum,
+                                            const std::shared_ptr<const BeatTrack> &,
+                                            std::size_t first,
+                                            std::size_t count,
+                                            float *out,
+                                            State &state )
+{
+    // Frames are contiguous, only the fade from frame to frame is sequential
+    const uint32_t binCount = spectrum.binCount();
+    const float* bins = spectrum.frame( first ).data();
+    for ( std::size_t i = 0; i < count; ++i, bins += binCount )
     {
-        if ( level > maxLevel )
-        {
-            maxLevel = level;
-        }
+        out[ i ] = float( follow( state, spectrum.position( first + i ), maxOf( bins, binCount ) ) );
     }
+}
+
+int64_t CEffectMaxLevel::lookbackMs() const
+{
+    return fadeLookbackMs( m_fade );
+}
 
+double CEffectMaxLevel::follow( State& state, uint64_t position, float maxLevel ) const
+{
     maxLevel = maxLevel * m_gain;
     if ( maxLevel > 1.0 )
         maxLevel = 1.0;
     else if ( maxLevel < 0.0 )
         maxLevel = 0.0;
 
-    auto dt = int64_t(spectrumData.position) - lastPosition;
-    if (dt < 0)
+    if ( fadeLevel( state, position, m_fade ) < maxLevel )
     {
-        dt=0;
+        state.level = maxLevel;
     }
-    lastPosition = spectrumData.position;
-
-   auto k = (-1.0 / (1000.0 * ( m_fade < 0.1 ? 0.1 : m_fade )));
-   auto b = 1.0;
-   double y = k * double(dt) + b;
-   double intensityReduction = b - y;
-
-   lastLevel -= intensityReduction;
-
-   if ( lastLevel < maxLevel )
-   {
-       lastLevel = maxLevel;
-   }
 
-   return lastLevel;
+    return state.level;
 }
 
 QWidget *CEffectMaxLevel::buildWidget(QWidget *parent)
@@ -101,8 +142,8 @@ QWidget *CEffectMaxLevel::buildWidget(QWidget *parent)
    FloatSliderWidget * fade = new FloatSliderWidget( cMaxFadeValue, cMinFadeValue, m_fade, configWidget );
    vlayout->addWidget( fade );
 
-   QObject::connect( gain, &FloatSliderWidget::valueChanged, [ this ]( double value ){ m_gain = value; });
-   QObject::connect( fade, &FloatSliderWidget::valueChanged, [ this ]( double value ){ m_fade = value; });
+   QObject::connect( gain, &FloatSliderWidget::valueChanged, [ this ]( double value ){ m_gain = value; parametersChanged(); });
+   QObject::connect( fade, &FloatSliderWidget::valueChanged, [ this ]( double value ){ m_fade = value; parametersChanged(); });
 
    auto widget = new QWidget( configWidget );
    vlayout->addWidget( widget );
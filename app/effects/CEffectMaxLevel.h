@@ -19,16 +19,29 @@ public:
 protected:
    virtual QJsonObject toJsonParameters() const override;
    virtual bool parseParameters( const QJsonObject& parameters ) override;
-   virtual double calculateIntensity( const SpectrumData& spectrumData  ) override;
+   virtual double calculateIntensity( const SpectrumData& spectrumData, State& state ) override;
+   virtual void calculateIntensities( const SpectrumStore& spectrum,
+                                      const std::shared_ptr<const BeatTrack>& beats,
+                                      std::size_t first,
+                                      std::size_t count,
+                                      float* out,
+                                      State& state ) override;
    virtual QWidget *buildWidget(QWidget *parent) override;
    virtual std::shared_ptr<IEffectGenerator> makeCopy() const override;
 
+public:
+   // The fade of a full level is over after this
+   virtual int64_t lookbackMs() const override;
+
+private:
+
+   // Fades the level of state down to position and raises it to level
+   double follow( State& state, uint64_t position, float level ) const;
+
 private:
 
    double m_gain = cDefaultGainValue;
    double m_fade = cDefaultFadeValue;
-   int64_t lastPosition = 0;
-   double lastLevel = 0;
 };
 
 
@@ -4,6 +4,8 @@
 #include "widgets/FloatSliderWidget.h"
 #include "spectrograph.h"
 #include "CEffectSpectrumBar.h"
+#include "cbandlayout.h"
+#include "ctrace.h"
 
 
 const QString cKeyGainValue( "gainValue" );
@@ -43,7 +45,7 @@ bool CEffectSpectrumBar::parseParameters(const QJsonObject &parameters)
 }
 
 
-double CEffectSpectrumBar::calculateIntensity(const SpectrumData &spectrumData)
+double CEffectSpectrumBar::calculateIntensity(const SpectrumData &spectrumData, State &state)
 {
 
    auto intensityLevel = 0.0;
@@ -52,42 +54,68 @@ double CEffectSpectrumBar::calculateIntensity(const SpectrumData &spectrumData)
       intensityLevel = spectrumData.spectrum[ m_spectrumBarIndex ] * m_gain;
    }
 
-   if ( intensityLevel > 1.0 )
-   {
-      intensityLevel = 1.0;
-   }
-   else if ( intensityLevel < 0.0 )
+   const double level = follow( state, spectrumData.position, intensityLevel );
+
+   TRACE( ETraceCategory::Effect, ETraceEvent::EffectSpectrumBar, spectrumData.position, level );
+
+   if ( nullptr != spectrograph )
    {
-      intensityLevel = 0.0;
+      spectrograph->spectrumChanged( spectrumData );
    }
 
-   auto dt = spectrumData.position - lastPosition;
-   if (dt < 0)
+   return level;
+}
+
+void CEffectSpectrumBar::calculateIntensities( const SpectrumStore &spectrum,
+                                               const std::shared_ptr<const BeatTrack> &,
+                                               std::size_t first,
+                                               std::size_t count,
+                                               float *out,
+                                               State &state )
+{
+   // The index is picked on the cFFTSize live bars, the analysed spectrum
+   // has bins of its own FFT size, so the frequency range of the bar is
+   // taken from them. The spectrograph shows live playback only, it is not
+   // fed from here.
+   const CBandLayout::Band band = CBandLayout::spectrumIndexBand( uint32_t( m_spectrumBarIndex ), spectrum.sampleRate() );
+   const bool hasBin = std::size_t( cFFTSize ) > m_spectrumBarIndex;
+   const CBandLayout layout( { band }, spectrum.binCount(), spectrum.sampleRate() );
+
+   for ( std::size_t i = 0; i < count; ++i )
    {
-       dt=0;
+      auto intensityLevel = 0.0;
+      if ( hasBin )
+      {
+         float value = 0.0f;
+         layout.apply( spectrum.frame( first + i ).data(), &value );
+         intensityLevel = value * m_gain;
+      }
+      out[ i ] = float( follow( state, spectrum.position( first + i ), intensityLevel ) );
    }
-   lastPosition = spectrumData.position;
-
-   auto k = (-1.0 / (1000.0 * ( m_fade < 0.1 ? 0.1 : m_fade )));
-   auto b = 1.0;
-   double y = k * double(dt) + b;
-   double intensityReduction = b - y;
+}
 
-   lastLevel -= intensityReduction;
+int64_t CEffectSpectrumBar::lookbackMs() const
+{
+   return fadeLookbackMs( m_fade );
+}
 
-   if ( lastLevel < intensityLevel && intensityLevel > m_threshold )
+double CEffectSpectrumBar::follow( State& state, uint64_t position, double intensityLevel ) const
+{
+   if ( intensityLevel > 1.0 )
+   {
+      intensityLevel = 1.0;
+   }
+   else if ( intensityLevel < 0.0 )
    {
-       lastLevel = intensityLevel;
+      intensityLevel = 0.0;
    }
 
-   qDebug() << "calculateIntensity";
-
-   if ( nullptr != spectrograph )
+   if ( fadeLevel( state, position, m_fade ) < intensityLevel && intensityLevel > m_threshold )
    {
-      spectrograph->spectrumChanged( spectrumData );
+      state.level = intensityLevel;
    }
 
-   return lastLevel;
+   return state.level;
 }
 
 
@@ -116,6 +144,7 @@ QWidget *CEffectSpectrumBar::buildWidget(QWidget *parent)
 
    QObject::connect( gain, &FloatSliderWidget::valueChanged, [ this ]( double value ){
       m_gain = value;
+      parametersChanged();
       if ( nullptr != spectrograph )
       {
          spectrograph->setGain( m_gain );
@@ -124,6 +153,7 @@ QWidget *CEffectSpectrumBar::buildWidget(QWidget *parent)
 
    QObject::connect( fade, &FloatSliderWidget::valueChanged, [ this ]( double value ){
       m_fade = value;
+      parametersChanged();
       if ( nullptr != spectrograph )
       {
          spectrograph->setFading( m_fade );
@@ -132,6 +162,7 @@ QWidget *CEffectSpectrumBar::buildWidget(QWidget *parent)
 
    QObject::connect( threshold, &FloatSliderWidget::valueChanged, [ this ]( double value ){
       m_threshold = value;
+      parametersChanged();
       if ( nullptr != spectrograph )
       {
          spectrograph->setMinimumLevel( m_threshold );
@@ -161,6 +192,7 @@ QWidget *CEffectSpectrumBar::buildWidget(QWidget *parent)
    QObject::connect( spectrograph, &Spectrograph::selectedBarChanged, [this]( int index )
    {
       this->m_spectrumBarIndex = index;
+      parametersChanged();
    });
 
    spectrograph->setGain( m_gain );
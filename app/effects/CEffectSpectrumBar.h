@@ -21,18 +21,31 @@ public:
 protected:
    virtual QJsonObject toJsonParameters() const override;
    virtual bool parseParameters( const QJsonObject& parameters ) override;
-   virtual double calculateIntensity( const SpectrumData& spectrumData ) override;
+   virtual double calculateIntensity( const SpectrumData& spectrumData, State& state ) override;
+   virtual void calculateIntensities( const SpectrumStore& spectrum,
+                                      const std::shared_ptr<const BeatTrack>& beats,
+                                      std::size_t first,
+                                      std::size_t count,
+                                      float* out,
+                                      State& state ) override;
    virtual QWidget *buildWidget(QWidget *parent) override;
    virtual std::shared_ptr<IEffectGenerator> makeCopy() const override;
 
+public:
+   // The fade of a full level is over after this
+   virtual int64_t lookbackMs() const override;
+
+private:
+
+   // Fades the level of state down to position and raises it to level above the threshold
+   double follow( State& state, uint64_t position, double level ) const;
+
 private:
 
    double m_gain = cDefaultGainValue;
    double m_fade = cDefaultFadeValue;
    double m_threshold = cDefaultThreshholdValue;
    std::size_t m_spectrumBarIndex = 1;
-   int64_t lastPosition = 0;
-   double lastLevel = 0;
    Spectrograph* spectrograph = nullptr;
 };
 
@@ -5,6 +5,7 @@
 #include <cmath>
 
 #include "CEffectWave.h"
+#include "ctrace.h"
 
 const QString cKeyPhaseShift ( "phaseShift" );
 const QString cKeyWaveLength( "waveLength" );
@@ -41,7 +42,7 @@ bool CEffectWave::parseParameters(const QJsonObject &parameters)
    return isOk;
 }
 
-double CEffectWave::calculateIntensity(const SpectrumData &spectrumData)
+double CEffectWave::calculateIntensity(const SpectrumData &spectrumData, State &)
 {
    auto dtMs = spectrumData.position - effectStartPosition();
    if ( dtMs < 0 )
@@ -52,10 +53,33 @@ double CEffectWave::calculateIntensity(const SpectrumData &spectrumData)
       y=0;
    else if (y>1.0)
       y=1.0;
-   qDebug() << "CEffectWave::calculateIntensity(" << dtSec << ") =" << y;
+   TRACE( ETraceCategory::Effect, ETraceEvent::EffectWave, dtSec, y );
    return y;
 }
 
+void CEffectWave::calculateIntensities( const SpectrumStore &spectrum,
+                                        const std::shared_ptr<const BeatTrack> &,
+                                        std::size_t first,
+                                        std::size_t count,
+                                        float *out,
+                                        State & )
+{
+   // All frames are inside the effect, so no frame is before its start
+   const uint64_t start = uint64_t( effectStartPosition() );
+   const uint64_t* positions = spectrum.positions().data() + first;
+
+   for ( std::size_t i = 0; i < count; ++i )
+   {
+      const double dtSec = double( positions[ i ] - start ) / 1000.0;
+      double y = m_waveAmplitudeShift + m_waveGain*sin( m_waveLength*dtSec + m_phaseShift );
+      if (y<0)
+         y=0;
+      else if (y>1.0)
+         y=1.0;
+      out[ i ] = float( y );
+   }
+}
+
 QWidget *CEffectWave::buildWidget(QWidget *parent)
 {
    QWidget* configWidget = new QWidget( parent );
@@ -79,10 +103,10 @@ QWidget *CEffectWave::buildWidget(QWidget *parent)
    vlayout->addWidget( waveAmplitudeShift );
 
 
-   QObject::connect( labelPhaseSlider, &FloatSliderWidget::valueChanged, [ this ]( double value ){ m_phaseShift = value; });
-   QObject::connect( waveLengthSlider, &FloatSliderWidget::valueChanged, [ this ]( double value ){ m_waveLength = value; });
-   QObject::connect( waveGain, &FloatSliderWidget::valueChanged, [ this ]( double value ){ m_waveGain = value; });
-   QObject::connect( waveAmplitudeShift, &FloatSliderWidget::valueChanged, [ this ]( double value ){ m_waveAmplitudeShift = value; });
+   QObject::connect( labelPhaseSlider, &FloatSliderWidget::valueChanged, [ this ]( double value ){ m_phaseShift = value; parametersChanged(); });
+   QObject::connect( waveLengthSlider, &FloatSliderWidget::valueChanged, [ this ]( double value ){ m_waveLength = value; parametersChanged(); });
+   QObject::connect( waveGain, &FloatSliderWidget::valueChanged, [ this ]( double value ){ m_waveGain = value; parametersChanged(); });
+   QObject::connect( waveAmplitudeShift, &FloatSliderWidget::valueChanged, [ this ]( double value ){ m_waveAmplitudeShift = value; parametersChanged(); });
 
 
    configWidget->setLayout( vlayout );
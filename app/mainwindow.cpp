@@ -10,19 +10,17 @@
 #include <QJsonDocument>
 #include <QLabel>
 #include <QScreen>
+#include <QThread>
+#include <QActionGroup>
+#include <QDateTime>
+#include <QSignalBlocker>
 #include "constants.h"
+#include "ctrace.h"
 #include "widgets/LabelEx.h"
 #include "widgets/SliderEx.h"
 #include "widgets/FloatSliderWidget.h"
 
 
-const QString cSequenseConfigurationFileName( "sequenseConfiguration.json" );
-
-const QString cKeyOutputDirectory( "outputDir" );
-const QString cKeyPlayRandom( "isRandomPlay" );
-const QString cKeySequenses( "sequenses" );
-
-
 MainWindow::MainWindow( QWidget *parent )
     : QMainWindow( parent )
     , ui( new Ui::MainWindow )
@@ -32,6 +30,7 @@ MainWindow::MainWindow( QWidget *parent )
     , m_current(  )
     , m_lorCtrl( new CLORSerialCtrl( this ) )
     , m_effectConfiguration( nullptr )
+    , m_generateProgress( nullptr )
 {
     std::srand(std::time(NULL));
 
@@ -50,7 +49,112 @@ MainWindow::MainWindow( QWidget *parent )
     m_spectrograph->show();
 
     load();
-    m_lorCtrl->setPortParams( m_channelConfigurator->commPortName(), m_channelConfigurator->baudRate() );
+
+    auto hopGroup = new QActionGroup( this );
+    auto hopMenu = ui->menuGenerate->addMenu( tr("Analysis hop") );
+    for ( auto hopMs : cAnalysisHopMsOptions )
+    {
+        auto action = hopMenu->addAction( QString::number( hopMs ) + " ms" );
+        action->setCheckable( true );
+        action->setChecked( hopMs == analysisHopMs );
+        hopGroup->addAction( action );
+        connect( action, &QAction::triggered, [this, hopMs](){
+            analysisHopMs = hopMs;
+        });
+    }
+
+    auto fftSizeGroup = new QActionGroup( this );
+    auto fftSizeMenu = ui->menuGenerate->addMenu( tr("FFT size") );
+    for ( auto fftSize : cFFTSizeOptions )
+    {
+        auto action = fftSizeMenu->addAction( QString::number( fftSize ) );
+        action->setCheckable( true );
+        action->setChecked( fftSize == analysisFFTSize );
+        fftSizeGroup->addAction( action );
+        connect( action, &QAction::triggered, [this, fftSize](){
+            analysisFFTSize = fftSize;
+        });
+    }
+
+    auto windowGroup = new QActionGroup( this );
+    auto windowMenu = ui->menuGenerate->addMenu( tr("FFT window") );
+    for ( auto window : { CFFTEngine::EWindow::Hann, CFFTEngine::EWindow::Hamming,
+                          CFFTEngine::EWindow::Blackman, CFFTEngine::EWindow::Rectangular } )
+    {
+        auto action = windowMenu->addAction( CFFTEngine::windowName( window ) );
+        action->setCheckable( true );
+        action->setChecked( window == analysisWindow );
+        windowGroup->addAction( action );
+        connect( action, &QAction::triggered, [this, window](){
+            analysisWindow = window;
+        });
+    }
+
+    auto hysteresisGroup = new QActionGroup( this );
+    auto hysteresisMenu = ui->menuPlay->addMenu( tr("Output hysteresis") );
+    for ( auto hysteresis : cOutputHysteresisOptions )
+    {
+        auto action = hysteresisMenu->addAction( QString::number( hysteresis ) );
+        action->setCheckable( true );
+        action->setChecked( hysteresis == outputHysteresis );
+        hysteresisGroup->addAction( action );
+        connect( action, &QAction::triggered, [this, hysteresis](){
+            outputHysteresis = hysteresis;
+            m_lorCtrl->setDeltaParams( outputHysteresis, outputRefreshMs );
+        });
+    }
+
+    auto refreshGroup = new QActionGroup( this );
+    auto refreshMenu = ui->menuPlay->addMenu( tr("LOR output refresh") );
+    for ( auto refreshMs : cOutputRefreshMsOptions )
+    {
+        auto action = refreshMenu->addAction( QString::number( refreshMs ) + " ms" );
+        action->setCheckable( true );
+        action->setChecked( refreshMs == outputRefreshMs );
+        refreshGroup->addAction( action );
+        connect( action, &QAction::triggered, [this, refreshMs](){
+            outputRefreshMs = refreshMs;
+            m_lorCtrl->setDeltaParams( outputHysteresis, outputRefreshMs );
+        });
+    }
+
+    m_lorCtrl->setPorts( m_channelConfigurator->ports() );
+    m_lorCtrl->setDeltaParams( outputHysteresis, outputRefreshMs );
+
+    // spectrum-cli --replay-output plays the log back without analysis
+    auto recordOutputAction = ui->menuPlay->addAction( tr("Record output...") );
+    recordOutputAction->setCheckable( true );
+    connect( recordOutputAction, &QAction::toggled, [this, recordOutputAction]( bool isChecked ){
+        if ( !isChecked )
+        {
+            m_lorCtrl->setLog( QString() );
+            ui->statusbar->showMessage( tr("Output recording stopped") );
+            return;
+        }
+
+        const QString fileName = QFileDialog::getSaveFileName( this, tr("Record output"),
+                                                               QDateTime::currentDateTime().toString( "'output-'yyyyMMdd-hhmmss'.rlo'" ),
+                                                               tr("Output log (*.rlo)") );
+        if ( fileName.isEmpty() )
+        {
+            const QSignalBlocker blocker( recordOutputAction );
+            recordOutputAction->setChecked( false );
+            return;
+        }
+
+        m_lorCtrl->setLog( fileName );
+        ui->statusbar->showMessage( tr("Recording output to %1").arg( fileName ) );
+    });
+
+    // spectrum-cli --trace-timeline turns the dump into a timeline
+    auto dumpTraceAction = ui->menuWindow->addAction( tr("Dump trace") );
+    connect( dumpTraceAction, &QAction::triggered, [this](){
+        const QString fileName = QDateTime::currentDateTime().toString( "'trace-'yyyyMMdd-hhmmss'.bin'" );
+        if ( CTrace::dump( fileName ) )
+        {
+            ui->statusbar->showMessage( tr("Trace written to %1").arg( fileName ) );
+        }
+    });
 
     move( QGuiApplication::primaryScreen()->geometry().topLeft() );
 
@@ -103,6 +207,11 @@ void MainWindow::persist()
     QJsonObject config;
     config[ cKeyOutputDirectory ] = destinationFolder;
     config[ cKeyPlayRandom ] = isPlayRandomEnabled;
+    config[ cKeyAnalysisHopMs ] = static_cast<int>( analysisHopMs );
+    config[ cKeyAnalysisFFTSize ] = static_cast<int>( analysisFFTSize );
+    config[ cKeyAnalysisWindow ] = CFFTEngine::windowName( analysisWindow );
+    config[ cKeyOutputHysteresis ] = static_cast<int>( outputHysteresis );
+    config[ cKeyOutputRefreshMs ] = static_cast<int>( outputRefreshMs );
     config[ cKeySequenses ] = sequenseArray;
 
     persistFile.write( QJsonDocument(config).toJson() );
@@ -151,6 +260,66 @@ void MainWindow::load()
             }
         }
 
+        if ( json.contains( cKeyAnalysisHopMs ) )
+        {
+            int hopMs = json[ cKeyAnalysisHopMs ].toInt( 0 );
+            if ( hopMs <= 0 )
+            {
+                qWarning() << "Analysis hop is not a positive number: " << cKeyAnalysisHopMs ;
+            }
+            else
+            {
+                analysisHopMs = hopMs;
+            }
+        }
+
+        if ( json.contains( cKeyAnalysisFFTSize ) )
+        {
+            int fftSize = json[ cKeyAnalysisFFTSize ].toInt( 0 );
+            if ( fftSize <= 0 || !CFFTEngine::isValidSize( fftSize ) )
+            {
+                qWarning() << "FFT size is not a power of two in supported range: " << cKeyAnalysisFFTSize ;
+            }
+            else
+            {
+                analysisFFTSize = fftSize;
+            }
+        }
+
+        if ( json.contains( cKeyAnalysisWindow ) )
+        {
+            if ( !CFFTEngine::windowFromName( json[ cKeyAnalysisWindow ].toString().toStdString(), analysisWindow ) )
+            {
+                qWarning() << "Unknown FFT window: " << cKeyAnalysisWindow ;
+            }
+        }
+
+        if ( json.contains( cKeyOutputHysteresis ) )
+        {
+            int hysteresis = json[ cKeyOutputHysteresis ].toInt( -1 );
+            if ( hysteresis < 0 )
+            {
+                qWarning() << "Output hysteresis is not a number: " << cKeyOutputHysteresis ;
+            }
+            else
+            {
+                outputHysteresis = hysteresis;
+            }
+        }
+
+        if ( json.contains( cKeyOutputRefreshMs ) )
+        {
+            int refreshMs = json[ cKeyOutputRefreshMs ].toInt( 0 );
+            if ( refreshMs <= 0 )
+            {
+                qWarning() << "Output refresh is not a positive number: " << cKeyOutputRefreshMs ;
+            }
+            else
+            {
+                outputRefreshMs = refreshMs;
+            }
+        }
+
         if (json.contains( cKeySequenses ))
         {
             QJsonArray seqJson( json[ cKeySequenses ].toArray() );
@@ -223,6 +392,8 @@ void MainWindow::sequenseDeleted( std::weak_ptr<CLightSequence> thisObject)
         m_current.reset();
     }
 
+    sequenseGenerationFinished( thisObject, false );
+
     sequensePlayStarted( m_current );
 
 }
@@ -300,6 +471,15 @@ void MainWindow::sequensePlayStarted(std::weak_ptr<CLightSequence> thisObject)
                                                      m_spectrograph, &Spectrograph::spectrumChanged) ),
                 [](QMetaObject::Connection* con){ disconnect(*con); delete con; } );
 
+    // Edits of the table reach the live output
+    auto configurationChanged = [ thisObject ]()
+    {
+        if ( auto sequense = thisObject.lock() )
+        {
+            sequense->notifyConfigurationChanged();
+        }
+    };
+
     ui->tableWidget_2->setRowCount( m_channelConfigurator->channels().size() );
     for ( std::size_t i = 0; i < m_channelConfigurator->channels().size(); ++i )
     {
@@ -315,14 +495,15 @@ void MainWindow::sequensePlayStarted(std::weak_ptr<CLightSequence> thisObject)
         }
         auto label = new LabelEx(labelStr);
 
-        auto widgetPressed = [this, channelConfiguration, &channel, label]()
+        auto widgetPressed = [this, channelConfiguration, configurationChanged, &channel, label]()
         {
             qDebug() << "widgetPressed " << channelConfiguration->channelUuid;
 
-            auto setSpectrumIndex = [ channelConfiguration ]( int index )
+            auto setSpectrumIndex = [ channelConfiguration, configurationChanged ]( int index )
             {
                 qDebug() << channelConfiguration->channelUuid << "  index:" << index;
                 channelConfiguration->setSpectrumIndex( index );
+                configurationChanged();
             };
 
             m_spectrumSpectrumIndexSelectedConnection = std::shared_ptr<QMetaObject::Connection>(
@@ -332,10 +513,12 @@ void MainWindow::sequensePlayStarted(std::weak_ptr<CLightSequence> thisObject)
             if ( channelConfiguration->isSpectrumIndexSet() )
             {
                 m_spectrograph->setBarSelected( *(channelConfiguration->spectrumIndex) );
+                m_spectrograph->setBand( CBandLayout::Band() );
             }
             else
             {
                 m_spectrograph->setBarSelected( channel.spectrumIndex );
+                m_spectrograph->setBand( channel.band );
             }
 
             if ( channelConfiguration->isGainSet() )
@@ -380,10 +563,11 @@ void MainWindow::sequensePlayStarted(std::weak_ptr<CLightSequence> thisObject)
         auto resetFadeTriggered = std::make_shared<bool>(false);
         auto gainSlider = new FloatSliderWidget( cMaxGainValue, cMinGainValue,
                                                  channelConfiguration->isGainSet() ? (*channelConfiguration->gain) : channel.gain );
-        connect(gainSlider, &FloatSliderWidget::valueChanged, [resetGainTriggered, channelConfiguration, widgetPressed, this]( double value ){
+        connect(gainSlider, &FloatSliderWidget::valueChanged, [resetGainTriggered, channelConfiguration, configurationChanged, widgetPressed, this]( double value ){
             if ( ! (*resetGainTriggered) )
             {
                 channelConfiguration->setGain( value );
+                configurationChanged();
             }
             else
             {
@@ -398,8 +582,9 @@ void MainWindow::sequensePlayStarted(std::weak_ptr<CLightSequence> thisObject)
 
 
         auto threshHold = new FloatSliderWidget( cMaxThreshholdValue, cMinThreshholdValue, channelConfiguration->minimumLevel );
-        connect( threshHold, &FloatSliderWidget::valueChanged, [channelConfiguration, widgetPressed, this]( double value ){
+        connect( threshHold, &FloatSliderWidget::valueChanged, [channelConfiguration, configurationChanged, widgetPressed, this]( double value ){
             channelConfiguration->minimumLevel =  value;
+            configurationChanged();
             m_spectrograph->setMinimumLevel( channelConfiguration->minimumLevel );
             widgetPressed();
         });
@@ -409,10 +594,11 @@ void MainWindow::sequensePlayStarted(std::weak_ptr<CLightSequence> thisObject)
 
         auto fading = new FloatSliderWidget( cMaxFadeValue, cMinFadeValue,
                                              channelConfiguration->isFadeSet() ? (*channelConfiguration->fade) : channel.fade );
-        connect(fading, &FloatSliderWidget::valueChanged, [ resetFadeTriggered, channelConfiguration, widgetPressed, this]( int value ){
+        connect(fading, &FloatSliderWidget::valueChanged, [ resetFadeTriggered, channelConfiguration, configurationChanged, widgetPressed, this]( int value ){
             if ( ! (*resetFadeTriggered) )
             {
                 channelConfiguration->setFade( value );
+                configurationChanged();
             }
             else
             {
@@ -432,6 +618,7 @@ void MainWindow::sequensePlayStarted(std::weak_ptr<CLightSequence> thisObject)
                 channelConfiguration->gain = nullptr;
                 channelConfiguration->fade = nullptr;
                 channelConfiguration->spectrumIndex = nullptr;
+                configurationChanged();
                 *resetGainTriggered = true;
                 *resetFadeTriggered = true;
                 fading->setValue(channel.fade);
@@ -493,7 +680,7 @@ void MainWindow::playNext()
    auto current = m_current.lock();
    if ( nullptr != current )
    {
-      if ( QBassAudioFile::EState::Play == current->getAudioFile()->state() && !current->isGenerateStarted() )
+      if ( QBassAudioFile::EState::Play == current->getAudioFile()->state() )
       {
          return;
       }
@@ -504,10 +691,7 @@ void MainWindow::playNext()
 
    for ( std::size_t i = 0;  i < m_sequences.size(); ++i )
    {
-      if ( !m_sequences[i]->isGenerateStarted() )
-      {
-         indexList.push_back( i );
-      }
+      indexList.push_back( i );
    }
 
    if ( isPlayRandomEnabled )
@@ -638,7 +822,7 @@ void MainWindow::channelConfigurationChanged()
       channel->channelConfigurationUpdated();
    }
    sequensePlayStarted( m_current );
-   m_lorCtrl->setPortParams( m_channelConfigurator->commPortName(), m_channelConfigurator->baudRate() );
+   m_lorCtrl->setPorts( m_channelConfigurator->ports() );
 }
 
 void MainWindow::adjustSequense( std::shared_ptr<CLightSequence> &seq )
@@ -661,12 +845,10 @@ void MainWindow::adjustSequense( std::shared_ptr<CLightSequence> &seq )
             playNext();
         });
 
-        connect( seq.get(), &CLightSequence::generationStarted,    [this](std::weak_ptr<CLightSequence> thisObject)
+        connect( seq.get(), &CLightSequence::generationFinished, this, &MainWindow::sequenseGenerationFinished );
+        connect( seq.get(), &CLightSequence::generationStoped,   [this](std::weak_ptr<CLightSequence> thisObject)
         {
-            if ( m_current.lock() == thisObject.lock())
-            {
-               playNext();
-            }
+            sequenseGenerationFinished( thisObject, false );
         });
     }
 }
@@ -731,3 +913,94 @@ void MainWindow::startShowTriggered(bool active)
        isShowStarted = active;
     }
 }
+
+void MainWindow::on_actionGenerate_all_triggered()
+{
+    if ( nullptr != m_generateProgress )
+    {
+        m_generateProgress->show();
+        return;
+    }
+
+    m_generateBatch.clear();
+    m_generateFailed = 0;
+
+    std::vector<std::shared_ptr<CLightSequence>> toStart;
+    for ( const auto& seq : m_sequences )
+    {
+        if ( !seq->isGenerateStarted() )
+        {
+            toStart.push_back( seq );
+            m_generateBatch.push_back( seq );
+        }
+    }
+
+    if ( toStart.empty() )
+    {
+        return;
+    }
+
+    qDebug() << __FUNCTION__ << "sequenses:" << toStart.size() << "threads:" << QThread::idealThreadCount();
+
+    m_generateProgress = new QProgressDialog( tr("Generating sequenses..."), tr("Cancel"), 0, toStart.size(), this );
+    m_generateProgress->setWindowTitle( tr("Generate all") );
+    m_generateProgress->setMinimumDuration( 0 );
+    m_generateProgress->setAutoClose( false );
+    m_generateProgress->setAutoReset( false );
+    m_generateProgress->setValue( 0 );
+    connect( m_generateProgress, &QProgressDialog::canceled, this, &MainWindow::stopGenerateAll );
+
+    // Every sequense is queued on the global thread pool, it runs as many
+    // of them at once as there are cores
+    for ( auto& seq : toStart )
+    {
+        seq->startGeneration();
+    }
+}
+
+void MainWindow::sequenseGenerationFinished( std::weak_ptr<CLightSequence> thisObject, bool isSuccess )
+{
+    auto sequense = thisObject.lock();
+    auto it = std::find_if( m_generateBatch.begin(), m_generateBatch.end(), [&sequense]( const std::weak_ptr<CLightSequence>& item ){
+        return item.lock() == sequense;
+    });
+
+    if ( nullptr == sequense || m_generateBatch.end() == it || nullptr == m_generateProgress )
+    {
+        return;
+    }
+
+    m_generateBatch.erase( it );
+    if ( !isSuccess )
+    {
+        ++m_generateFailed;
+    }
+
+    const int done = m_generateProgress->maximum() - int( m_generateBatch.size() );
+    m_generateProgress->setValue( done );
+    m_generateProgress->setLabelText( tr("Generated %1 of %2").arg( done ).arg( m_generateProgress->maximum() ) );
+
+    if ( m_generateBatch.empty() )
+    {
+        ui->statusbar->showMessage( tr("Generate all: %1 done, %2 failed or canceled")
+                                    .arg( m_generateProgress->maximum() - int( m_generateFailed ) )
+                                    .arg( m_generateFailed ) );
+        m_generateProgress->deleteLater();
+        m_generateProgress = nullptr;
+    }
+}
+
+void MainWindow::stopGenerateAll()
+{
+    // stopGeneration() reports back through generationStoped, which
+    // removes the sequense from the batch, so iterate over a copy
+    auto batch = m_generateBatch;
+    for ( auto& item : batch )
+    {
+        auto sequense = item.lock();
+        if ( nullptr != sequense )
+        {
+            sequense->stopGeneration();
+        }
+    }
+}
@@ -2,6 +2,7 @@
 #define MAINWINDOW_H
 
 #include <QMainWindow>
+#include <QProgressDialog>
 #include "spectrograph.h"
 #include "channelconfigurator.h"
 #include "CConfiguration.h"
@@ -54,6 +55,8 @@ private slots:
 
     void on_actionEffect_editor_triggered(bool checked);
 
+    void on_actionGenerate_all_triggered();
+
 private:
 
     void startShowTriggered(bool active);
@@ -76,6 +79,10 @@ private:
 
     void playNext();
 
+    void sequenseGenerationFinished( std::weak_ptr<CLightSequence> thisObject, bool isSuccess );
+
+    void stopGenerateAll();
+
 protected:
 
     virtual void closeEvent(QCloseEvent *) override;
@@ -90,6 +97,9 @@ private:
     std::weak_ptr<CLightSequence>  m_current;
     CLORSerialCtrl*                m_lorCtrl;
     CEffectEditorWidget*           m_effectConfiguration;
+    QProgressDialog*               m_generateProgress;
+    std::list<std::weak_ptr<CLightSequence>> m_generateBatch;
+    uint32_t                       m_generateFailed = 0;
 
     bool isShowStarted = false;
     bool isRepeat = false;
@@ -1,26 +1,21 @@
 #include "qbassaudiofile.h"
 #include <QDebug>
 #include <QFile>
+#include "constants.h"
 
 
-constexpr uint32_t cFFTSize = 128;
-
 QBassAudioFile::QBassAudioFile()
     : m_fileName()
-    , m_spectrumData()
     , m_timer( new QTimer(this) )
     , m_stream( 0 )
     , m_state( EState::Idle )
+    , m_sampleRate( 0 )
 {
     connect( m_timer, &QTimer::timeout, [this]() {
-        if ( 0 != m_stream )
+        SpectrumData spectrum;
+        if ( sample( m_stream, m_sampleRate, spectrum ) )
         {
-            auto pos = position();
-            auto spectrum = std::make_shared<SpectrumData>( pos, std::vector<float>( cFFTSize ) );
-            BASS_ChannelGetData( m_stream, spectrum->spectrum.data(), BASS_DATA_FFT256 );
-            m_spectrumData.push_back(spectrum);
-
-            emit positionChanged(*spectrum);
+            emit positionChanged(spectrum);
         }
     });
 
@@ -161,6 +156,28 @@ uint64_t QBassAudioFile::position() const
     }
 }
 
+bool QBassAudioFile::sample( HSTREAM stream, uint32_t sampleRate, SpectrumData &spectrum )
+{
+    if ( 0 == stream )
+    {
+        return false;
+    }
+
+    auto byte_pos = BASS_ChannelGetPosition( stream, BASS_POS_BYTE );
+    if ( QWORD(-1) == byte_pos )
+    {
+        return false;
+    }
+
+    spectrum.position = static_cast<uint64_t>( BASS_ChannelBytes2Seconds( stream, byte_pos ) * 1000 );
+    spectrum.spectrum.assign( cFFTSize, 0.0f );
+    spectrum.sampleRate = sampleRate;
+
+    // Live preview samples the playing stream, generation uses CFFTEngine
+    BASS_ChannelGetData( stream, spectrum.spectrum.data(), BASS_DATA_FFT256 );
+    return true;
+}
+
 uint64_t QBassAudioFile::duration() const
 {
     if ( 0 != m_stream )
@@ -180,7 +197,7 @@ void QBassAudioFile::setFileName(const std::string &fileName)
     {
         if ( QFile::exists(fileName.c_str()) )
         {
-            resetFFTData();
+            stop();
             m_fileName = fileName;
 
             if ( 0 != m_stream )
@@ -196,6 +213,9 @@ void QBassAudioFile::setFileName(const std::string &fileName)
             else
             {
                BASS_ChannelSetSync( m_stream, BASS_SYNC_END, 0, QBassAudioFile::bassStreamFinishedSyncProc, this );
+
+               BASS_CHANNELINFO info;
+               m_sampleRate = BASS_ChannelGetInfo( m_stream, &info ) ? info.freq : 0;
             }
         }
         else
@@ -210,13 +230,6 @@ void QBassAudioFile::setFileName(const std::string &fileName)
     qDebug() << "m_stream:" << m_stream;
 }
 
-void QBassAudioFile::resetFFTData()
-{
-    stop();
-    m_spectrumData.clear();
-    setPosition(0);
-}
-
 float QBassAudioFile::getVolume() const
 {
    float volume = 0.0f;
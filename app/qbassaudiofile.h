@@ -32,16 +32,18 @@ public:
     void setFileName( const std::string& fileName );
     const std::string& fileName() const { return m_fileName; }
 
-    const std::list< std::shared_ptr<SpectrumData> >& getSpectrum() const
-    { return m_spectrumData; }
-
-    void resetFFTData();
-
     float getVolume() const;
     void setVolume(const float vol ) const;
 
     const EState& state() const { return m_state; }
 
+    // BASS handle of the playing stream, BASS calls on it are thread safe
+    HSTREAM stream() const { return m_stream; }
+    uint32_t sampleRate() const { return m_sampleRate; }
+
+    // Position and BASS_DATA_FFT256 spectrum of a stream, callable from any thread
+    static bool sample( HSTREAM stream, uint32_t sampleRate, SpectrumData& spectrum );
+
 
 Q_SIGNALS:
     void playStarted();
@@ -57,10 +59,10 @@ private:
 private:
 
     std::string m_fileName;
-    std::list< std::shared_ptr<SpectrumData> > m_spectrumData;
     QTimer * m_timer;
     HSTREAM m_stream;
     EState m_state;
+    uint32_t m_sampleRate;
 
 };
 
@@ -49,6 +49,8 @@
 ****************************************************************************/
 
 #include "spectrograph.h"
+#include "constants.h"
+#include "ctrace.h"
 #include <QDebug>
 #include <QMouseEvent>
 #include <QPainter>
@@ -80,11 +82,39 @@ void Spectrograph::paintEvent(QPaintEvent *event)
 
     const int numBars = m_spectrum.spectrum.size();
 
+    const bool isBandSelected = m_band.isValid() && numBars;
+    if ( isBandSelected
+         && ( m_bandLayout.bands().empty()
+              || m_bandLayout.bands().front() != m_band
+              || m_bandLayout.binCount() != uint32_t( numBars )
+              || m_bandLayout.sampleRate() != m_spectrum.sampleRate ) )
+    {
+        m_bandLayout = CBandLayout( { m_band }, numBars, m_spectrum.sampleRate );
+    }
+
     // Highlight region of selected bar
-    if (m_barSelected != NullIndex && numBars) {
+    if ((m_barSelected != NullIndex || isBandSelected) && numBars) {
         QRect regionRect = rect();
-        regionRect.setLeft(m_barSelected * rect().width() / numBars);
-        regionRect.setWidth(rect().width() / numBars);
+        qreal value = 0.0;
+        if ( isBandSelected )
+        {
+            // Bars covered by the frequency range
+            const double binHz = double( m_spectrum.sampleRate ? m_spectrum.sampleRate : cDefaultSampleRate ) / ( 2.0 * numBars );
+            const int firstBar = qBound( 0, int( m_band.lowHz / binHz + 0.5 ), numBars - 1 );
+            const int lastBar = qBound( firstBar, int( m_band.highHz / binHz + 0.5 ), numBars - 1 );
+            regionRect.setLeft( firstBar * rect().width() / numBars );
+            regionRect.setWidth( ( lastBar - firstBar + 1 ) * rect().width() / numBars );
+
+            float bandValue = 0.0f;
+            m_bandLayout.apply( m_spectrum.spectrum.data(), &bandValue );
+            value = bandValue * m_gain;
+        }
+        else
+        {
+            regionRect.setLeft(m_barSelected * rect().width() / numBars);
+            regionRect.setWidth(rect().width() / numBars);
+            value = m_spectrum.spectrum[m_barSelected] * m_gain;
+        }
         painter.setBrush(Qt::DiagCrossPattern);
         painter.fillRect(regionRect, QColor(202, 202, 64));
 
@@ -99,8 +129,6 @@ void Spectrograph::paintEvent(QPaintEvent *event)
         m_current_value -= heightReduction;
 
 
-        qreal value = m_spectrum.spectrum[m_barSelected] * m_gain;
-
         if ( value > m_current_value )
         {
             m_current_value = value;
@@ -121,7 +149,7 @@ void Spectrograph::paintEvent(QPaintEvent *event)
             painter.fillRect(regionRect, QColorConstants::Magenta);
         }
 
-        qDebug() << "CTRL fade:"<<m_fading << "gain:" << m_gain << "spectrumIndex:" << m_barSelected << "Intensity:" << m_current_value ;
+        TRACE( ETraceCategory::Spectrograph, ETraceEvent::SpectrographBar, m_barSelected, m_current_value );
 
 
         painter.setBrush(Qt::NoBrush);
@@ -240,6 +268,7 @@ void Spectrograph::selectBar(int index)
     emit selectedBarChanged(index);
 
     m_barSelected = index;
+    m_band = CBandLayout::Band();
     update();
 }
 
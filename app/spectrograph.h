@@ -3,6 +3,7 @@
 #define SPECTROGRAPH_H
 
 #include "qbassaudiofile.h"
+#include "cbandlayout.h"
 
 #include <QWidget>
 
@@ -38,6 +39,9 @@ public:
     void setMinimumLevel( double level ) { m_minimumLevel = level; }
     void setFading( double fadeDuration );
 
+    // Frequency range of the selected channel, the level meter shows it instead of the selected bar
+    void setBand( const CBandLayout::Band& band ) { m_band = band; }
+
 signals:
     void selectedBarChanged(int index);
 
@@ -55,6 +59,8 @@ private:
     double              m_gain;
     double              m_minimumLevel;
     double              m_fading;
+    CBandLayout::Band   m_band;
+    CBandLayout         m_bandLayout;
 
     uint64_t            m_prev_position = 0;
     float               m_current_value = 0.0f;
@@ -0,0 +1,254 @@
+#include "CEffectIntervalIndex.h"
+#include <algorithm>
+#include <functional>
+#include <limits>
+
+// Entries a frame may pass by walking the cursor, a longer step is a seek
+constexpr std::size_t cMaxCursorSteps = 16;
+
+void CEffectIntervalIndex::insert( IEffectGenerator* effect )
+{
+   const int64_t start = effect->effectStartPosition();
+   const Entry entry{ start, start + effect->effectDuration(), effect, IEffectGenerator::State(), false };
+
+   auto it = std::upper_bound( m_entries.begin(), m_entries.end(), start, []( int64_t position, const Entry& e )
+   {
+      return position < e.start;
+   } );
+   const std::size_t index = std::size_t( it - m_entries.begin() );
+   m_entries.insert( it, entry );
+   m_isTreeDirty = true;
+
+   for ( auto& i : m_running )
+   {
+      if ( i >= index )
+      {
+         ++i;
+      }
+   }
+
+   // Started already, the cursor is past it
+   if ( m_isCursorValid && start <= m_position )
+   {
+      ++m_cursor;
+      if ( m_entries[ index ].end >= m_position )
+      {
+         m_entries[ index ].isRunning = true;
+         m_running.push_back( index );
+      }
+   }
+}
+
+bool CEffectIntervalIndex::remove( IEffectGenerator* effect )
+{
+   auto it = std::find_if( m_entries.begin(), m_entries.end(), [ effect ]( const Entry& e )
+   {
+      return e.effect == effect;
+   } );
+
+   if ( m_entries.end() == it )
+   {
+      return false;
+   }
+
+   const std::size_t index = std::size_t( it - m_entries.begin() );
+   m_running.erase( std::remove( m_running.begin(), m_running.end(), index ), m_running.end() );
+   for ( auto& i : m_running )
+   {
+      if ( i > index )
+      {
+         --i;
+      }
+   }
+
+   if ( m_isCursorValid && index < m_cursor )
+   {
+      --m_cursor;
+   }
+
+   m_entries.erase( it );
+   m_isTreeDirty = true;
+   return true;
+}
+
+void CEffectIntervalIndex::clear()
+{
+   m_entries.clear();
+   m_maxEnd.clear();
+   m_running.clear();
+   m_active.clear();
+   m_isTreeDirty = false;
+   m_isCursorValid = false;
+}
+
+void CEffectIntervalIndex::assign( const std::vector<IEffectGenerator*>& effects )
+{
+   std::vector<IEffectGenerator*> current;
+   current.reserve( m_entries.size() );
+   for ( const auto& entry : m_entries )
+   {
+      current.push_back( entry.effect );
+   }
+
+   std::vector<IEffectGenerator*> wanted( effects );
+   std::sort( current.begin(), current.end(), std::less<IEffectGenerator*>() );
+   std::sort( wanted.begin(), wanted.end(), std::less<IEffectGenerator*>() );
+   wanted.erase( std::unique( wanted.begin(), wanted.end() ), wanted.end() );
+
+   std::vector<IEffectGenerator*> removed;
+   std::set_difference( current.begin(), current.end(), wanted.begin(), wanted.end(),
+                        std::back_inserter( removed ), std::less<IEffectGenerator*>() );
+   std::vector<IEffectGenerator*> added;
+   std::set_difference( wanted.begin(), wanted.end(), current.begin(), current.end(),
+                        std::back_inserter( added ), std::less<IEffectGenerator*>() );
+
+   for ( auto effect : removed )
+   {
+      remove( effect );
+   }
+   for ( auto effect : added )
+   {
+      insert( effect );
+   }
+}
+
+const std::vector<CEffectIntervalIndex::Active>& CEffectIntervalIndex::active( int64_t position )
+{
+   const bool isBackwards = m_isCursorValid && position < m_position;
+   bool isSeek = !m_isCursorValid || isBackwards;
+
+   if ( !isSeek )
+   {
+      // Walk the cursor over the effects started since the last frame
+      std::size_t cursor = m_cursor;
+      while ( cursor < m_entries.size() && m_entries[ cursor ].start <= position )
+      {
+         if ( cursor - m_cursor >= cMaxCursorSteps )
+         {
+            isSeek = true;
+            break;
+         }
+         ++cursor;
+      }
+
+      if ( !isSeek )
+      {
+         m_running.erase( std::remove_if( m_running.begin(), m_running.end(), [ this, position ]( std::size_t i )
+         {
+            if ( m_entries[ i ].end < position )
+            {
+               m_entries[ i ].isRunning = false;
+               return true;
+            }
+            return false;
+         } ), m_running.end() );
+
+         for ( ; m_cursor < cursor; ++m_cursor )
+         {
+            Entry& entry = m_entries[ m_cursor ];
+            if ( entry.end >= position )
+            {
+               entry.state = IEffectGenerator::State();
+               entry.isRunning = true;
+               m_running.push_back( m_cursor );
+            }
+         }
+      }
+   }
+
+   if ( isSeek )
+   {
+      // Effects running before and after a jump ahead go on, everything else starts again
+      update();
+      m_found.clear();
+      query( 0, m_entries.size(), position, m_found );
+      for ( auto i : m_found )
+      {
+         if ( isBackwards || !m_entries[ i ].isRunning )
+         {
+            m_entries[ i ].state = IEffectGenerator::State();
+         }
+      }
+      for ( auto i : m_running )
+      {
+         m_entries[ i ].isRunning = false;
+      }
+      for ( auto i : m_found )
+      {
+         m_entries[ i ].isRunning = true;
+      }
+      m_running.swap( m_found );
+      m_cursor = upperBound( position );
+      m_isCursorValid = true;
+   }
+
+   m_position = position;
+
+   m_active.clear();
+   for ( auto i : m_running )
+   {
+      m_active.push_back( { m_entries[ i ].effect, &m_entries[ i ].state } );
+   }
+   return m_active;
+}
+
+void CEffectIntervalIndex::update()
+{
+   if ( m_isTreeDirty )
+   {
+      m_maxEnd.resize( m_entries.size() );
+      build( 0, m_entries.size() );
+      m_isTreeDirty = false;
+   }
+}
+
+int64_t CEffectIntervalIndex::build( std::size_t begin, std::size_t end )
+{
+   if ( begin >= end )
+   {
+      return std::numeric_limits<int64_t>::min();
+   }
+
+   const std::size_t middle = begin + ( end - begin ) / 2;
+   const int64_t maxEnd = std::max( { m_entries[ middle ].end, build( begin, middle ), build( middle + 1, end ) } );
+   m_maxEnd[ middle ] = maxEnd;
+   return maxEnd;
+}
+
+void CEffectIntervalIndex::query( std::size_t begin, std::size_t end, int64_t position, std::vector<std::size_t>& found )
+{
+   if ( begin >= end )
+   {
+      return;
+   }
+
+   const std::size_t middle = begin + ( end - begin ) / 2;
+   if ( m_maxEnd[ middle ] < position )
+   {
+      return;
+   }
+
+   query( begin, middle, position, found );
+
+   // Everything right of middle starts later still
+   if ( m_entries[ middle ].start > position )
+   {
+      return;
+   }
+
+   if ( m_entries[ middle ].end >= position )
+   {
+      found.push_back( middle );
+   }
+
+   query( middle + 1, end, position, found );
+}
+
+std::size_t CEffectIntervalIndex::upperBound( int64_t position ) const
+{
+   auto it = std::upper_bound( m_entries.begin(), m_entries.end(), position, []( int64_t p, const Entry& e )
+   {
+      return p < e.start;
+   } );
+   return std::size_t( it - m_entries.begin() );
+}
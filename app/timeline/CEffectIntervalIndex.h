@@ -0,0 +1,86 @@
+#ifndef CEFFECTINTERVALINDEX_H
+#define CEFFECTINTERVALINDEX_H
+
+#include <cstdint>
+#include <vector>
+#include "IEffectGenerator.h"
+
+/**
+ * Timeline effects of one channel ordered by start position, to find the
+ * ones active at a position without asking every effect.
+ *
+ * Effects are kept sorted by start with the latest end of every subtree of
+ * an implicit binary tree over them, a query at any position costs
+ * O(log n + k) for k active effects. Playback moves forward frame by frame,
+ * so active() keeps a cursor to the first effect not started yet and the
+ * effects that are running; a frame only looks at the effects starting or
+ * ending since the last one. Going backwards or jumping far ahead queries
+ * the tree instead.
+ *
+ * The index is the render of its effects and holds their State. An effect
+ * starts with a fresh one whenever it becomes active, going backwards
+ * starts all of them again. Inserting or removing an effect leaves the
+ * others running.
+ *
+ * Start and duration are read once when an effect is inserted, an effect
+ * that moves has to be removed and inserted again. An effect is active from
+ * its start up to and including start plus duration, as
+ * IEffectGenerator::isPositionActive().
+ */
+class CEffectIntervalIndex
+{
+public:
+
+   struct Active
+   {
+      IEffectGenerator* effect;
+      IEffectGenerator::State* state;
+   };
+
+   std::size_t size() const { return m_entries.size(); }
+   bool empty() const { return m_entries.empty(); }
+
+   void insert( IEffectGenerator* effect );
+   bool remove( IEffectGenerator* effect );
+   void clear();
+
+   // Removes what is not in effects and inserts what is missing
+   void assign( const std::vector<IEffectGenerator*>& effects );
+
+   // Effects active at position, valid up to the next call
+   const std::vector<Active>& active( int64_t position );
+
+private:
+
+   struct Entry
+   {
+      int64_t start;
+      int64_t end;
+      IEffectGenerator* effect;
+      IEffectGenerator::State state;
+      bool isRunning;
+   };
+
+   void update();
+   int64_t build( std::size_t begin, std::size_t end );
+   void query( std::size_t begin, std::size_t end, int64_t position, std::vector<std::size_t>& found );
+   std::size_t upperBound( int64_t position ) const;
+
+private:
+
+   // Ordered by start, m_maxEnd[ i ] is the latest end in the subtree
+   // rooted at i, the subtree of [ begin, end ) is rooted at its middle
+   std::vector<Entry> m_entries;
+   std::vector<int64_t> m_maxEnd;
+   bool m_isTreeDirty = false;
+
+   // Sequential playback, m_cursor is the first entry starting after m_position
+   bool m_isCursorValid = false;
+   int64_t m_position = 0;
+   std::size_t m_cursor = 0;
+   std::vector<std::size_t> m_running;
+   std::vector<std::size_t> m_found;
+   std::vector<Active> m_active;
+};
+
+#endif // CEFFECTINTERVALINDEX_H
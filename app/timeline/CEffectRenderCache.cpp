@@ -0,0 +1,206 @@
+#include "CEffectRenderCache.h"
+#include "IEffectGenerator.h"
+#include <algorithm>
+
+namespace
+{
+
+std::size_t lowerBound( const SpectrumStore& spectrum, int64_t position )
+{
+   const auto positions = spectrum.positions();
+   auto it = std::lower_bound( positions.begin(), positions.end(), position, []( uint64_t p, int64_t value )
+   {
+      return int64_t( p ) < value;
+   } );
+   return std::size_t( it - positions.begin() );
+}
+
+std::size_t upperBound( const SpectrumStore& spectrum, int64_t position )
+{
+   const auto positions = spectrum.positions();
+   auto it = std::upper_bound( positions.begin(), positions.end(), position, []( int64_t value, uint64_t p )
+   {
+      return value < int64_t( p );
+   } );
+   return std::size_t( it - positions.begin() );
+}
+
+// Frames of the effect placed as it is now, all of them out of date
+std::shared_ptr<CEffectRenderCache::Rendered> layout( const IEffectGenerator& effect,
+                                                      const std::shared_ptr<const SpectrumStore>& spectrum,
+                                                      const std::shared_ptr<const BeatTrack>& beats )
+{
+   auto rendered = std::make_shared<CEffectRenderCache::Rendered>();
+   rendered->spectrum = spectrum;
+   rendered->beats = beats;
+   rendered->start = effect.effectStartPosition();
+   rendered->duration = effect.effectDuration();
+
+   // Active frames, as IEffectGenerator::isPositionActive()
+   const std::size_t first = lowerBound( *spectrum, rendered->start );
+   const std::size_t end = std::max( first, upperBound( *spectrum, rendered->start + rendered->duration ) );
+   rendered->first = first;
+   rendered->values.assign( end - first, 0.0f );
+   rendered->isValid.assign( end - first, 0 );
+   rendered->invalidCount = end - first;
+   return rendered;
+}
+
+void markInvalid( CEffectRenderCache::Rendered& rendered, int64_t from, int64_t to )
+{
+   const std::size_t count = rendered.values.size();
+   const std::size_t begin = std::max( lowerBound( *rendered.spectrum, from ), rendered.first ) - rendered.first;
+   const std::size_t end = std::max( std::min( upperBound( *rendered.spectrum, to ), rendered.first + count ), rendered.first ) - rendered.first;
+
+   for ( std::size_t i = begin; i < end; ++i )
+   {
+      if ( 0 != rendered.isValid[ i ] )
+      {
+         rendered.isValid[ i ] = 0;
+         ++rendered.invalidCount;
+      }
+   }
+}
+
+}
+
+
+void CEffectRenderCache::setTrack( const IEffectGenerator &effect,
+                                   const std::shared_ptr<const SpectrumStore> &spectrum,
+                                   const std::shared_ptr<const BeatTrack> &beats )
+{
+   if ( nullptr == spectrum || spectrum->empty() )
+   {
+      m_rendered.reset();
+      return;
+   }
+
+   if ( nullptr != m_rendered && m_rendered->spectrum == spectrum && m_rendered->beats == beats )
+   {
+      return;
+   }
+
+   m_rendered = layout( effect, spectrum, beats );
+}
+
+void CEffectRenderCache::place( const IEffectGenerator &effect )
+{
+   if ( nullptr == m_rendered )
+   {
+      return;
+   }
+
+   const Rendered& previous = *m_rendered;
+   if ( previous.start == effect.effectStartPosition() && previous.duration == effect.effectDuration() )
+   {
+      return;
+   }
+
+   auto rendered = layout( effect, previous.spectrum, previous.beats );
+   if ( !effect.dependsOnPlacement() )
+   {
+      // Frames both placements cover keep their values
+      const std::size_t begin = std::max( rendered->first, previous.first );
+      const std::size_t end = std::min( rendered->first + rendered->values.size(), previous.first + previous.values.size() );
+      for ( std::size_t frame = begin; frame < end; ++frame )
+      {
+         const std::size_t from = frame - previous.first;
+         const std::size_t to = frame - rendered->first;
+         if ( 0 != previous.isValid[ from ] )
+         {
+            rendered->values[ to ] = previous.values[ from ];
+            rendered->isValid[ to ] = 1;
+            --rendered->invalidCount;
+         }
+      }
+
+      // The state starts with the effect, frames whose lookback reaches
+      // back to the later start saw a different one
+      if ( previous.start != rendered->start )
+      {
+         const int64_t later = std::max( previous.start, rendered->start );
+         markInvalid( *rendered, rendered->start, later + effect.lookbackMs() );
+      }
+   }
+
+   m_rendered = rendered;
+}
+
+void CEffectRenderCache::invalidate( const IEffectGenerator &effect, int64_t from, int64_t to )
+{
+   if ( nullptr == m_rendered )
+   {
+      return;
+   }
+
+   auto rendered = std::make_shared<Rendered>( *m_rendered );
+   markInvalid( *rendered, from, to + effect.lookbackMs() );
+   m_rendered = rendered;
+}
+
+bool CEffectRenderCache::isRenderedFrom( const SpectrumStore &spectrum, const std::shared_ptr<const BeatTrack> &beats ) const
+{
+   return nullptr != m_rendered && m_rendered->spectrum.get() == &spectrum && m_rendered->beats == beats;
+}
+
+bool CEffectRenderCache::value( std::size_t index, float &intensity ) const
+{
+   if (    nullptr == m_rendered
+        || index < m_rendered->first
+        || index >= m_rendered->first + m_rendered->values.size()
+        || 0 == m_rendered->isValid[ index - m_rendered->first ] )
+   {
+      return false;
+   }
+
+   intensity = m_rendered->values[ index - m_rendered->first ];
+   return true;
+}
+
+std::shared_ptr<const CEffectRenderCache::Rendered> CEffectRenderCache::render( const std::shared_ptr<const Rendered> &snapshot,
+                                                                                const std::shared_ptr<IEffectGenerator> &effect )
+{
+   if ( nullptr == snapshot || nullptr == effect )
+   {
+      return snapshot;
+   }
+
+   auto rendered = std::make_shared<Rendered>( *snapshot );
+   const std::size_t count = rendered->values.size();
+
+   // Every run of out of date frames on its own, the state rebuilt before it
+   std::size_t i = 0;
+   while ( i < count )
+   {
+      if ( 0 != rendered->isValid[ i ] )
+      {
+         ++i;
+         continue;
+      }
+
+      std::size_t end = i;
+      while ( end < count && 0 == rendered->isValid[ end ] )
+      {
+         rendered->isValid[ end ] = 1;
+         ++end;
+      }
+
+      effect->generate( *rendered->spectrum, rendered->beats, rendered->first + i, end - i, rendered->values.data() + i );
+      i = end;
+   }
+
+   rendered->invalidCount = 0;
+   return rendered;
+}
+
+bool CEffectRenderCache::adopt( const std::shared_ptr<const Rendered> &snapshot,
+                                const std::shared_ptr<const Rendered> &rendered )
+{
+   if ( m_rendered != snapshot || nullptr == rendered )
+   {
+      return false;
+   }
+
+   m_rendered = rendered;
+   return true;
+}
@@ -0,0 +1,84 @@
+#ifndef CEFFECTRENDERCACHE_H
+#define CEFFECTRENDERCACHE_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "SpectrumData.h"
+#include "SpectrumStore.h"
+
+class IEffectGenerator;
+
+/**
+ * Intensities of one effect rendered ahead over the analysed spectrum of
+ * its track, one value per analysed frame.
+ *
+ * Values are kept in immutable snapshots. A change of the effect makes a
+ * new snapshot with the frames it touches out of date, render() fills them
+ * in the background from a copy of the effect, and adopt() takes the
+ * result only if no other change came in meanwhile.
+ *
+ * The values only stand for frames of the spectrum they were rendered
+ * from. Preview playback takes its frames from the same analysed spectrum
+ * and reads them through a copy of the effect, setSnapshot() hands the
+ * copy what the timeline effect rendered.
+ *
+ * A parameter change puts the whole effect out of date. A move or a resize
+ * keeps the frames both placements cover, unless the effect depends on
+ * where it is placed, up to the lookbackMs() after the later start, where
+ * the state did not start at the same frame.
+ */
+class CEffectRenderCache
+{
+public:
+
+   struct Rendered
+   {
+      std::shared_ptr<const SpectrumStore> spectrum;
+      std::shared_ptr<const BeatTrack> beats;
+      int64_t start = 0;                 // placement of the effect rendered
+      int64_t duration = 0;
+      std::size_t first = 0;             // spectrum frame of values[ 0 ]
+      std::vector<float> values;
+      std::vector<uint8_t> isValid;      // per value
+      std::size_t invalidCount = 0;
+   };
+
+   // Drops the values if the track changed, a null spectrum keeps none
+   void setTrack( const IEffectGenerator& effect,
+                  const std::shared_ptr<const SpectrumStore>& spectrum,
+                  const std::shared_ptr<const BeatTrack>& beats );
+
+   // Follows the start and duration of effect
+   void place( const IEffectGenerator& effect );
+
+   // Frames of [ from, to ] ms and the lookback after them are out of date
+   void invalidate( const IEffectGenerator& effect, int64_t from, int64_t to );
+
+   const std::shared_ptr<const Rendered>& snapshot() const { return m_rendered; }
+
+   // Takes the values another copy of the effect rendered
+   void setSnapshot( const std::shared_ptr<const Rendered>& rendered ) { m_rendered = rendered; }
+
+   bool isRenderPending() const { return nullptr != m_rendered && m_rendered->invalidCount > 0; }
+
+   // True if the values were rendered from spectrum and beats
+   bool isRenderedFrom( const SpectrumStore& spectrum, const std::shared_ptr<const BeatTrack>& beats ) const;
+
+   // Value of frame index of the rendered spectrum, false without one or out of date
+   bool value( std::size_t index, float& intensity ) const;
+
+   // Out of date frames of snapshot rendered by effect, placed as the
+   // snapshot. Runs on any thread, neither argument is changed.
+   static std::shared_ptr<const Rendered> render( const std::shared_ptr<const Rendered>& snapshot,
+                                                  const std::shared_ptr<IEffectGenerator>& effect );
+
+   // Takes rendered if the cache is still at snapshot
+   bool adopt( const std::shared_ptr<const Rendered>& snapshot,
+               const std::shared_ptr<const Rendered>& rendered );
+
+private:
+   std::shared_ptr<const Rendered> m_rendered;
+};
+
+#endif // CEFFECTRENDERCACHE_H
@@ -4,6 +4,7 @@
 
 #include "CTimeLineEffect.h"
 #include "IEffectGenerator.h"
+#include "constants.h"
 
 
 constexpr int64_t cDefaultDuration = 5000;
@@ -58,6 +59,8 @@ void CTimeLineEffect::paint( QPainter *painter,
        auto rect = boundingRect();
 
        painter->drawRect( rect );
+       drawRendered( painter, rect );
+
        QFont font = scene()->font();
        QFontMetricsF fontMetrics( font );
        auto fontRect = fontMetrics.boundingRect( effectNameLabel() );
@@ -72,6 +75,47 @@ void CTimeLineEffect::paint( QPainter *painter,
 }
 
 
+void CTimeLineEffect::drawRendered( QPainter *painter, const QRectF &rect ) const
+{
+   auto rendered = getEffectGenerator()->renderCache().snapshot();
+   if ( nullptr == rendered || rendered->values.empty() )
+   {
+      return;
+   }
+
+   ITimeLineChannel* channel = getChannel();
+
+   // One line per run of frames rendered, out of date ones leave a gap
+   QPolygonF line;
+   auto drawLine = [ painter, &line ]()
+   {
+      if ( line.size() > 1 )
+      {
+         painter->drawPolyline( line );
+      }
+      line.clear();
+   };
+
+   painter->save();
+   painter->setPen( QPen( channel->color().darker( 200 ), 1 ) );
+   for ( std::size_t i = 0; i < rendered->values.size(); ++i )
+   {
+      if ( 0 == rendered->isValid[ i ] )
+      {
+         drawLine();
+         continue;
+      }
+
+      const int64_t position = int64_t( rendered->spectrum->position( rendered->first + i ) ) - rendered->start;
+      const qreal level = qBound( cMinIntensity, double( rendered->values[ i ] ), cMaxIntensity ) / cMaxIntensity;
+      line.append( QPointF( channel->timeLinePtr()->convertPositionToSceneX( position ),
+                            rect.bottom() - level * rect.height() ) );
+   }
+   drawLine();
+   painter->restore();
+}
+
+
 QVariant CTimeLineEffect::itemChange(GraphicsItemChange change, const QVariant &value)
 {
    return QGraphicsItem::itemChange(change, value);
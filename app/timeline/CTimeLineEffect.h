@@ -35,6 +35,10 @@ protected:
     virtual void mouseReleaseEvent(QGraphicsSceneMouseEvent *event) override;
     virtual void mouseDoubleClickEvent(QGraphicsSceneMouseEvent *event) override;
 
+private:
+    // Intensities rendered so far, over the height of rect
+    void drawRendered( QPainter *painter, const QRectF& rect ) const;
+
 private:
     bool pressedForMove=false;
     bool pressedForChangeDuration=false;
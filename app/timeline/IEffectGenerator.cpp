@@ -1,4 +1,6 @@
 #include "IEffectGenerator.h"
+#include <algorithm>
+#include <cmath>
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QLineEdit>
@@ -105,16 +107,207 @@ QJsonObject IEffectGenerator::toJson() const
    return object;
 }
 
-double IEffectGenerator::generate(const SpectrumData &spectrumData )
+void IEffectGenerator::setEffectDuration( const int64_t &eD )
+{
+   m_effectDuration = eD;
+   m_renderCache.place( *this );
+   requestRender();
+}
+
+void IEffectGenerator::setEffectStartPosition( const int64_t &SP )
+{
+   m_effectStartPosition = SP;
+   m_renderCache.place( *this );
+   requestRender();
+}
+
+void IEffectGenerator::setTrack( const std::shared_ptr<const SpectrumStore> &spectrum,
+                                 const std::shared_ptr<const BeatTrack> &beats )
+{
+   m_renderCache.setTrack( *this, spectrum, beats );
+   requestRender();
+}
+
+void IEffectGenerator::parametersChanged()
+{
+   m_renderCache.invalidate( *this, m_effectStartPosition, m_effectStartPosition + m_effectDuration );
+   requestRender();
+
+   if ( m_parametersNotification )
+   {
+      m_parametersNotification();
+   }
+}
+
+void IEffectGenerator::requestRender()
+{
+   if ( m_renderRequest && m_renderCache.isRenderPending() )
+   {
+      m_renderRequest();
+   }
+}
+
+double IEffectGenerator::generate( const SpectrumData &spectrumData, State &state )
 {
    double intensity = 0.0;
    if ( isPositionActive( spectrumData.position ) )
    {
-      intensity = calculateIntensity( spectrumData );
+      intensity = calculateIntensity( spectrumData, state );
    }
    return intensity;
 }
 
+void IEffectGenerator::generate( const SpectrumStore &spectrum,
+                                 const std::shared_ptr<const BeatTrack> &beats,
+                                 std::size_t first,
+                                 std::size_t count,
+                                 float *out,
+                                 State &state )
+{
+   // Positions are ordered, the active frames are one range found by bisection
+   const auto positions = spectrum.positions().subspan( first, count );
+   const int64_t start = m_effectStartPosition;
+   const int64_t end = m_effectStartPosition + m_effectDuration;
+
+   auto activeBegin = std::lower_bound( positions.begin(), positions.end(), start, []( uint64_t position, int64_t value )
+   {
+      return int64_t( position ) < value;
+   } );
+   auto activeEnd = std::upper_bound( activeBegin, positions.end(), end, []( int64_t value, uint64_t position )
+   {
+      return value < int64_t( position );
+   } );
+
+   const std::size_t begin = std::size_t( activeBegin - positions.begin() );
+   const std::size_t active = std::size_t( activeEnd - activeBegin );
+
+   std::fill( out, out + begin, 0.0f );
+   if ( active > 0 )
+   {
+      calculateIntensities( spectrum, beats, first + begin, active, out + begin, state );
+   }
+   std::fill( out + begin + active, out + count, 0.0f );
+}
+
+void IEffectGenerator::generate( const SpectrumStore &spectrum,
+                                 const std::shared_ptr<const BeatTrack> &beats,
+                                 std::size_t first,
+                                 std::size_t count,
+                                 float *out )
+{
+   if ( 0 == count )
+   {
+      return;
+   }
+
+   if ( !m_renderCache.isRenderedFrom( spectrum, beats ) )
+   {
+      State state = stateAt( spectrum, beats, first );
+      generate( spectrum, beats, first, count, out, state );
+      return;
+   }
+
+   // Rendered frames are copied, every run of the others renders on its own
+   std::size_t i = 0;
+   while ( i < count )
+   {
+      if ( m_renderCache.value( first + i, out[ i ] ) )
+      {
+         ++i;
+         continue;
+      }
+
+      float value = 0.0f;
+      std::size_t end = i + 1;
+      while ( end < count && !m_renderCache.value( first + end, value ) )
+      {
+         ++end;
+      }
+
+      State state = stateAt( spectrum, beats, first + i );
+      generate( spectrum, beats, first + i, end - i, out + i, state );
+      i = end;
+   }
+}
+
+double IEffectGenerator::fadeLevel( State &state, uint64_t position, double fade )
+{
+   auto dt = state.isStarted ? int64_t( position ) - state.position : 0;
+   if ( dt < 0 )
+   {
+      dt = 0;
+   }
+   state.position = int64_t( position );
+   state.isStarted = true;
+
+   // Without a floor the level would go on falling below 0 and depend on
+   // frames older than fadeLookbackMs()
+   state.level -= double( dt ) / ( 1000.0 * ( fade < 0.1 ? 0.1 : fade ) );
+   if ( state.level < 0.0 )
+   {
+      state.level = 0.0;
+   }
+
+   return state.level;
+}
+
+int64_t IEffectGenerator::fadeLookbackMs( double fade )
+{
+   return int64_t( std::ceil( 1000.0 * ( fade < 0.1 ? 0.1 : fade ) ) );
+}
+
+IEffectGenerator::State IEffectGenerator::stateAt( const SpectrumStore &spectrum,
+                                                   const std::shared_ptr<const BeatTrack> &beats,
+                                                   std::size_t index )
+{
+   State state;
+
+   const int64_t lookback = lookbackMs();
+   if ( lookback <= 0 || 0 == index || index > spectrum.size() )
+   {
+      return state;
+   }
+
+   // The effect starts without state, older frames of the window do not count
+   const int64_t position = int64_t( spectrum.position( index - 1 ) );
+   const int64_t from = std::max( m_effectStartPosition, position - lookback );
+   const auto positions = spectrum.positions();
+   auto it = std::lower_bound( positions.begin(), positions.begin() + index, from, []( uint64_t p, int64_t value )
+   {
+      return int64_t( p ) < value;
+   } );
+
+   const std::size_t begin = std::size_t( it - positions.begin() );
+   if ( begin < index )
+   {
+      std::vector<float> window( index - begin );
+      generate( spectrum, beats, begin, window.size(), window.data(), state );
+   }
+   return state;
+}
+
+void IEffectGenerator::calculateIntensities( const SpectrumStore &spectrum,
+                                             const std::shared_ptr<const BeatTrack> &beats,
+                                             std::size_t first,
+                                             std::size_t count,
+                                             float *out,
+                                             State &state )
+{
+   // One SpectrumData for all frames, so the bins are copied without allocations
+   SpectrumData spectrumData;
+   spectrumData.sampleRate = spectrum.sampleRate();
+   spectrumData.beats = beats;
+   spectrumData.spectrum.reserve( spectrum.binCount() );
+
+   for ( std::size_t i = 0; i < count; ++i )
+   {
+      const auto bins = spectrum.frame( first + i );
+      spectrumData.position = spectrum.position( first + i );
+      spectrumData.spectrum.assign( bins.begin(), bins.end() );
+      out[ i ] = float( calculateIntensity( spectrumData, state ) );
+   }
+}
+
 QWidget *IEffectGenerator::configurationWidget( QWidget* parent )
 {
    QWidget* configWidget = new QWidget( parent );
@@ -183,5 +376,7 @@ std::shared_ptr<IEffectGenerator> IEffectGenerator::getCopy() const
     std::shared_ptr<IEffectGenerator> copy = makeCopy();
     assert( nullptr != copy );
     copy->m_uuid = QUuid::createUuid();
+    copy->m_renderRequest = nullptr;
+    copy->m_parametersNotification = nullptr;
     return copy;
 }
@@ -4,11 +4,14 @@
 #include <QString>
 #include <QUuid>
 #include <QJsonObject>
+#include <functional>
 #include <map>
 #include <memory>
 #include <QWidget>
 #include <QDebug>
 #include "SpectrumData.h"
+#include "SpectrumStore.h"
+#include "CEffectRenderCache.h"
 
 constexpr int labelHeight = 15;
 
@@ -39,11 +42,38 @@ private:
 };
 
 
+/**
+ * Intensity of a timeline effect, frame by frame.
+ *
+ * An effect holds its parameters only. Whatever it carries from one frame
+ * to the next, as the level a fade goes down from, is in a State that
+ * belongs to the render: live output, the batch render of a range or a
+ * preview each have their own, so they can run at the same time and a
+ * seek cannot pick up a level from elsewhere in the track.
+ *
+ * Frames older than lookbackMs() do not change the output any more, so
+ * stateAt() rebuilds the state of any frame from that window alone and a
+ * range renders the same on its own as in a render of the whole track.
+ *
+ * With a track set, the intensities are also rendered ahead into a
+ * CEffectRenderCache. Changes of placement or parameters put the frames
+ * they touch out of date and ask for a render. A render of a range of the
+ * same spectrum takes the values rendered ahead, out of date frames and
+ * any other spectrum evaluate the effect.
+ */
 class IEffectGenerator
 {
    friend class IEffectGeneratorFactory;
 public:
 
+   // A default constructed state starts a render at any frame
+   struct State
+   {
+      bool isStarted = false;
+      int64_t position = 0;      // of the previous frame
+      double level = 0.0;        // given for the previous frame
+   };
+
    IEffectGenerator( IEffectGeneratorFactory& afactory );
    IEffectGenerator( IEffectGeneratorFactory& afactory, const QUuid& uuid );
 
@@ -53,10 +83,10 @@ public:
    void setEffectNameLabel( const QString &ef ) {  m_effectNameLabel = ef;  }
 
    int64_t effectDuration() const         {  return m_effectDuration;  }
-   void setEffectDuration( const int64_t &eD ) { m_effectDuration = eD; }
+   void setEffectDuration( const int64_t &eD );
 
    int64_t effectStartPosition() const    {  return m_effectStartPosition;  }
-   void setEffectStartPosition( const int64_t &SP )  {  m_effectStartPosition = SP;  }
+   void setEffectStartPosition( const int64_t &SP );
 
    const QUuid&   getUuid() const {  return m_uuid;  }
 
@@ -64,7 +94,51 @@ public:
 
    QJsonObject toJson() const ;
 
-   double generate( const SpectrumData& spectrumData );
+   // Frames of one state have to come in order
+   double generate( const SpectrumData& spectrumData, State& state );
+
+   // Frames [ first, first + count ) of a whole track at once, out[ i ] is
+   // what generate() gives for frame first + i, 0 where the effect is not
+   // active. state goes on from the frame before first.
+   void generate( const SpectrumStore& spectrum,
+                  const std::shared_ptr<const BeatTrack>& beats,
+                  std::size_t first,
+                  std::size_t count,
+                  float* out,
+                  State& state );
+
+   // Same with the state rebuilt by stateAt( first ), independent of any
+   // other range. Frames rendered ahead from spectrum are taken from the cache.
+   void generate( const SpectrumStore& spectrum,
+                  const std::shared_ptr<const BeatTrack>& beats,
+                  std::size_t first,
+                  std::size_t count,
+                  float* out );
+
+   // State before frame index, from the frames of the last lookbackMs()
+   State stateAt( const SpectrumStore& spectrum,
+                  const std::shared_ptr<const BeatTrack>& beats,
+                  std::size_t index );
+
+   // How long a frame changes the output of later ones, 0 without state
+   virtual int64_t lookbackMs() const { return 0; }
+
+   // True if the output depends on the start or duration, not only on the
+   // position in the track; a move renders the whole effect again
+   virtual bool dependsOnPlacement() const { return false; }
+
+   // Analysed track the render cache renders over
+   void setTrack( const std::shared_ptr<const SpectrumStore>& spectrum,
+                  const std::shared_ptr<const BeatTrack>& beats );
+
+   CEffectRenderCache& renderCache() { return m_renderCache; }
+   const CEffectRenderCache& renderCache() const { return m_renderCache; }
+
+   // Called whenever the render cache has frames out of date, not copied
+   void setRenderRequest( std::function<void()> request ) { m_renderRequest = std::move( request ); }
+
+   // Called after parametersChanged(), not copied
+   void setParametersNotification( std::function<void()> notification ) { m_parametersNotification = std::move( notification ); }
 
    QWidget* configurationWidget( QWidget* parent );
 
@@ -72,12 +146,36 @@ public:
    std::shared_ptr<IEffectGenerator> getCopy() const;
 
 protected:
+   // For the widgets of buildWidget(), after a parameter changed
+   void parametersChanged();
+
    virtual QJsonObject toJsonParameters() const = 0;
    virtual bool parseParameters( const QJsonObject& parameters ) = 0;
-   virtual double calculateIntensity( const SpectrumData& spectrumData ) = 0;
+   virtual double calculateIntensity( const SpectrumData& spectrumData, State& state ) = 0;
+
+   // Frames [ first, first + count ), all inside the effect. The default
+   // asks calculateIntensity() frame by frame, effects override it with a
+   // loop over the frame arrays.
+   virtual void calculateIntensities( const SpectrumStore& spectrum,
+                                      const std::shared_ptr<const BeatTrack>& beats,
+                                      std::size_t first,
+                                      std::size_t count,
+                                      float* out,
+                                      State& state );
    virtual QWidget* buildWidget( QWidget* parent ) = 0;
    virtual std::shared_ptr<IEffectGenerator> makeCopy() const = 0;
 
+   // Fades the level of state by the time since its previous frame, a
+   // level of 1 in fade seconds and not below 0. The first frame of a
+   // render has nothing to fade from.
+   static double fadeLevel( State& state, uint64_t position, double fade );
+
+   // lookbackMs() of an effect that fades by fadeLevel()
+   static int64_t fadeLookbackMs( double fade );
+
+private:
+   void requestRender();
+
 private:
    IEffectGeneratorFactory& m_factory;
 
@@ -86,6 +184,10 @@ private:
    int64_t m_effectDuration;
    int64_t m_effectStartPosition;
 
+   CEffectRenderCache m_renderCache;
+   std::function<void()> m_renderRequest;
+   std::function<void()> m_parametersNotification;
+
 };
 
 
@@ -1,8 +1,35 @@
 #include "ITimeLineTrackView.h"
 #include <QDebug>
+#include <QtConcurrent/QtConcurrentRun>
 
 constexpr int64_t cMinimumDuration = 200;
 
+// Quiet time after a change before the effect is rendered again
+constexpr int cRenderDelayMs = 150;
+
+
+IEffect::IEffect( std::shared_ptr<IEffectGenerator> effectGenerator, QObject *parent )
+   : QObject( parent )
+   , m_effectGenerator( effectGenerator )
+   , m_renderTimer( new QTimer( this ) )
+   , m_renderWatcher( new QFutureWatcher< std::shared_ptr<const CEffectRenderCache::Rendered> >( this ) )
+{
+   m_renderTimer->setSingleShot( true );
+   m_renderTimer->setInterval( cRenderDelayMs );
+   connect( m_renderTimer, &QTimer::timeout, this, &IEffect::startRender );
+   connect( m_renderWatcher, &QFutureWatcherBase::finished, this, &IEffect::renderFinished );
+
+   m_effectGenerator->setRenderRequest( [ this ](){ scheduleRender(); } );
+   m_effectGenerator->setParametersNotification( [ this ](){ parametersChanged(); } );
+   scheduleRender();
+}
+
+IEffect::~IEffect()
+{
+   m_effectGenerator->setRenderRequest( nullptr );
+   m_effectGenerator->setParametersNotification( nullptr );
+}
+
 
 ITimeLineChannel *IEffect::getChannel() const
 {
@@ -17,6 +44,54 @@ void IEffect::updatePosition()
    setX( channel->timeLinePtr()->channelLabelWidth() + channel->timeLinePtr()->convertPositionToSceneX( effectStartPosition() ));
 }
 
+void IEffect::setTrack( const std::shared_ptr<const SpectrumStore> &spectrum, const std::shared_ptr<const BeatTrack> &beats )
+{
+   m_effectGenerator->setTrack( spectrum, beats );
+}
+
+void IEffect::scheduleRender()
+{
+   if ( m_effectGenerator->renderCache().isRenderPending() )
+   {
+      m_renderTimer->start();
+   }
+}
+
+void IEffect::startRender()
+{
+   // A running render is adopted or dropped first, then this one goes on
+   if ( m_renderWatcher->isRunning() || !m_effectGenerator->renderCache().isRenderPending() )
+   {
+      return;
+   }
+
+   // The copy is placed and set as the snapshot, edits go on meanwhile
+   auto snapshot = m_effectGenerator->renderCache().snapshot();
+   auto effect = m_effectGenerator->getCopy();
+   m_renderedFrom = snapshot;
+   m_renderWatcher->setFuture( QtConcurrent::run( [ snapshot, effect ]() {
+      return CEffectRenderCache::render( snapshot, effect );
+   } ) );
+}
+
+void IEffect::renderFinished()
+{
+   auto snapshot = std::move( m_renderedFrom );
+   if ( m_effectGenerator->renderCache().adopt( snapshot, m_renderWatcher->result() ) )
+   {
+      update();
+
+      ITimeLineChannel* channel = dynamic_cast<ITimeLineChannel*>( parentItem() );
+      if ( nullptr != channel )
+      {
+         channel->effectRenderedEvent( this );
+      }
+   }
+
+   // Changed while rendering
+   scheduleRender();
+}
+
 void IEffect::effectChanged()
 {
    getChannel()->effectChangedEvent( this );
@@ -27,6 +102,16 @@ void IEffect::effectsSelected()
    getChannel()->effectSelectedEvent( this );
 }
 
+void IEffect::parametersChanged()
+{
+   // Not placed in a channel yet while it is built
+   ITimeLineChannel* channel = dynamic_cast<ITimeLineChannel*>( parentItem() );
+   if ( nullptr != channel )
+   {
+      channel->effectParametersChangedEvent( this );
+   }
+}
+
 std::shared_ptr<IEffectGenerator> IEffect::getEffectGenerator() const
 {
    return m_effectGenerator;
@@ -92,6 +177,16 @@ void ITimeLineChannel::effectChangedEvent(IEffect *effect)
    emit effectChanged( this, effect );
 }
 
+void ITimeLineChannel::effectParametersChangedEvent(IEffect *effect)
+{
+   emit effectParametersChanged( this, effect );
+}
+
+void ITimeLineChannel::effectRenderedEvent(IEffect *effect)
+{
+   emit effectRendered( this, effect );
+}
+
 void ITimeLineChannel::effectSelectedEvent(IEffect *effect)
 {
    emit effectSelected( this, effect );
@@ -8,6 +8,8 @@
 #include <QGraphicsItem>
 #include <QString>
 #include <QUuid>
+#include <QTimer>
+#include <QFutureWatcher>
 
 #include "IEffectGenerator.h"
 
@@ -47,11 +49,15 @@ signals:
    void effectRemoved( ITimeLineChannel* tlChannel, QUuid uuid );
    void effectAdded( ITimeLineChannel* tlChannel, IEffect* effect );
    void effectChanged( ITimeLineChannel* tlChannel, IEffect* effect );
+   void effectParametersChanged( ITimeLineChannel* tlChannel, IEffect* effect );
+   void effectRendered( ITimeLineChannel* tlChannel, IEffect* effect );
    void effectSelected( ITimeLineChannel* tlChannel, IEffect* effect );
    void effectDoubleClick( ITimeLineChannel* tlChannel, IEffect* effect );
 
 protected:
    void effectChangedEvent( IEffect* effect );
+   void effectParametersChangedEvent( IEffect* effect );
+   void effectRenderedEvent( IEffect* effect );
    void effectSelectedEvent( IEffect* effect );
 
 };
@@ -63,12 +69,9 @@ class IEffect : public QObject
    Q_OBJECT
 public:
 
-   IEffect( std::shared_ptr<IEffectGenerator> effectGenerator, QObject * parent = nullptr )
-      : QObject( parent )
-      , m_effectGenerator( effectGenerator )
-   {}
+   IEffect( std::shared_ptr<IEffectGenerator> effectGenerator, QObject * parent = nullptr );
 
-   virtual ~IEffect() = default;
+   virtual ~IEffect();
 
    const QString& effectNameLabel() const {  return m_effectGenerator->effectNameLabel();  }
    void setEffectNameLabel(const QString &ef) {  m_effectGenerator->setEffectNameLabel( ef );  }
@@ -79,6 +82,9 @@ public:
    int64_t effectStartPosition() const    {  return m_effectGenerator->effectStartPosition();  }
    void setEffectStartPosition(const int64_t &SP)  {  m_effectGenerator->setEffectStartPosition( SP );  }
 
+   // Analysed track the intensities of the effect are rendered over in the background
+   void setTrack( const std::shared_ptr<const SpectrumStore>& spectrum, const std::shared_ptr<const BeatTrack>& beats );
+
    ITimeLineChannel *getChannel() const;
 
    void updatePosition();
@@ -93,9 +99,20 @@ signals:
 protected:
    void effectChanged();
    void effectsSelected();
+   void parametersChanged();
+
+private:
+   void scheduleRender();
+   void startRender();
+   void renderFinished();
 
 private:
    std::shared_ptr<IEffectGenerator> m_effectGenerator;
+
+   // Renders wait for the changes to settle, one at a time
+   QTimer* m_renderTimer;
+   QFutureWatcher< std::shared_ptr<const CEffectRenderCache::Rendered> >* m_renderWatcher;
+   std::shared_ptr<const CEffectRenderCache::Rendered> m_renderedFrom;
 };
 
 
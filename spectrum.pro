@@ -4,6 +4,7 @@ TEMPLATE = subdirs
 CONFIG  += ordered
 
 SUBDIRS += app
+SUBDIRS += app/cli
 
 TARGET = spectrum
 